@@ -261,6 +261,71 @@ uint32 ICACHE_FLASH_ATTR spi_transaction(uint8 spi_no, uint8 cmd_bits, uint16 cm
     return 1; //success
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function Name: spi_write_block
+//   Description: Sends up to 64 bytes in one SPI transaction by loading the
+//				  data buffer registers W0-W15 directly
+//    Parameters: spi_no - SPI (0) or HSPI (1)
+//				  buf - data to send (buf[0] is sent first)
+//				  len - number of bytes to send (1..64)
+//
+//		 Returns: number of bytes sent
+//				  Note: returns after the transaction has completed. The tx byte
+//				  order is restored to SPI_BYTE_ORDER_HIGH_TO_LOW afterwards,
+//				  which is what spi_transaction() and spiwrite_xx() expect.
+//
+////////////////////////////////////////////////////////////////////////////////
+uint32 ICACHE_FLASH_ATTR spi_write_block(uint8 spi_no, const uint8 *buf, uint32 len)
+{
+    uint32 i;
+    uint32 word;
+
+    if (spi_no > 1)
+        return 0; //Check for a valid SPI
+    if (len > SPI_BLOCK_SIZE_MAX)
+        len = SPI_BLOCK_SIZE_MAX;
+    if (len == 0)
+        return 0;
+
+    while (spi_busy(spi_no)); //wait for SPI to be ready
+
+    //lowest byte of W0 goes out first => buffer can be copied as little endian words
+    spi_tx_byte_order(spi_no, SPI_BYTE_ORDER_LOW_TO_HIGH);
+    //MOSI only
+    CLEAR_PERI_REG_MASK(SPI_USER(spi_no), SPI_USR_MISO|SPI_USR_COMMAND|SPI_USR_ADDR|SPI_USR_DUMMY|SPI_USR_DOUTDIN);
+    SET_PERI_REG_MASK(SPI_USER(spi_no), SPI_USR_MOSI);
+    WRITE_PERI_REG(SPI_USER1(spi_no), ((len*8-1)&SPI_USR_MOSI_BITLEN)<<SPI_USR_MOSI_BITLEN_S);
+
+    //copy data to W0..W15
+    if ((((uint32) buf) & 3) == 0)
+    {
+        //aligned buffer => word access
+        for (i = 0; i + 4 <= len; i += 4)
+            WRITE_PERI_REG(SPI_W0(spi_no) + i, *(const uint32*) &buf[i]);
+    }
+    else
+    {
+        for (i = 0; i + 4 <= len; i += 4)
+            WRITE_PERI_REG(SPI_W0(spi_no) + i, buf[i] | (buf[i + 1] << 8) | (buf[i + 2] << 16) | (buf[i + 3] << 24));
+    }
+    if (i < len)
+    {
+        //remaining bytes (len is not a multiple of 4)
+        word = 0;
+        for (uint32 j = 0; i + j < len; j++)
+            word |= buf[i + j] << (8 * j);
+        WRITE_PERI_REG(SPI_W0(spi_no) + i, word);
+    }
+
+    //Begin SPI Transaction and wait for it to complete
+    SET_PERI_REG_MASK(SPI_CMD(spi_no), SPI_USR);
+    while (spi_busy(spi_no));
+
+    spi_tx_byte_order(spi_no, SPI_BYTE_ORDER_HIGH_TO_LOW);
+    return len;
+}
+
 /*
  * Send a single byte by spi interface and return a ansver in duplex mode
  */
@@ -12,6 +12,9 @@
 #define SPI_BYTE_ORDER_HIGH_TO_LOW 1
 #define SPI_BYTE_ORDER_LOW_TO_HIGH 0
 
+//Size of SPI data buffer (W0-W15) in bytes
+#define SPI_BLOCK_SIZE_MAX 64
+
 #define CPU_CLK_FREQ 80*1000000
 
 //Define some default SPI clock settings
@@ -44,6 +47,7 @@ void ICACHE_FLASH_ATTR spi_clock(uint8 spi_no, uint16 prediv, uint8 cntdiv);
 void ICACHE_FLASH_ATTR spi_init_gpio(uint8 spi_no, uint8 sysclk_as_spiclk);
 void ICACHE_FLASH_ATTR spi_init(uint8 spi_no);
 uint32 ICACHE_FLASH_ATTR spi_transaction(uint8 spi_no, uint8 cmd_bits, uint16 cmd_data, uint32 addr_bits, uint32 addr_data, uint32 dout_bits, uint32 dout_data, uint32 din_bits, uint32 dummy_bits);
+uint32 ICACHE_FLASH_ATTR spi_write_block(uint8 spi_no, const uint8 *buf, uint32 len);
 uint32 ICACHE_FLASH_ATTR spiwrite_8(uint32 c);
 uint32 ICACHE_FLASH_ATTR spiwrite_16(uint32 c);
 uint32 ICACHE_FLASH_ATTR spiwrite_32(uint32 c);
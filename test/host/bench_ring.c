@@ -0,0 +1,268 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Ring buffer benchmark: Byte-wise ring (BufferIn/BufferOut) against the block-copy SPSC ring of vs1053.c.
+// Producer writes TCP segments, consumer takes 32 byte SDI blocks like the feeder does.
+// Numbers are host numbers. Only the ratio between both rings carries over to the ESP8266.
+
+#include <time.h>
+#include <esp8266.h>
+#include "vs1053.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()  __rdtsc()
+#else
+#define BENCH_CYCLES()  0
+#endif
+
+// Amount of data pushed through each ring
+#define BENCH_BYTES         (256UL * 1024 * 1024)
+// Blocks taken out by one feeder run (complete SDI FIFO)
+#define BENCH_BURSTS        64
+
+/******* BYTE-WISE RING BUFFER (vs1053.c before the SPSC ring) *******/
+#define BUFFER_FAIL     0
+#define BUFFER_SUCCESS  1
+#define BUFFER_SIZE 20000
+
+static struct Buffer
+{
+    uint8_t data[BUFFER_SIZE];
+    uint16_t read; // zeigt auf das Feld mit dem aeltesten Inhalt
+    uint16_t write; // zeigt immer auf leeres Feld
+} buffer = { { }, 0, 0 };
+
+static ICACHE_FLASH_ATTR uint8_t BufferIn(uint8_t byte)
+{
+    if ((buffer.write + 1 == buffer.read) || (buffer.read == 0 && buffer.write + 1 == BUFFER_SIZE))
+        return BUFFER_FAIL; // voll
+
+    buffer.data[buffer.write] = byte;
+
+    buffer.write++;
+    if (buffer.write >= BUFFER_SIZE)
+        buffer.write = 0;
+
+    return BUFFER_SUCCESS;
+}
+
+static ICACHE_FLASH_ATTR uint8_t BufferOut(uint8_t *pByte)
+{
+    if (buffer.read == buffer.write)
+        return BUFFER_FAIL;
+
+    *pByte = buffer.data[buffer.read];
+
+    buffer.read++;
+    if (buffer.read >= BUFFER_SIZE)
+        buffer.read = 0;
+
+    return BUFFER_SUCCESS;
+}
+
+static uint8_t ICACHE_FLASH_ATTR OLD_vFillRingBuffer(uint8 *data, uint32 length)
+{
+    for (uint32 i = 0; i < length; i++)
+    {
+        if (BufferIn(*(data + i)) == BUFFER_FAIL)
+        {
+            return BUFFER_FAIL;
+        }
+    }
+    return BUFFER_SUCCESS;
+}
+
+static uint16 ICACHE_FLASH_ATTR OLD_u16GetFreeBufferSize(void)
+{
+    if (buffer.write == buffer.read)
+        return BUFFER_SIZE;
+    if (buffer.write < buffer.read)
+        return buffer.read - buffer.write;
+    if (buffer.write > buffer.read)
+        return (BUFFER_SIZE - buffer.write) + buffer.read;
+    return 0;
+}
+
+static uint16 ICACHE_FLASH_ATTR OLD_u16GetUsedBufferSize(void)
+{
+    return (BUFFER_SIZE - OLD_u16GetFreeBufferSize());
+}
+/*********************************************************************/
+
+typedef struct
+{
+    const char *name;
+    uint32 segment; // Size of TCP segment in bytes
+    uint64 bytes;
+    double seconds;
+    uint64 cycles;
+    uint32 checksum;
+} BENCH_tstResult;
+
+static volatile uint32 BENCH_u32Checksum;
+
+// Stands in for the SPI transfer. Not inlined so both rings hand over a real block.
+static void __attribute__((noinline)) BENCH_vSend(const uint8 *data)
+{
+    BENCH_u32Checksum = BENCH_u32Checksum * 31 + data[0] + data[31];
+}
+
+static double BENCH_dNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void BENCH_vFill(uint8 *segment, uint32 length, uint32 offset)
+{
+    uint32 i;
+
+    for (i = 0; i < length; i++)
+        segment[i] = (uint8)((offset + i) * 7);
+}
+
+static void BENCH_vRunOld(BENCH_tstResult *result, uint8 *segment)
+{
+    uint8 data[32];
+    uint32 burst;
+    uint32 i;
+
+    buffer.read = 0;
+    buffer.write = 0;
+    BENCH_u32Checksum = 0;
+    result->bytes = 0;
+    while (result->bytes < BENCH_BYTES)
+    {
+        // Receive callback: Segment is dropped if it does not fit (consumer catches up below)
+        if (OLD_u16GetFreeBufferSize() > result->segment)
+            OLD_vFillRingBuffer(segment, result->segment);
+        // Feeder: Same loop as the old VS1053_vPoll()
+        for (burst = 0; (burst < BENCH_BURSTS) && (OLD_u16GetUsedBufferSize() >= 32); burst++)
+        {
+            for (i = 0; i < 32; i++)
+                BufferOut(&data[i]);
+            BENCH_vSend(data);
+            result->bytes += 32;
+        }
+    }
+    result->checksum = BENCH_u32Checksum;
+}
+
+static void BENCH_vRunNew(BENCH_tstResult *result, uint8 *segment)
+{
+    uint8 data[32];
+    uint8 *ptr;
+    uint32 length;
+    uint32 burst;
+
+    VS1053_vFlushRingBuffer();
+    BENCH_u32Checksum = 0;
+    result->bytes = 0;
+    while (result->bytes < BENCH_BYTES)
+    {
+        // Receive callback
+        if (VS1053_u16GetFreeBufferSize() > result->segment)
+            VS1053_u32WriteRingBuffer(segment, result->segment);
+        // Feeder: Same steps as VS1053_vPoll() without the SPI transfer
+        for (burst = 0; (burst < BENCH_BURSTS) && (VS1053_u16GetUsedBufferSize() >= 32); burst++)
+        {
+            length = VS1053_u32PeekRingBuffer(&ptr);
+            if (length < 32)
+            {
+                os_memcpy(data, ptr, length);
+                VS1053_vCommitRingBuffer(length);
+                VS1053_u32PeekRingBuffer(&ptr);
+                os_memcpy(&data[length], ptr, 32 - length);
+                VS1053_vCommitRingBuffer(32 - length);
+                ptr = data;
+            }
+            else
+            {
+                VS1053_vCommitRingBuffer(32);
+            }
+            BENCH_vSend(ptr);
+            result->bytes += 32;
+        }
+    }
+    result->checksum = BENCH_u32Checksum;
+}
+
+static void BENCH_vMeasure(BENCH_tstResult *result, void (*run)(BENCH_tstResult *, uint8 *))
+{
+    uint8 segment[1460];
+    double start;
+    uint64 cycles;
+
+    BENCH_vFill(segment, result->segment, 0);
+    // Warm up caches and branch predictors
+    run(result, segment);
+    start = BENCH_dNow();
+    cycles = BENCH_CYCLES();
+    run(result, segment);
+    result->cycles = BENCH_CYCLES() - cycles;
+    result->seconds = BENCH_dNow() - start;
+}
+
+static void BENCH_vPrint(const BENCH_tstResult *result)
+{
+    printf("%-10s %7u %10.1f %12.2f   %08x\n",
+        result->name,
+        (unsigned)result->segment,
+        result->bytes / result->seconds / (1024 * 1024),
+        (double)result->cycles / result->bytes,
+        (unsigned)result->checksum);
+}
+
+int main(void)
+{
+    static const uint32 segments[] = { 1460, 536 };
+    BENCH_tstResult old_ring;
+    BENCH_tstResult new_ring;
+    uint8 i;
+    int failed = 0;
+
+    printf("Ring buffer benchmark, %lu MB per run\n", BENCH_BYTES / (1024 * 1024));
+    printf("%-10s %7s %10s %12s   %s\n", "ring", "segment", "MB/s", "cycles/byte", "checksum");
+    for (i = 0; i < sizeof(segments) / sizeof(segments[0]); i++)
+    {
+        old_ring.name = "byte-wise";
+        old_ring.segment = segments[i];
+        BENCH_vMeasure(&old_ring, BENCH_vRunOld);
+        BENCH_vPrint(&old_ring);
+        new_ring.name = "spsc";
+        new_ring.segment = segments[i];
+        BENCH_vMeasure(&new_ring, BENCH_vRunNew);
+        BENCH_vPrint(&new_ring);
+        printf("%-10s %7u %9.1fx\n", "speedup", (unsigned)segments[i], old_ring.seconds / new_ring.seconds);
+        // Both rings have to deliver the same byte sequence to the chip
+        if (old_ring.checksum != new_ring.checksum)
+        {
+            printf("FAIL: data differs between rings\n");
+            failed = 1;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,197 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Station search on a list of 10000 stations: Import through the list parser into the simulated flash,
+// then search with the trigram index and compare with a linear scan of all names.
+// Flash reads per search call bound the time a call blocks the ESP8266. Host times are only for comparison.
+// Texts shorter than a trigram match every signature, so each station scanned costs a name check.
+
+#include <time.h>
+#include <esp8266.h>
+#include "stationimport.h"
+#include "sdk.h"
+
+#define BENCH_STATIONS      10000
+#define BENCH_WORD_COUNT    (sizeof(BENCH_apcWords) / sizeof(BENCH_apcWords[0]))
+
+static const char *BENCH_apcWords[] =
+{
+    "Radio", "FM", "Jazz", "Rock", "Classic", "Hits", "News", "Talk", "Lounge", "Chill",
+    "Dance", "Metal", "Country", "Pop", "Antenne", "Bayern", "Deutschlandfunk", "Kultur", "Swing", "Blues"
+};
+
+static double BENCH_dNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static bool BENCH_bImport(void)
+{
+    static STATIONIMPORT_tstParser parser;
+    static char list[BENCH_STATIONS * 96];
+    SDK_tstFlashStatistics flash;
+    uint32 length = 0;
+    uint32 i;
+    double start;
+
+    // streamlist.txt format, names made of three random words and the number
+    srand(1);
+    for (i = 0; i < BENCH_STATIONS; i++)
+    {
+        length += os_sprintf(list + length, "%s %s %s %u;http://s%u.example.com/live.mp3\n", BENCH_apcWords[rand() % BENCH_WORD_COUNT],
+                BENCH_apcWords[rand() % BENCH_WORD_COUNT], BENCH_apcWords[rand() % BENCH_WORD_COUNT], i, i);
+    }
+
+    SDK_vEraseFlash();
+    start = BENCH_dNow();
+    if (!STATIONIMPORT_bBegin(&parser))
+        return 0;
+    STATIONIMPORT_vProcess(&parser, list, length);
+    if (!STATIONIMPORT_bFinish(&parser))
+        return 0;
+    SDK_vGetFlashStatistics(&flash);
+    printf("import: %u stations, %u skipped, %u kB written, %u sectors erased, %.1f ms host\n", parser.entries, parser.skipped,
+            (uint32) (flash.bytes_written / 1024), flash.erases, (BENCH_dNow() - start) * 1e3);
+    return (parser.entries == BENCH_STATIONS) && (STATIONDB_u32GetCount() == BENCH_STATIONS);
+}
+
+static uint32 BENCH_u32CountLinear(const char *text)
+{
+    char name[STATIONDB_NAME_SIZE];
+    char lower[STATIONDB_QUERY_SIZE];
+    uint32 count = 0;
+    uint32 i;
+
+    // Reference: Every name read and compared (case insensitive, query is cut like STATIONDB_vInitQuery() does)
+    for (i = 0; (text[i] != '\0') && (i < STATIONDB_QUERY_SIZE - 1); i++)
+        lower[i] = tolower((uint8) text[i]);
+    lower[i] = '\0';
+    for (i = 0; i < STATIONDB_u32GetCount(); i++)
+    {
+        if (!STATIONDB_bGetName(i, name))
+            continue;
+        for (char *c = name; *c != '\0'; c++)
+            *c = tolower((uint8) *c);
+        if (os_strstr(name, lower) != NULL)
+            count++;
+    }
+    return count;
+}
+
+static bool BENCH_bSearch(const char *text)
+{
+    STATIONDB_tstQuery query;
+    STATIONDB_tenFind result;
+    SDK_tstFlashStatistics before;
+    SDK_tstFlashStatistics after;
+    SDK_tstFlashStatistics start;
+    char name[STATIONDB_NAME_SIZE];
+    uint32 index;
+    uint32 matches = 0;
+    uint32 calls = 0;
+    uint32 max_reads = 0;
+    uint64 max_bytes = 0;
+    uint32 max_scanned = 0;
+    uint32 next;
+    uint32 reference;
+    double time;
+
+    STATIONDB_vInitQuery(&query, text);
+    SDK_vGetFlashStatistics(&start);
+    after = start;
+    time = BENCH_dNow();
+    do
+    {
+        before = after;
+        next = query.next;
+        result = STATIONDB_enFind(&query, &index, name);
+        SDK_vGetFlashStatistics(&after);
+        calls++;
+        if (after.reads - before.reads > max_reads)
+            max_reads = after.reads - before.reads;
+        if (after.bytes_read - before.bytes_read > max_bytes)
+            max_bytes = after.bytes_read - before.bytes_read;
+        if (query.next - next > max_scanned)
+            max_scanned = query.next - next;
+        if (result == STATIONDB_enFindMatch)
+            matches++;
+    } while (result != STATIONDB_enFindDone);
+    time = BENCH_dNow() - time;
+
+    reference = BENCH_u32CountLinear(text);
+    printf("%-12s %7u %7u %6u %7u %10u %10u %10u %7.2f\n", text, matches, reference, calls, after.reads - start.reads, max_reads,
+            (uint32) max_bytes, max_scanned, time * 1e3);
+    if (matches != reference)
+    {
+        printf("FAIL: index search differs from linear scan\n");
+        return 0;
+    }
+    if ((max_scanned > STATIONDB_FIND_SIGNATURES) || ((os_strlen(text) < 3) && (max_scanned > STATIONDB_FIND_NAMES)))
+    {
+        printf("FAIL: search call exceeds its work limit\n");
+        return 0;
+    }
+    return 1;
+}
+
+int main(void)
+{
+    static const char *queries[] = { "jazz", "Blues Rock", "9999", "dlandf", "xyz", "a", "q", "" };
+    SDK_tstFlashStatistics before;
+    SDK_tstFlashStatistics after;
+    char name[STATIONDB_NAME_SIZE];
+    uint32 i;
+    int failed = 0;
+
+    if (!BENCH_bImport())
+    {
+        printf("FAIL: import\n");
+        return 1;
+    }
+
+    printf("%-12s %7s %7s %6s %7s %10s %10s %10s %7s\n", "query", "matches", "linear", "calls", "reads", "reads/call", "bytes/call", "scans/call",
+            "ms host");
+    for (i = 0; i < sizeof(queries) / sizeof(queries[0]); i++)
+    {
+        if (!BENCH_bSearch(queries[i]))
+            failed = 1;
+    }
+
+    // Without the index every name has to be read
+    SDK_vGetFlashStatistics(&before);
+    for (i = 0; i < STATIONDB_u32GetCount(); i++)
+        STATIONDB_bGetName(i, name);
+    SDK_vGetFlashStatistics(&after);
+    printf("linear name scan: %u reads, %u kB\n", after.reads - before.reads, (uint32) ((after.bytes_read - before.bytes_read) / 1024));
+
+    // SDK rejects unaligned flash accesses
+    if (after.errors != 0)
+    {
+        printf("FAIL: %u invalid flash accesses\n", after.errors);
+        failed = 1;
+    }
+    return failed;
+}
@@ -0,0 +1,317 @@
+#!/usr/bin/env python3
+# MIT License
+#
+# Copyright (c) 2019, wolllis
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Writes the stream captures used by the host tests. The captures are laid out like the recordings of
+# real stations (header layout, metadata blocks) but the payload is generated, so they can be rebuilt
+# and the expected parser output is known independently of the firmware code.
+#
+# python3 make_captures.py      (run in this directory)
+
+import random
+
+# Same limits as the firmware (icy.h)
+ICY_METADATA_SIZE = 256
+ICY_TITLE_SIZE = 128
+
+# MPEG1 layer 3 bitrates in kbit/s and sample rates in Hz
+MPEG1_L3_BITRATES = [0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320]
+MPEG1_SAMPLE_RATES = [44100, 48000, 32000]
+ADTS_SAMPLE_RATES = [96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350]
+
+
+def payload(rng, length):
+    return bytes(rng.randrange(256) for _ in range(length))
+
+
+def frame_payload(rng, length):
+    # Without 0xFF the only sync words are real frame headers, so the search result is known
+    return bytes(rng.randrange(255) for _ in range(length))
+
+
+def mpeg_frames(rng, count, bitrate_index, sample_rate=44100, payload=frame_payload):
+    # MPEG1 layer 3, no CRC, joint stereo. Padding as encoders set it (average bitrate is exact).
+    rate_index = MPEG1_SAMPLE_RATES.index(sample_rate)
+    frames = []
+    rest = 0
+    for i in range(count):
+        index = bitrate_index(i)
+        bitrate = MPEG1_L3_BITRATES[index]
+        length = 144000 * bitrate // sample_rate
+        rest += 144000 * bitrate % sample_rate
+        padding = 0
+        if rest >= sample_rate:
+            rest -= sample_rate
+            padding = 1
+        header = bytes([0xFF, 0xFB, (index << 4) | (rate_index << 2) | (padding << 1), 0x64])
+        frames.append(header + payload(rng, length + padding - len(header)))
+    return frames
+
+
+def adts_frames(rng, count, sample_rate=44100):
+    # AAC LC stereo, no CRC, one raw data block (1024 samples) per frame. Frame size varies like VBR AAC.
+    rate_index = ADTS_SAMPLE_RATES.index(sample_rate)
+    frames = []
+    for i in range(count):
+        length = rng.randrange(250, 450)
+        header = bytes([
+            0xFF, 0xF1,
+            (1 << 6) | (rate_index << 2) | (2 >> 2),
+            ((2 & 3) << 6) | (length >> 11),
+            (length >> 3) & 0xFF,
+            ((length & 7) << 5) | 0x1F,
+            0xFC])
+        frames.append(header + frame_payload(rng, length - len(header)))
+    return frames
+
+
+def write_expect(name, values):
+    with open(name + '.expect', 'w') as f:
+        for key, value in values:
+            f.write('%s %u\n' % (key, value))
+
+
+def write_fsync(name, format_id, sample_rate, samples, garbage, frames, dropped=1):
+    # Capture starts within a frame (garbage). First header found is only a candidate: Its frame is dropped,
+    # the next header confirms it. Expected output are the complete frames behind it.
+    stream = garbage + b''.join(frames)
+    played = frames[dropped:]
+    audio = b''.join(played)
+    duration = len(played) * samples / sample_rate
+    open(name + '.bin', 'wb').write(stream)
+    open(name + '.audio', 'wb').write(audio)
+    write_expect(name, [
+        ('format', format_id),
+        ('sample_rate', sample_rate),
+        ('frames', len(played)),
+        ('sync_lost', 0),
+        ('discarded', len(garbage) + sum(len(f) for f in frames[:dropped])),
+        ('bitrate', round(len(audio) * 8 / duration / 1000))])
+
+
+def mpeg_crc32(data):
+    # CRC of PSI sections (not checked by the demultiplexer, but real streams have it)
+    crc = 0xFFFFFFFF
+    for byte in data:
+        crc ^= byte << 24
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x04C11DB7) if crc & 0x80000000 else (crc << 1)
+            crc &= 0xFFFFFFFF
+    return crc.to_bytes(4, 'big')
+
+
+class TransportStream:
+    # MPEG-TS with PAT, PMT (video and audio stream), audio PES packets, video and null packets
+
+    def __init__(self):
+        self.data = bytearray()
+        self.counter = {}
+
+    def packet(self, pid, payload, start=False):
+        # Short payload is completed by adaptation field stuffing
+        counter = self.counter.get(pid, 0)
+        self.counter[pid] = (counter + 1) & 0x0F
+        header = bytes([0x47, (0x40 if start else 0) | (pid >> 8), pid & 0xFF])
+        if len(payload) == 184:
+            self.data += header + bytes([0x10 | counter]) + payload
+            return
+        stuffing = 183 - len(payload)
+        adaptation = bytes([stuffing]) + (bytes([0x00]) + b'\xFF' * (stuffing - 1) if stuffing else b'')
+        control = 0x30 if payload else 0x20
+        self.data += header + bytes([control | counter]) + adaptation + payload
+
+    def section(self, pid, table_id, body):
+        length = len(body) + 4
+        table = bytes([table_id, 0xB0 | (length >> 8), length & 0xFF]) + body
+        self.packet(pid, bytes([0]) + table + mpeg_crc32(table), True)
+
+    def pat(self, pmt_pid):
+        # Network information (program 0) in front of the program
+        self.section(0, 0x00, bytes([0x00, 0x01, 0xC1, 0, 0, 0x00, 0x00, 0xE0, 0x10, 0x00, 0x01,
+                                     0xE0 | (pmt_pid >> 8), pmt_pid & 0xFF]))
+
+    def pmt(self, pmt_pid, video_pid, audio_pid, audio_type):
+        # Program and stream descriptors have to be skipped
+        program_info = bytes([0x05, 0x04]) + b'HDMV'
+        video_info = bytes([0x28, 0x04, 0x64, 0x00, 0x1F, 0x3F])
+        body = bytes([0x00, 0x01, 0xC1, 0, 0, 0xE0 | (video_pid >> 8), video_pid & 0xFF, 0xF0, len(program_info)])
+        body += program_info
+        body += bytes([0x1B, 0xE0 | (video_pid >> 8), video_pid & 0xFF, 0xF0, len(video_info)]) + video_info
+        body += bytes([audio_type, 0xE0 | (audio_pid >> 8), audio_pid & 0xFF, 0xF0, 0x00])
+        self.section(pmt_pid, 0x02, body)
+
+    def pes(self, pid, stream_id, payload, pts):
+        # PES header with PTS, payload split into packets
+        header = bytes([0, 0, 1, stream_id]) + (len(payload) + 8).to_bytes(2, 'big') + bytes([0x80, 0x80, 0x05])
+        header += bytes([0x21 | ((pts >> 29) & 0x0E), (pts >> 22) & 0xFF, 0x01 | ((pts >> 14) & 0xFE),
+                         (pts >> 7) & 0xFF, 0x01 | ((pts << 1) & 0xFE)])
+        data = header + payload
+        start = True
+        while data:
+            self.packet(pid, data[:184], start)
+            data = data[184:]
+            start = False
+
+
+def write_ts(name):
+    rng = random.Random(name)
+    pmt_pid, video_pid, audio_pid = 0x1000, 0x0100, 0x0101
+    ts = TransportStream()
+    audio = b''
+    discarded = 0
+    for i in range(60):
+        if i % 20 == 0:
+            ts.pat(pmt_pid)
+            ts.pmt(pmt_pid, video_pid, audio_pid, 0x0F)
+        if i % 3 == 0:
+            ts.pes(video_pid, 0xE0, payload(rng, rng.randrange(100, 600)), i * 3000)
+        if i % 7 == 0:
+            ts.packet(0x1FFF, b'\xFF' * 184)
+        if i == 25:
+            # Audio packet with adaptation field only
+            ts.packet(audio_pid, b'')
+        if i == 40:
+            # Stray bytes between packets => Demultiplexer has to search the next sync byte
+            junk = bytes(rng.randrange(0x48, 0x100) for _ in range(5))
+            ts.data += junk
+            discarded += len(junk)
+        frames = b''.join(adts_frames(rng, 2))
+        ts.pes(audio_pid, 0xC0, frames, i * 1920)
+        audio += frames
+    open(name + '.bin', 'wb').write(ts.data)
+    open(name + '.audio', 'wb').write(audio)
+    write_expect(name, [('discarded', discarded)])
+
+
+def icy_block(text):
+    # Length byte in 16 byte units, content padded with zeros
+    data = text.encode('latin-1')
+    blocks = (len(data) + 15) // 16
+    return bytes([blocks]) + data + bytes(blocks * 16 - len(data))
+
+
+def icy_title(block, title):
+    # Title the parser reports after a metadata block: Only the first ICY_METADATA_SIZE - 1 bytes are kept,
+    # the title ends at "';" or at the end of the stored text
+    stored = block[1:][:ICY_METADATA_SIZE - 1].split(b'\0')[0]
+    start = stored.find(b"StreamTitle='")
+    if start < 0:
+        return title
+    stored = stored[start + len("StreamTitle='"):]
+    end = stored.find(b"';")
+    if end >= 0:
+        stored = stored[:end]
+    return stored[:ICY_TITLE_SIZE - 1].decode('latin-1')
+
+
+def write_icy(name, metaint, metadata, tail):
+    # metadata: Text of each metadata block (None = empty block with length byte 0)
+    rng = random.Random(name)
+    stream = bytearray()
+    audio = bytearray()
+    titles = []
+    title = ''
+    for text in metadata:
+        part = payload(rng, metaint)
+        stream += part
+        audio += part
+        block = icy_block(text) if text is not None else b'\0'
+        stream += block
+        new_title = icy_title(block, title)
+        if new_title != title:
+            title = new_title
+            titles.append((len(audio), title))
+    part = payload(rng, tail)
+    stream += part
+    audio += part
+    open(name + '.bin', 'wb').write(stream)
+    open(name + '.audio', 'wb').write(audio)
+    with open(name + '.titles', 'w', encoding='latin-1') as f:
+        for offset, text in titles:
+            f.write('%u %s\n' % (offset, text))
+
+
+def main():
+    long_title = 'Very long title ' * 20
+    write_icy('icy_metadata', 1000, [
+        "StreamTitle='Artist - Song';StreamUrl='';",
+        None,
+        "StreamTitle='Artist - Song';StreamUrl='';",
+        "StreamTitle='It's a title';",
+        "StreamTitle='Semicolon;inside';StreamUrl='http://example.com';",
+        "StreamUrl='http://example.com/only-url';",
+        "StreamTitle='" + long_title + "';",
+        None,
+        "StreamTitle='';",
+        "StreamTitle='Last one';",
+    ], 777)
+    # Longest possible metadata block (255 * 16 bytes), title stays within the stored part
+    write_icy('icy_long_block', 4096, [
+        "StreamTitle='Before';",
+        "StreamTitle='Long block';" + 'x' * 4000,
+        "StreamTitle='After';",
+    ], 100)
+
+    rng = random.Random('fsync')
+    # Constant bitrate: 128 kbit/s, frames of 417 and 418 bytes
+    write_fsync('fsync_mpeg_cbr', 1, 44100, 1152, frame_payload(rng, 211), mpeg_frames(rng, 30, lambda i: 9))
+    # Variable bitrate: Bitrate index changes from frame to frame (32..320 kbit/s)
+    vbr = [rng.randrange(1, 15) for _ in range(40)]
+    write_fsync('fsync_mpeg_vbr', 1, 44100, 1152, frame_payload(rng, 97), mpeg_frames(rng, 40, lambda i: vbr[i]))
+    write_fsync('fsync_adts', 2, 44100, 1024, frame_payload(rng, 150), adts_frames(rng, 40))
+
+    # Gap in a VBR stream (data dropped): Cut 100 bytes into frame 15, continue in the middle of frame 24.
+    # With FSYNC_u32Discontinuity() at the cut the decoder gets frames 1..14 and 25..39 (frame 0 is the candidate).
+    vbr = [rng.randrange(1, 15) for _ in range(40)]
+    frames = mpeg_frames(rng, 40, lambda i: vbr[i])
+    garbage = frame_payload(rng, 50)
+    before = garbage + b''.join(frames[:15]) + frames[15][:100]
+    resume = len(frames[24]) // 2
+    after = frames[24][resume:] + b''.join(frames[25:])
+    open('fsync_discontinuity.bin', 'wb').write(before + after)
+    open('fsync_discontinuity.audio', 'wb').write(b''.join(frames[1:15] + frames[25:]))
+    played = frames[1:16] + frames[25:]
+    write_expect('fsync_discontinuity', [
+        ('format', 1),
+        ('sample_rate', 44100),
+        ('frames', len(played)),
+        ('sync_lost', 0),
+        ('discarded', len(garbage) + len(frames[0]) + 100 + len(frames[24]) - resume),
+        ('bitrate', round(sum(len(f) for f in played) * 8 / (len(played) * 1152 / 44100) / 1000)),
+        ('cut', len(before)),
+        ('partial', 100),
+        # Without the call the parser has to find back to the frames behind the gap
+        ('tail', sum(len(f) for f in frames[28:]))])
+
+    # Stream starts mid-frame with a sync word in the audio data that looks like a header of the stream
+    # (128 kbit/s, 417 bytes). Its frame covers the header of frame 0, the check behind it fails. Search goes
+    # on in frame 0 (no sync words), frame 1 becomes the candidate and frame 2 confirms it.
+    # Other frames contain sync words like real audio data (not checked while locked).
+    frames = mpeg_frames(rng, 1, lambda i: 9) + mpeg_frames(rng, 39, lambda i: 9, payload=payload)
+    garbage = frame_payload(rng, 10) + bytes([0xFF, 0xFB, 0x90, 0x64]) + payload(rng, 286)
+    write_fsync('fsync_false_sync', 1, 44100, 1152, garbage, frames, dropped=2)
+
+    write_ts('hls_segment')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,45 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Control module replacement for host builds: Audio settings are the defaults of a new device
+
+#include <esp8266.h>
+#include "control.h"
+
+uint8 ICACHE_FLASH_ATTR Control_u8GetVolume(void)
+{
+    return 50;
+}
+
+void ICACHE_FLASH_ATTR Control_vGetEnhancer(Control_tstEnhancerSettings *data)
+{
+    data->TrebleAmp = 0;
+    data->TrebleLim = 0;
+    data->BassAmp = 0;
+    data->BassLim = 0;
+}
+
+Control_tenSpartialProcessing ICACHE_FLASH_ATTR Control_u8GetSpartialProcessingLevel(void)
+{
+    return Control_enSpartialProcessing_Off;
+}
@@ -0,0 +1,232 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <esp8266.h>
+#include "sdk.h"
+#include "icecast.h"
+
+typedef struct
+{
+    ICE_tstServer *server;
+    SDK_tstSocket *socket;
+    char request[ICE_REQUEST_SIZE];
+    uint32 request_length;
+    bool streaming;
+    bool metadata; // Client sent Icy-MetaData:1
+    uint64 start_time; // Response has been sent
+    uint64 accept_time;
+    uint64 audio_sent;
+    uint32 frame_offset; // Position within current frame
+    uint32 frame_size;
+    uint32 padding; // Fractional part of frame size (Hz)
+    uint32 meta_count; // Audio bytes since last metadata block
+    uint32 title;
+    os_timer_t timer;
+} ICE_tstClient;
+
+static void ICE_vNextFrame(ICE_tstClient *client)
+{
+    uint32 size = 144000 * client->server->config.bitrate;
+
+    // 1152 samples per frame, padding byte keeps the average at the bitrate
+    client->padding += size % 44100;
+    client->frame_size = size / 44100;
+    if (client->padding >= 44100)
+    {
+        client->padding -= 44100;
+        client->frame_size++;
+    }
+    client->frame_offset = 0;
+}
+
+static uint8 ICE_u8AudioByte(ICE_tstClient *client)
+{
+    static const uint16 bitrates[] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+    uint32 offset = client->frame_offset;
+    uint8 index = 0;
+    uint8 value;
+
+    if (offset >= client->frame_size)
+    {
+        ICE_vNextFrame(client);
+        offset = 0;
+    }
+    while ((index < sizeof(bitrates) / sizeof(bitrates[0]) - 1) && (bitrates[index] != client->server->config.bitrate))
+        index++;
+    // Header of MPEG1 layer 3 without CRC, 44.1 kHz, joint stereo. Payload never contains 0xFF (no false sync).
+    if (offset == 0)
+        value = 0xFF;
+    else if (offset == 1)
+        value = 0xFB;
+    else if (offset == 2)
+        value = (index << 4) | ((client->frame_size != 144000 * client->server->config.bitrate / 44100) ? 0x02 : 0x00);
+    else if (offset == 3)
+        value = 0x64;
+    else
+        value = (offset * 7) % 255;
+    client->frame_offset++;
+    return value;
+}
+
+static uint32 ICE_u32Metadata(ICE_tstClient *client, uint8 *buffer)
+{
+    uint32 length;
+    uint8 blocks;
+
+    // Title changes from time to time, the other blocks are empty (as Icecast sends them)
+    if ((client->audio_sent / ICE_TITLE_BYTES) == client->title)
+    {
+        buffer[0] = 0;
+        return 1;
+    }
+    client->title = client->audio_sent / ICE_TITLE_BYTES;
+    length = os_sprintf((char*)&buffer[1], "StreamTitle='Song %u';", (unsigned)client->title);
+    blocks = (length + 15) / 16;
+    os_memset(&buffer[1 + length], 0, blocks * 16 - length);
+    buffer[0] = blocks;
+    client->server->statistics.metadata_blocks++;
+    return 1 + blocks * 16;
+}
+
+static void ICE_vSend(void *arg)
+{
+    static uint8 buffer[16384];
+    ICE_tstClient *client = arg;
+    ICE_tstConfig *config = &client->server->config;
+    uint64 now = SDK_u64GetTime();
+    uint64 elapsed = now - client->start_time;
+    uint64 due;
+    uint32 space;
+    uint32 length = 0;
+
+    if ((config->disconnect != 0) && (now - client->accept_time >= config->disconnect))
+    {
+        client->server->statistics.disconnects++;
+        SDK_vSocketClose(client->socket);
+        return;
+    }
+    os_timer_arm_us(&client->timer, ICE_TICK_US + ((config->jitter != 0) ? os_random() % config->jitter : 0), 0);
+    if ((config->stall_duration != 0) && (now - client->accept_time >= config->stall_start)
+        && (now - client->accept_time < (uint64)config->stall_start + config->stall_duration))
+        return;
+
+    // Like Icecast: Burst at start, afterwards at bitrate. Data held back by a stall or a full window follows at once.
+    due = config->burst + elapsed * config->bitrate * 125 / 1000000;
+    space = SDK_u32GetSocketSpace(client->socket);
+    if (space > sizeof(buffer))
+        space = sizeof(buffer);
+    // Room for one metadata block (at most 1 + 255 * 16 bytes) is kept free
+    while ((client->audio_sent < due) && (length + 1 + 255 * 16 < space))
+    {
+        if (client->metadata && (client->meta_count == config->metaint))
+        {
+            length += ICE_u32Metadata(client, &buffer[length]);
+            client->meta_count = 0;
+        }
+        buffer[length++] = ICE_u8AudioByte(client);
+        client->audio_sent++;
+        client->meta_count++;
+    }
+    client->server->statistics.audio_bytes += SDK_u32SocketSend(client->socket, buffer, length);
+}
+
+static void ICE_vRespond(ICE_tstClient *client)
+{
+    ICE_tstConfig *config = &client->server->config;
+    const char *field = os_strstr(client->request, "\r\nIcy-MetaData:");
+    char response[256];
+    uint32 length;
+
+    client->server->statistics.requests++;
+    if (field != NULL)
+    {
+        field += os_strlen("\r\nIcy-MetaData:");
+        while (*field == ' ')
+            field++;
+        client->metadata = (*field == '1') && (config->metaint != 0);
+    }
+    length = os_sprintf(response, "ICY 200 OK\r\nicy-name: Simulated Station\r\nContent-Type: audio/mpeg\r\nicy-br: %u\r\n", config->bitrate);
+    if (client->metadata)
+        length += os_sprintf(&response[length], "icy-metaint: %u\r\n", (unsigned)config->metaint);
+    length += os_sprintf(&response[length], "\r\n");
+    SDK_u32SocketSend(client->socket, response, length);
+
+    client->streaming = 1;
+    client->start_time = SDK_u64GetTime();
+    ICE_vNextFrame(client);
+    os_timer_setfn(&client->timer, ICE_vSend, client);
+    ICE_vSend(client);
+}
+
+static void ICE_vAccept(void *arg, SDK_tstSocket *socket)
+{
+    ICE_tstServer *server = arg;
+    ICE_tstClient *client = calloc(1, sizeof(ICE_tstClient));
+
+    server->statistics.connections++;
+    client->server = server;
+    client->socket = socket;
+    client->accept_time = SDK_u64GetTime();
+    SDK_vSetSocketArg(socket, client);
+}
+
+static void ICE_vReceive(void *arg, SDK_tstSocket *socket, const char *data, uint32 len)
+{
+    ICE_tstClient *client = SDK_pvGetSocketArg(socket);
+
+    if (client->streaming)
+        return;
+    if (client->request_length + len >= sizeof(client->request))
+    {
+        SDK_vSocketAbort(socket);
+        return;
+    }
+    os_memcpy(&client->request[client->request_length], data, len);
+    client->request_length += len;
+    client->request[client->request_length] = '\0';
+    // Header is complete
+    if (os_strstr(client->request, "\r\n\r\n") != NULL)
+    {
+        if (os_strncmp(client->request, "GET ", 4) == 0)
+            ICE_vRespond(client);
+        else
+            SDK_vSocketAbort(socket);
+    }
+}
+
+static void ICE_vClose(void *arg, SDK_tstSocket *socket)
+{
+    ICE_tstClient *client = SDK_pvGetSocketArg(socket);
+
+    os_timer_disarm(&client->timer);
+    free(client);
+}
+
+bool ICE_bInit(ICE_tstServer *server, const ICE_tstConfig *config, const char *ip, uint16 port)
+{
+    static const SDK_tstServer callbacks = { ICE_vAccept, ICE_vReceive, ICE_vClose };
+
+    os_memset(server, 0, sizeof(ICE_tstServer));
+    server->config = *config;
+    return SDK_bListen(ip, port, &callbacks, server);
+}
@@ -0,0 +1,68 @@
+#ifndef HOST_ICECAST_H_
+#define HOST_ICECAST_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Stand-in for an Icecast server on the simulated network. Answers every GET with an endless MP3 stream
+// (MPEG1 layer 3, 44.1 kHz, CBR) and ICY metadata if the client asks for it. The knobs reproduce what
+// real servers and links do to a stream: initial burst, bunched delivery, stalls and closed connections.
+
+#include "c_types.h"
+#include "sdk.h"
+
+// Server checks how much data is due this often (plus jitter)
+#define ICE_TICK_US             10000
+#define ICE_REQUEST_SIZE        512
+// Audio bytes between two title changes
+#define ICE_TITLE_BYTES         100000
+
+typedef struct
+{
+    uint16 bitrate; // kbit/s
+    uint32 metaint; // Audio bytes between metadata blocks (0 = no metadata)
+    uint32 burst; // Bytes sent right after the response header (burst-size of Icecast)
+    uint32 jitter; // Each send is delayed by up to this time in us
+    uint32 stall_start; // Sending stops this long after the connection has been accepted in us (0 = never)
+    uint32 stall_duration; // in us
+    uint32 disconnect; // Connection is closed this long after it has been accepted in us (0 = never)
+} ICE_tstConfig;
+
+typedef struct
+{
+    uint32 connections;
+    uint32 requests;
+    uint32 disconnects; // Closed by the server (disconnect knob)
+    uint64 audio_bytes;
+    uint32 metadata_blocks;
+} ICE_tstStatistics;
+
+typedef struct ICE_tstServer
+{
+    ICE_tstConfig config;
+    ICE_tstStatistics statistics;
+} ICE_tstServer;
+
+bool ICE_bInit(ICE_tstServer *server, const ICE_tstConfig *config, const char *ip, uint16 port);
+
+#endif /* HOST_ICECAST_H_ */
@@ -0,0 +1,44 @@
+#ifndef HOST_EAGLE_SOC_H_
+#define HOST_EAGLE_SOC_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Host replacement of eagle_soc.h: Pin multiplexing has no effect on the host
+
+#include "c_types.h"
+
+#define PERIPHS_IO_MUX_GPIO0_U  0
+#define PERIPHS_IO_MUX_GPIO2_U  2
+#define PERIPHS_IO_MUX_GPIO4_U  4
+#define PERIPHS_IO_MUX_GPIO5_U  5
+#define PERIPHS_IO_MUX_MTDO_U   15
+#define FUNC_GPIO0              0
+#define FUNC_GPIO2              0
+#define FUNC_GPIO4              0
+#define FUNC_GPIO5              0
+#define FUNC_GPIO15             3
+
+#define PIN_FUNC_SELECT(pin_name, func)     ((void)(pin_name), (void)(func))
+
+#endif /* HOST_EAGLE_SOC_H_ */
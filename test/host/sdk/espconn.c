@@ -0,0 +1,621 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Simulated network for the espconn API. DNS lookups take a fixed time, TCP connections go to servers
+// registered by the test (SDK_vListen). Data of a server reaches the client in segments of one MSS at
+// link speed after the one way latency. Like lwIP, data stays in the TCP window while receiving is on
+// hold, so the server can't send more than the window until the client continues receiving.
+// Callbacks are called from the timer of the connection, the same way the SDK calls them from its task.
+
+#include <esp8266.h>
+#include "sdk.h"
+
+#define NET_SOCKET_COUNT    8
+#define NET_HOST_COUNT      8
+#define NET_LISTEN_COUNT    8
+#define NET_LOOKUP_COUNT    8
+#define NET_MSS             1460
+#define NET_REQUEST_SIZE    1024
+
+typedef enum
+{
+    NET_enStateConnecting,
+    NET_enStateEstablished
+} NET_tenState;
+
+struct SDK_tstSocket
+{
+    bool used;
+    uint32 generation; // Changes whenever the socket is released (detects release within callbacks)
+    struct espconn *conn;
+    const SDK_tstServer *server; // NULL if nobody listens => Connection is refused
+    void *server_arg;
+    void *arg; // Set by the server
+    NET_tenState state;
+    uint64 connect_time;
+    bool held;
+    bool client_closed;
+    bool server_closed;
+    bool aborted;
+    // Request of client on the way to the server
+    char request[NET_REQUEST_SIZE];
+    uint32 request_length;
+    uint64 request_time;
+    uint64 sent_time; // Sent callback is due (0 = none)
+    // Data of server on the way to the client (TCP window)
+    uint8 *queue;
+    uint32 length;
+    uint64 next_delivery;
+    os_timer_t timer;
+};
+
+typedef struct
+{
+    char hostname[64];
+    ip_addr_t ip;
+} NET_tstHost;
+
+typedef struct
+{
+    ip_addr_t ip;
+    uint16 port;
+    const SDK_tstServer *server;
+    void *arg;
+} NET_tstListen;
+
+typedef struct
+{
+    bool used;
+    char hostname[64];
+    bool found;
+    ip_addr_t ip;
+    dns_found_callback callback;
+    void *arg;
+    os_timer_t timer;
+} NET_tstLookup;
+
+static SDK_tstNetwork NET_stConfig = { 20000, 1000000, 5840, 30000 };
+static SDK_tstSocket NET_astSocket[NET_SOCKET_COUNT];
+static NET_tstHost NET_astHost[NET_HOST_COUNT];
+static uint8 NET_u8HostCount;
+static NET_tstListen NET_astListen[NET_LISTEN_COUNT];
+static uint8 NET_u8ListenCount;
+static NET_tstLookup NET_astLookup[NET_LOOKUP_COUNT];
+static SDK_tstNetworkStatistics NET_stStatistics;
+static uint16 NET_u16Port = 50000;
+
+static bool NET_bParseIp(const char *text, ip_addr_t *ip)
+{
+    unsigned a, b, c, d;
+    char end;
+
+    if (sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4)
+        return 0;
+    if ((a > 255) || (b > 255) || (c > 255) || (d > 255))
+        return 0;
+    IP4_ADDR(ip, a, b, c, d);
+    return 1;
+}
+
+static SDK_tstSocket *NET_pstFind(struct espconn *conn)
+{
+    uint8 i;
+
+    for (i = 0; i < NET_SOCKET_COUNT; i++)
+    {
+        if (NET_astSocket[i].used && (NET_astSocket[i].conn == conn))
+            return &NET_astSocket[i];
+    }
+    return NULL;
+}
+
+static bool NET_bValid(SDK_tstSocket *socket, struct espconn *conn, uint32 generation)
+{
+    // Client might have deleted or reused the connection within a callback
+    return socket->used && (socket->conn == conn) && (socket->generation == generation);
+}
+
+static void NET_vRelease(SDK_tstSocket *socket)
+{
+    // Server forgets the connection first, then the slot can be reused by a callback of the client
+    if ((socket->state == NET_enStateEstablished) && (socket->server != NULL) && (socket->server->close != NULL))
+        socket->server->close(socket->server_arg, socket);
+    os_timer_disarm(&socket->timer);
+    free(socket->queue);
+    socket->queue = NULL;
+    socket->used = 0;
+    socket->generation++;
+}
+
+static void NET_vSchedule(SDK_tstSocket *socket, uint64 time)
+{
+    uint64 now = SDK_u64GetTime();
+
+    os_timer_arm_us(&socket->timer, (time > now) ? (uint32)(time - now) : 0, 0);
+}
+
+static void NET_vReschedule(SDK_tstSocket *socket)
+{
+    uint64 next = UINT64_MAX;
+
+    if (socket->state == NET_enStateConnecting)
+        next = socket->connect_time;
+    if (socket->client_closed || socket->aborted)
+        next = SDK_u64GetTime();
+    if ((socket->request_length != 0) && (socket->request_time < next))
+        next = socket->request_time;
+    if ((socket->sent_time != 0) && (socket->sent_time < next))
+        next = socket->sent_time;
+    if (!socket->held && ((socket->length != 0) || socket->server_closed) && (socket->next_delivery < next))
+        next = socket->next_delivery;
+    if (next != UINT64_MAX)
+        NET_vSchedule(socket, next);
+    else
+        os_timer_disarm(&socket->timer);
+}
+
+static void NET_vProcess(void *arg)
+{
+    static char segment[NET_MSS];
+    SDK_tstSocket *socket = arg;
+    struct espconn *conn = socket->conn;
+    uint32 generation = socket->generation;
+    uint64 now = SDK_u64GetTime();
+    uint32 count;
+
+    if (socket->state == NET_enStateConnecting)
+    {
+        if (socket->client_closed || (now < socket->connect_time))
+        {
+            if (socket->client_closed)
+                NET_vRelease(socket);
+            else
+                NET_vReschedule(socket);
+            return;
+        }
+        if (socket->server == NULL)
+        {
+            // Nobody listens => Connection refused
+            NET_stStatistics.refused++;
+            NET_vRelease(socket);
+            conn->state = ESPCONN_CLOSE;
+            if (conn->proto.tcp->reconnect_callback != NULL)
+                conn->proto.tcp->reconnect_callback(conn, ESPCONN_RST);
+            return;
+        }
+        socket->state = NET_enStateEstablished;
+        conn->state = ESPCONN_CONNECT;
+        NET_stStatistics.connections++;
+        if (socket->server->accept != NULL)
+            socket->server->accept(socket->server_arg, socket);
+        if (conn->proto.tcp->connect_callback != NULL)
+            conn->proto.tcp->connect_callback(conn);
+        if (!NET_bValid(socket, conn, generation))
+            return;
+    }
+
+    if (socket->client_closed)
+    {
+        NET_vRelease(socket);
+        conn->state = ESPCONN_CLOSE;
+        if (conn->proto.tcp->disconnect_callback != NULL)
+            conn->proto.tcp->disconnect_callback(conn);
+        return;
+    }
+    if (socket->aborted)
+    {
+        // Reset by server => Error callback instead of disconnect callback
+        NET_vRelease(socket);
+        conn->state = ESPCONN_CLOSE;
+        if (conn->proto.tcp->reconnect_callback != NULL)
+            conn->proto.tcp->reconnect_callback(conn, ESPCONN_RST);
+        return;
+    }
+
+    if ((socket->request_length != 0) && (socket->request_time <= now))
+    {
+        // Server gets the request in one piece
+        count = socket->request_length;
+        socket->request_length = 0;
+        if (socket->server->receive != NULL)
+            socket->server->receive(socket->server_arg, socket, socket->request, count);
+        if (!NET_bValid(socket, conn, generation))
+            return;
+    }
+    if ((socket->sent_time != 0) && (socket->sent_time <= now))
+    {
+        socket->sent_time = 0;
+        if (conn->sent_callback != NULL)
+            conn->sent_callback(conn);
+        if (!NET_bValid(socket, conn, generation))
+            return;
+    }
+
+    if (!socket->held && (socket->length != 0) && (socket->next_delivery <= now))
+    {
+        // One segment per call, next one after it has been transferred at link speed
+        count = (socket->length < NET_MSS) ? socket->length : NET_MSS;
+        os_memcpy(segment, socket->queue, count);
+        os_memmove(socket->queue, socket->queue + count, socket->length - count);
+        socket->length -= count;
+        socket->next_delivery = now + (uint64)count * 1000000 / NET_stConfig.rate;
+        NET_stStatistics.segments++;
+        NET_stStatistics.bytes += count;
+        if (conn->recv_callback != NULL)
+            conn->recv_callback(conn, segment, count);
+        if (!NET_bValid(socket, conn, generation))
+            return;
+    }
+
+    if (!socket->held && (socket->length == 0) && socket->server_closed && (socket->next_delivery <= now))
+    {
+        // All data has been received => Server closed the connection
+        NET_vRelease(socket);
+        conn->state = ESPCONN_CLOSE;
+        if (conn->proto.tcp->disconnect_callback != NULL)
+            conn->proto.tcp->disconnect_callback(conn);
+        return;
+    }
+    NET_vReschedule(socket);
+}
+
+sint8 espconn_connect(struct espconn *espconn)
+{
+    SDK_tstSocket *socket = NULL;
+    ip_addr_t ip;
+    uint8 i;
+
+    if ((espconn == NULL) || (espconn->type != ESPCONN_TCP) || (espconn->proto.tcp == NULL))
+        return ESPCONN_ARG;
+    if (NET_pstFind(espconn) != NULL)
+        return ESPCONN_ISCONN;
+    for (i = 0; i < NET_SOCKET_COUNT; i++)
+    {
+        if (!NET_astSocket[i].used)
+        {
+            socket = &NET_astSocket[i];
+            break;
+        }
+    }
+    if (socket == NULL)
+        return ESPCONN_MEM;
+
+    socket->used = 1;
+    socket->conn = espconn;
+    socket->server = NULL;
+    socket->server_arg = NULL;
+    socket->arg = NULL;
+    os_memcpy(&ip.addr, espconn->proto.tcp->remote_ip, 4);
+    for (i = 0; i < NET_u8ListenCount; i++)
+    {
+        if ((NET_astListen[i].ip.addr == ip.addr) && (NET_astListen[i].port == espconn->proto.tcp->remote_port))
+        {
+            socket->server = NET_astListen[i].server;
+            socket->server_arg = NET_astListen[i].arg;
+        }
+    }
+    // Handshake takes a round trip
+    socket->state = NET_enStateConnecting;
+    socket->connect_time = SDK_u64GetTime() + 2 * NET_stConfig.latency;
+    socket->held = 0;
+    socket->client_closed = 0;
+    socket->server_closed = 0;
+    socket->aborted = 0;
+    socket->request_length = 0;
+    socket->sent_time = 0;
+    socket->queue = malloc(NET_stConfig.window);
+    socket->length = 0;
+    socket->next_delivery = 0;
+    os_timer_setfn(&socket->timer, NET_vProcess, socket);
+    NET_vReschedule(socket);
+    espconn->state = ESPCONN_WAIT;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_disconnect(struct espconn *espconn)
+{
+    SDK_tstSocket *socket = NET_pstFind(espconn);
+
+    if (socket == NULL)
+        return ESPCONN_ARG;
+    // Disconnect callback follows
+    socket->client_closed = 1;
+    NET_vReschedule(socket);
+    return ESPCONN_OK;
+}
+
+sint8 espconn_delete(struct espconn *espconn)
+{
+    SDK_tstSocket *socket = NET_pstFind(espconn);
+
+    // Connection has been released already (disconnect callback)
+    if (socket == NULL)
+        return ESPCONN_ARG;
+    NET_vRelease(socket);
+    return ESPCONN_OK;
+}
+
+sint8 espconn_sent(struct espconn *espconn, uint8 *psent, uint16 length)
+{
+    SDK_tstSocket *socket = NET_pstFind(espconn);
+
+    if ((socket == NULL) || (socket->state != NET_enStateEstablished))
+        return ESPCONN_ARG;
+    if (socket->request_length + length > NET_REQUEST_SIZE)
+        return ESPCONN_MEM;
+    os_memcpy(&socket->request[socket->request_length], psent, length);
+    socket->request_length += length;
+    socket->request_time = SDK_u64GetTime() + NET_stConfig.latency;
+    // Acknowledge takes a round trip
+    socket->sent_time = SDK_u64GetTime() + 2 * NET_stConfig.latency;
+    NET_vReschedule(socket);
+    return ESPCONN_OK;
+}
+
+sint8 espconn_regist_connectcb(struct espconn *espconn, espconn_connect_callback connect_cb)
+{
+    espconn->proto.tcp->connect_callback = connect_cb;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_regist_disconcb(struct espconn *espconn, espconn_connect_callback discon_cb)
+{
+    espconn->proto.tcp->disconnect_callback = discon_cb;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_regist_reconcb(struct espconn *espconn, espconn_reconnect_callback recon_cb)
+{
+    espconn->proto.tcp->reconnect_callback = recon_cb;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_regist_recvcb(struct espconn *espconn, espconn_recv_callback recv_cb)
+{
+    espconn->recv_callback = recv_cb;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_regist_sentcb(struct espconn *espconn, espconn_sent_callback sent_cb)
+{
+    espconn->sent_callback = sent_cb;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_recv_hold(struct espconn *pespconn)
+{
+    SDK_tstSocket *socket = NET_pstFind(pespconn);
+
+    if (socket == NULL)
+        return ESPCONN_ARG;
+    socket->held = 1;
+    NET_stStatistics.holds++;
+    NET_vReschedule(socket);
+    return ESPCONN_OK;
+}
+
+sint8 espconn_recv_unhold(struct espconn *pespconn)
+{
+    SDK_tstSocket *socket = NET_pstFind(pespconn);
+
+    if (socket == NULL)
+        return ESPCONN_ARG;
+    socket->held = 0;
+    NET_vReschedule(socket);
+    return ESPCONN_OK;
+}
+
+uint32 espconn_port(void)
+{
+    return NET_u16Port++;
+}
+
+static void NET_vLookupDone(void *arg)
+{
+    NET_tstLookup *lookup = arg;
+
+    lookup->used = 0;
+    lookup->callback(lookup->hostname, lookup->found ? &lookup->ip : NULL, lookup->arg);
+}
+
+err_t espconn_gethostbyname(struct espconn *pespconn, const char *hostname, ip_addr_t *addr, dns_found_callback found)
+{
+    NET_tstLookup *lookup = NULL;
+    uint8 i;
+
+    // Address doesn't need a lookup
+    if (NET_bParseIp(hostname, addr))
+        return ESPCONN_OK;
+    if ((found == NULL) || (os_strlen(hostname) >= sizeof(lookup->hostname)))
+        return ESPCONN_ARG;
+    for (i = 0; i < NET_LOOKUP_COUNT; i++)
+    {
+        if (!NET_astLookup[i].used)
+        {
+            lookup = &NET_astLookup[i];
+            break;
+        }
+    }
+    if (lookup == NULL)
+        return ESPCONN_MEM;
+
+    NET_stStatistics.lookups++;
+    lookup->used = 1;
+    os_strcpy(lookup->hostname, hostname);
+    lookup->found = 0;
+    for (i = 0; i < NET_u8HostCount; i++)
+    {
+        if (os_strcmp(NET_astHost[i].hostname, hostname) == 0)
+        {
+            lookup->found = 1;
+            lookup->ip = NET_astHost[i].ip;
+        }
+    }
+    lookup->callback = found;
+    lookup->arg = pespconn;
+    os_timer_setfn(&lookup->timer, NET_vLookupDone, lookup);
+    os_timer_arm_us(&lookup->timer, NET_stConfig.dns_time, 0);
+    return ESPCONN_INPROGRESS;
+}
+
+sint8 espconn_secure_connect(struct espconn *espconn)
+{
+    return espconn_connect(espconn);
+}
+
+sint8 espconn_secure_disconnect(struct espconn *espconn)
+{
+    return espconn_disconnect(espconn);
+}
+
+sint8 espconn_secure_sent(struct espconn *espconn, uint8 *psent, uint16 length)
+{
+    return espconn_sent(espconn, psent, length);
+}
+
+bool espconn_secure_set_size(uint8 level, uint16 size)
+{
+    return 1;
+}
+
+void SDK_vSetNetwork(const SDK_tstNetwork *network)
+{
+    NET_stConfig = *network;
+}
+
+bool SDK_bAddHost(const char *hostname, const char *ip)
+{
+    NET_tstHost *host;
+
+    if ((NET_u8HostCount == NET_HOST_COUNT) || (os_strlen(hostname) >= sizeof(host->hostname)))
+        return 0;
+    host = &NET_astHost[NET_u8HostCount];
+    if (!NET_bParseIp(ip, &host->ip))
+        return 0;
+    os_strcpy(host->hostname, hostname);
+    NET_u8HostCount++;
+    return 1;
+}
+
+void SDK_vRemoveHost(const char *hostname)
+{
+    uint8 i;
+
+    // Lookups fail from now on (DNS server unreachable)
+    for (i = 0; i < NET_u8HostCount; i++)
+    {
+        if (os_strcmp(NET_astHost[i].hostname, hostname) == 0)
+        {
+            NET_u8HostCount--;
+            os_memmove(&NET_astHost[i], &NET_astHost[i + 1], (NET_u8HostCount - i) * sizeof(NET_tstHost));
+            return;
+        }
+    }
+}
+
+bool SDK_bListen(const char *ip, uint16 port, const SDK_tstServer *server, void *arg)
+{
+    NET_tstListen *listen;
+
+    if (NET_u8ListenCount == NET_LISTEN_COUNT)
+        return 0;
+    listen = &NET_astListen[NET_u8ListenCount];
+    if (!NET_bParseIp(ip, &listen->ip))
+        return 0;
+    listen->port = port;
+    listen->server = server;
+    listen->arg = arg;
+    NET_u8ListenCount++;
+    return 1;
+}
+
+uint32 SDK_u32GetSocketSpace(SDK_tstSocket *socket)
+{
+    if (socket->server_closed || socket->aborted || socket->client_closed)
+        return 0;
+    return NET_stConfig.window - socket->length;
+}
+
+uint32 SDK_u32SocketSend(SDK_tstSocket *socket, const void *data, uint32 len)
+{
+    uint64 arrival = SDK_u64GetTime() + NET_stConfig.latency;
+
+    if (len > SDK_u32GetSocketSpace(socket))
+        len = SDK_u32GetSocketSpace(socket);
+    if (len == 0)
+        return 0;
+    // First byte reaches the client after the latency, the rest follows at link speed
+    if ((socket->length == 0) && (socket->next_delivery < arrival))
+        socket->next_delivery = arrival;
+    os_memcpy(socket->queue + socket->length, data, len);
+    socket->length += len;
+    NET_vReschedule(socket);
+    return len;
+}
+
+void SDK_vSocketClose(SDK_tstSocket *socket)
+{
+    uint64 arrival = SDK_u64GetTime() + NET_stConfig.latency;
+
+    // Client gets the rest of the data, then the disconnect callback
+    socket->server_closed = 1;
+    if ((socket->length == 0) && (socket->next_delivery < arrival))
+        socket->next_delivery = arrival;
+    NET_vReschedule(socket);
+}
+
+void SDK_vSocketAbort(SDK_tstSocket *socket)
+{
+    // Data on the way is lost
+    socket->aborted = 1;
+    socket->length = 0;
+    NET_vReschedule(socket);
+}
+
+void SDK_vSetSocketArg(SDK_tstSocket *socket, void *arg)
+{
+    socket->arg = arg;
+}
+
+void *SDK_pvGetSocketArg(SDK_tstSocket *socket)
+{
+    return socket->arg;
+}
+
+void SDK_vGetNetworkStatistics(SDK_tstNetworkStatistics *statistics)
+{
+    *statistics = NET_stStatistics;
+}
+
+void SDK_vResetNetwork(void)
+{
+    uint8 i;
+
+    for (i = 0; i < NET_SOCKET_COUNT; i++)
+        free(NET_astSocket[i].queue);
+    os_memset(NET_astSocket, 0, sizeof(NET_astSocket));
+    os_memset(NET_astLookup, 0, sizeof(NET_astLookup));
+    NET_u8HostCount = 0;
+    NET_u8ListenCount = 0;
+    os_memset(&NET_stStatistics, 0, sizeof(NET_stStatistics));
+}
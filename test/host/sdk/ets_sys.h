@@ -0,0 +1,41 @@
+#ifndef HOST_ETS_SYS_H_
+#define HOST_ETS_SYS_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Host replacement of ets_sys.h: GPIO interrupt is raised by sdk.c on input edges
+
+#include "c_types.h"
+#include "eagle_soc.h"
+
+typedef void (*ets_isr_t)(void *arg);
+
+void ets_isr_attach_gpio(ets_isr_t handler, void *arg);
+void ets_isr_enable_gpio(bool enable);
+
+#define ETS_GPIO_INTR_ATTACH(func, arg)     ets_isr_attach_gpio((ets_isr_t)(func), (void *)(arg))
+#define ETS_GPIO_INTR_ENABLE()              ets_isr_enable_gpio(1)
+#define ETS_GPIO_INTR_DISABLE()             ets_isr_enable_gpio(0)
+
+#endif /* HOST_ETS_SYS_H_ */
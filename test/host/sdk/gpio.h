@@ -0,0 +1,60 @@
+#ifndef HOST_GPIO_H_
+#define HOST_GPIO_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Host replacement of gpio.h: Pin levels are kept by sdk.c (inputs are driven by models of external chips)
+
+#include "c_types.h"
+
+#define GPIO_PIN_COUNT              16
+#define GPIO_ID_PIN(n)              (n)
+
+// Only the registers needed for interrupt handling
+#define GPIO_STATUS_ADDRESS         0x1C
+#define GPIO_STATUS_W1TC_ADDRESS    0x24
+
+typedef enum
+{
+    GPIO_PIN_INTR_DISABLE = 0,
+    GPIO_PIN_INTR_POSEDGE = 1,
+    GPIO_PIN_INTR_NEGEDGE = 2,
+    GPIO_PIN_INTR_ANYEDGE = 3,
+    GPIO_PIN_INTR_LOLEVEL = 4,
+    GPIO_PIN_INTR_HILEVEL = 5
+} GPIO_INT_TYPE;
+
+void gpio_output_set(uint8 gpio_no, uint8 value);
+uint8 gpio_input_get(uint8 gpio_no);
+uint32 gpio_reg_read(uint32 reg);
+void gpio_reg_write(uint32 reg, uint32 value);
+void gpio_pin_intr_state_set(uint32 i, GPIO_INT_TYPE intr_state);
+
+#define GPIO_OUTPUT_SET(gpio_no, bit_value)     gpio_output_set(gpio_no, bit_value)
+#define GPIO_INPUT_GET(gpio_no)                 gpio_input_get(gpio_no)
+#define GPIO_DIS_OUTPUT(gpio_no)                ((void)(gpio_no))
+#define GPIO_REG_READ(reg)                      gpio_reg_read(reg)
+#define GPIO_REG_WRITE(reg, value)              gpio_reg_write(reg, value)
+
+#endif /* HOST_GPIO_H_ */
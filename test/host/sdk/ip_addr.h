@@ -0,0 +1,47 @@
+#ifndef HOST_IP_ADDR_H_
+#define HOST_IP_ADDR_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Host replacement of ip_addr.h (lwIP address type as used by the SDK)
+
+#include "c_types.h"
+
+typedef struct ip_addr
+{
+    uint32 addr; // Network byte order
+} ip_addr_t;
+
+#define IP4_ADDR(ipaddr, a, b, c, d) \
+    (ipaddr)->addr = ((uint32)((d) & 0xff) << 24) | ((uint32)((c) & 0xff) << 16) | ((uint32)((b) & 0xff) << 8) | (uint32)((a) & 0xff)
+
+#define ip4_addr1(ipaddr)   (((const uint8*)(ipaddr))[0])
+#define ip4_addr2(ipaddr)   (((const uint8*)(ipaddr))[1])
+#define ip4_addr3(ipaddr)   (((const uint8*)(ipaddr))[2])
+#define ip4_addr4(ipaddr)   (((const uint8*)(ipaddr))[3])
+
+#define IPSTR "%d.%d.%d.%d"
+#define IP2STR(ipaddr) ip4_addr1(ipaddr), ip4_addr2(ipaddr), ip4_addr3(ipaddr), ip4_addr4(ipaddr)
+
+#endif /* HOST_IP_ADDR_H_ */
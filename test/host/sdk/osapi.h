@@ -0,0 +1,69 @@
+#ifndef HOST_OSAPI_H_
+#define HOST_OSAPI_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Host replacement of osapi.h: String functions map to the C library, timers run on the simulated clock of sdk.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c_types.h"
+
+#define os_memcmp       memcmp
+#define os_memcpy       memcpy
+#define os_memmove      memmove
+#define os_memset       memset
+#define os_strcat       strcat
+#define os_strchr       strchr
+#define os_strcmp       strcmp
+#define os_strcpy       strcpy
+#define os_strlen       strlen
+#define os_strncmp      strncmp
+#define os_strncpy      strncpy
+#define os_strstr       strstr
+#define os_sprintf      sprintf
+#define os_printf       printf
+
+typedef void os_timer_func_t(void *timer_arg);
+
+typedef struct _os_timer_t
+{
+    struct _os_timer_t *timer_next; // Next armed timer (sorted by expiry)
+    uint64 timer_expire; // Simulated time of expiry in us
+    uint32 timer_period; // In us (0 = single shot)
+    os_timer_func_t *timer_func;
+    void *timer_arg;
+} os_timer_t;
+
+void os_timer_setfn(os_timer_t *ptimer, os_timer_func_t *pfunction, void *parg);
+void os_timer_arm(os_timer_t *ptimer, uint32 milliseconds, bool repeat_flag);
+void os_timer_arm_us(os_timer_t *ptimer, uint32 microseconds, bool repeat_flag);
+void os_timer_disarm(os_timer_t *ptimer);
+unsigned long os_random(void);
+
+// Firmware output goes through the UART driver
+void myprintf(const char *format, ...);
+
+#endif /* HOST_OSAPI_H_ */
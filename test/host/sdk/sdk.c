@@ -0,0 +1,355 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Simulated SDK: Non preemptive tasks, software timers and GPIO on a simulated clock
+
+#include <stdarg.h>
+#include <esp8266.h>
+#include "sdk.h"
+
+#define SDK_DEVICE_COUNT    4
+
+typedef struct
+{
+    os_task_t task;
+    os_event_t *queue;
+    uint8 length;
+    uint8 start;
+    uint8 count;
+} SDK_tstTask;
+
+typedef struct
+{
+    SDK_tpfDevicePoll poll;
+    void *arg;
+} SDK_tstDevice;
+
+static uint64 SDK_u64Time;
+static SDK_tstTask SDK_astTask[USER_TASK_PRIO_MAX];
+static os_timer_t *SDK_pstTimers;
+static SDK_tstDevice SDK_astDevice[SDK_DEVICE_COUNT];
+static uint8 SDK_u8DeviceCount;
+static uint32 SDK_u32Random = 1;
+
+static struct
+{
+    uint8 output[GPIO_PIN_COUNT];
+    uint8 input[GPIO_PIN_COUNT];
+    GPIO_INT_TYPE interrupt[GPIO_PIN_COUNT];
+    uint32 status;
+    ets_isr_t handler;
+    void *arg;
+    bool enabled;
+} SDK_stGpio;
+
+uint64 SDK_u64GetTime(void)
+{
+    return SDK_u64Time;
+}
+
+void SDK_vSpend(uint32 us)
+{
+    // CPU time needed by the code that is running right now (busy waiting, SPI transfers)
+    SDK_u64Time += us;
+}
+
+uint32 system_get_time(void)
+{
+    return (uint32)SDK_u64Time;
+}
+
+bool system_os_task(os_task_t task, uint8 prio, os_event_t *queue, uint8 qlen)
+{
+    if ((prio >= USER_TASK_PRIO_MAX) || (qlen == 0))
+        return 0;
+    SDK_astTask[prio].task = task;
+    SDK_astTask[prio].queue = queue;
+    SDK_astTask[prio].length = qlen;
+    SDK_astTask[prio].start = 0;
+    SDK_astTask[prio].count = 0;
+    return 1;
+}
+
+bool system_os_post(uint8 prio, os_signal_t sig, os_param_t par)
+{
+    SDK_tstTask *task;
+
+    if (prio >= USER_TASK_PRIO_MAX)
+        return 0;
+    task = &SDK_astTask[prio];
+    // Queue full (or task not registered) => Event is lost like on the target
+    if ((task->task == NULL) || (task->count == task->length))
+        return 0;
+    task->queue[(task->start + task->count) % task->length].sig = sig;
+    task->queue[(task->start + task->count) % task->length].par = par;
+    task->count++;
+    return 1;
+}
+
+bool SDK_bRunTask(void)
+{
+    SDK_tstTask *task;
+    os_event_t event;
+    sint8 prio;
+
+    // Highest priority first, a task runs to completion
+    for (prio = USER_TASK_PRIO_MAX - 1; prio >= 0; prio--)
+    {
+        task = &SDK_astTask[prio];
+        if (task->count == 0)
+            continue;
+        event = task->queue[task->start];
+        task->start = (task->start + 1) % task->length;
+        task->count--;
+        task->task(&event);
+        return 1;
+    }
+    return 0;
+}
+
+void SDK_vRunTasks(void)
+{
+    while (SDK_bRunTask());
+}
+
+static bool SDK_bTasksPending(void)
+{
+    uint8 prio;
+
+    for (prio = 0; prio < USER_TASK_PRIO_MAX; prio++)
+        if (SDK_astTask[prio].count != 0)
+            return 1;
+    return 0;
+}
+
+static void SDK_vInsertTimer(os_timer_t *ptimer)
+{
+    os_timer_t **next = &SDK_pstTimers;
+
+    // Timers with the same expiry fire in the order they have been armed
+    while ((*next != NULL) && ((*next)->timer_expire <= ptimer->timer_expire))
+        next = &(*next)->timer_next;
+    ptimer->timer_next = *next;
+    *next = ptimer;
+}
+
+void os_timer_disarm(os_timer_t *ptimer)
+{
+    os_timer_t **next = &SDK_pstTimers;
+
+    while (*next != NULL)
+    {
+        if (*next == ptimer)
+        {
+            *next = ptimer->timer_next;
+            break;
+        }
+        next = &(*next)->timer_next;
+    }
+    ptimer->timer_next = NULL;
+}
+
+void os_timer_setfn(os_timer_t *ptimer, os_timer_func_t *pfunction, void *parg)
+{
+    os_timer_disarm(ptimer);
+    ptimer->timer_func = pfunction;
+    ptimer->timer_arg = parg;
+}
+
+void os_timer_arm_us(os_timer_t *ptimer, uint32 microseconds, bool repeat_flag)
+{
+    os_timer_disarm(ptimer);
+    ptimer->timer_expire = SDK_u64Time + microseconds;
+    ptimer->timer_period = repeat_flag ? microseconds : 0;
+    SDK_vInsertTimer(ptimer);
+}
+
+void os_timer_arm(os_timer_t *ptimer, uint32 milliseconds, bool repeat_flag)
+{
+    os_timer_arm_us(ptimer, milliseconds * 1000, repeat_flag);
+}
+
+static bool SDK_bRunTimer(void)
+{
+    os_timer_t *ptimer = SDK_pstTimers;
+
+    if ((ptimer == NULL) || (ptimer->timer_expire > SDK_u64Time))
+        return 0;
+    SDK_pstTimers = ptimer->timer_next;
+    ptimer->timer_next = NULL;
+    if (ptimer->timer_period != 0)
+    {
+        ptimer->timer_expire += ptimer->timer_period;
+        SDK_vInsertTimer(ptimer);
+    }
+    ptimer->timer_func(ptimer->timer_arg);
+    return 1;
+}
+
+uint32 system_get_free_heap_size(void)
+{
+    // Heap of the C library is not limited
+    return 40000;
+}
+
+unsigned long os_random(void)
+{
+    // Deterministic, so every run of a simulation gives the same result
+    SDK_u32Random = SDK_u32Random * 1103515245 + 12345;
+    return SDK_u32Random >> 1;
+}
+
+void myprintf(const char *format, ...)
+{
+    static int verbose = -1;
+    va_list args;
+
+    // Firmware log is only shown on request (SDK_VERBOSE=1)
+    if (verbose < 0)
+        verbose = (getenv("SDK_VERBOSE") != NULL);
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+void SDK_vAddDevice(SDK_tpfDevicePoll poll, void *arg)
+{
+    if (SDK_u8DeviceCount == SDK_DEVICE_COUNT)
+    {
+        fprintf(stderr, "SDK: too many devices\n");
+        abort();
+    }
+    SDK_astDevice[SDK_u8DeviceCount].poll = poll;
+    SDK_astDevice[SDK_u8DeviceCount].arg = arg;
+    SDK_u8DeviceCount++;
+}
+
+void SDK_vRun(uint32 duration)
+{
+    uint64 end = SDK_u64Time + duration;
+    uint64 next;
+    uint64 wakeup;
+    uint8 i;
+
+    for (;;)
+    {
+        SDK_vRunTasks();
+        if (SDK_bRunTimer())
+            continue;
+        // Let devices (models of external chips, network peers) act on the current time
+        next = end;
+        for (i = 0; i < SDK_u8DeviceCount; i++)
+        {
+            wakeup = SDK_astDevice[i].poll(SDK_astDevice[i].arg);
+            if (wakeup < next)
+                next = wakeup;
+        }
+        if (SDK_bTasksPending())
+            continue;
+        if (SDK_u64Time >= end)
+            break;
+        // Idle => Wait for next timer or device event
+        if ((SDK_pstTimers != NULL) && (SDK_pstTimers->timer_expire < next))
+            next = SDK_pstTimers->timer_expire;
+        if (next <= SDK_u64Time)
+            next = SDK_u64Time + 1;
+        SDK_u64Time = next;
+    }
+}
+
+void gpio_output_set(uint8 gpio_no, uint8 value)
+{
+    SDK_stGpio.output[gpio_no] = value ? 1 : 0;
+}
+
+uint8 gpio_input_get(uint8 gpio_no)
+{
+    return SDK_stGpio.input[gpio_no];
+}
+
+uint32 gpio_reg_read(uint32 reg)
+{
+    if (reg == GPIO_STATUS_ADDRESS)
+        return SDK_stGpio.status;
+    return 0;
+}
+
+void gpio_reg_write(uint32 reg, uint32 value)
+{
+    if (reg == GPIO_STATUS_W1TC_ADDRESS)
+        SDK_stGpio.status &= ~value;
+}
+
+void gpio_pin_intr_state_set(uint32 i, GPIO_INT_TYPE intr_state)
+{
+    SDK_stGpio.interrupt[i] = intr_state;
+}
+
+void ets_isr_attach_gpio(ets_isr_t handler, void *arg)
+{
+    SDK_stGpio.handler = handler;
+    SDK_stGpio.arg = arg;
+}
+
+void ets_isr_enable_gpio(bool enable)
+{
+    SDK_stGpio.enabled = enable;
+}
+
+void SDK_vSetGpioInput(uint8 gpio_no, uint8 value)
+{
+    uint8 previous = SDK_stGpio.input[gpio_no];
+    GPIO_INT_TYPE type = SDK_stGpio.interrupt[gpio_no];
+    bool edge;
+
+    value = value ? 1 : 0;
+    SDK_stGpio.input[gpio_no] = value;
+    edge = ((type == GPIO_PIN_INTR_POSEDGE) && !previous && value)
+        || ((type == GPIO_PIN_INTR_NEGEDGE) && previous && !value)
+        || ((type == GPIO_PIN_INTR_ANYEDGE) && (previous != value));
+    if (!edge)
+        return;
+    // Interrupt is executed immediately (it may interrupt a running task like on the target)
+    SDK_stGpio.status |= BIT(gpio_no);
+    if (SDK_stGpio.enabled && (SDK_stGpio.handler != NULL))
+        SDK_stGpio.handler(SDK_stGpio.arg);
+}
+
+uint8 SDK_u8GetGpioOutput(uint8 gpio_no)
+{
+    return SDK_stGpio.output[gpio_no];
+}
+
+void SDK_vReset(void)
+{
+    // Start a new simulation with the same time base
+    SDK_u64Time = 0;
+    SDK_pstTimers = NULL;
+    SDK_u8DeviceCount = 0;
+    SDK_u32Random = 1;
+    memset(SDK_astTask, 0, sizeof(SDK_astTask));
+    memset(&SDK_stGpio, 0, sizeof(SDK_stGpio));
+    SDK_vResetNetwork();
+}
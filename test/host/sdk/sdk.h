@@ -0,0 +1,101 @@
+#ifndef HOST_SDK_H_
+#define HOST_SDK_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Control of the simulated SDK. Only used by host tests, never by firmware modules.
+// Time only advances if the simulation loop waits for the next event or if code calls SDK_vSpend().
+
+#include "c_types.h"
+
+// Called by the simulation loop. Returns simulated time (in us) at which the device wants to be called again.
+typedef uint64 (*SDK_tpfDevicePoll)(void *arg);
+
+// Flash accesses since start or last SDK_vEraseFlash()
+typedef struct
+{
+    uint32 reads;
+    uint32 writes;
+    uint32 erases;
+    uint64 bytes_read;
+    uint64 bytes_written;
+    uint32 errors; // Unaligned or out of range
+} SDK_tstFlashStatistics;
+
+uint64 SDK_u64GetTime(void);
+void SDK_vSpend(uint32 us);
+void SDK_vAddDevice(SDK_tpfDevicePoll poll, void *arg);
+bool SDK_bRunTask(void);
+void SDK_vRunTasks(void);
+void SDK_vRun(uint32 duration);
+void SDK_vSetGpioInput(uint8 gpio_no, uint8 value);
+uint8 SDK_u8GetGpioOutput(uint8 gpio_no);
+uint32 SDK_u32GetSpiClock(void);
+void SDK_vReset(void);
+
+// Simulated network (espconn.c)
+typedef struct SDK_tstSocket SDK_tstSocket;
+
+// Server side of the simulated network (stand-ins for stations). Socket is gone after close().
+typedef struct
+{
+    void (*accept)(void *arg, SDK_tstSocket *socket);
+    void (*receive)(void *arg, SDK_tstSocket *socket, const char *data, uint32 len); // Request of client
+    void (*close)(void *arg, SDK_tstSocket *socket);
+} SDK_tstServer;
+
+typedef struct
+{
+    uint32 latency; // One way in us
+    uint32 rate; // Link speed in Byte/s
+    uint32 window; // Data on the way to the client (TCP window)
+    uint32 dns_time; // Time of a lookup in us
+} SDK_tstNetwork;
+
+typedef struct
+{
+    uint32 lookups;
+    uint32 connections;
+    uint32 refused;
+    uint32 segments;
+    uint64 bytes;
+    uint32 holds;
+} SDK_tstNetworkStatistics;
+
+void SDK_vSetNetwork(const SDK_tstNetwork *network);
+bool SDK_bAddHost(const char *hostname, const char *ip);
+void SDK_vRemoveHost(const char *hostname);
+bool SDK_bListen(const char *ip, uint16 port, const SDK_tstServer *server, void *arg);
+uint32 SDK_u32GetSocketSpace(SDK_tstSocket *socket);
+uint32 SDK_u32SocketSend(SDK_tstSocket *socket, const void *data, uint32 len);
+void SDK_vSocketClose(SDK_tstSocket *socket);
+void SDK_vSocketAbort(SDK_tstSocket *socket);
+void SDK_vSetSocketArg(SDK_tstSocket *socket, void *arg);
+void *SDK_pvGetSocketArg(SDK_tstSocket *socket);
+void SDK_vGetNetworkStatistics(SDK_tstNetworkStatistics *statistics);
+void SDK_vResetNetwork(void);
+void SDK_vGetFlashStatistics(SDK_tstFlashStatistics *statistics);
+void SDK_vEraseFlash(void);
+
+#endif /* HOST_SDK_H_ */
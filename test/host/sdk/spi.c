@@ -0,0 +1,71 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Host replacement of driver/spi.c: Only the clock setting is kept (models of SPI slaves use it for transfer timing)
+
+#include <esp8266.h>
+#include "spi.h"
+#include "sdk.h"
+
+static uint32 SPI_u32Clock = 80000000 / (SPI_CLK_PREDIV * SPI_CLK_CNTDIV);
+
+uint32 SDK_u32GetSpiClock(void)
+{
+    return SPI_u32Clock;
+}
+
+void spi_clock(uint8 spi_no, uint16 prediv, uint8 cntdiv)
+{
+    if (spi_no > 1)
+        return;
+    if ((prediv == 0) || (cntdiv == 0))
+        SPI_u32Clock = 80000000;
+    else
+        SPI_u32Clock = 80000000 / (prediv * cntdiv);
+}
+
+void spi_init(uint8 spi_no)
+{
+    spi_clock(spi_no, SPI_CLK_PREDIV, SPI_CLK_CNTDIV);
+}
+
+// There is no slave connected: Data is lost and nothing is read back
+uint32 spi_write_block(uint8 spi_no, const uint8 *buf, uint32 len)
+{
+    return 0;
+}
+
+uint32 spiwrite_8(uint32 c)
+{
+    return 0;
+}
+
+uint32 spiwrite_16(uint32 c)
+{
+    return 0;
+}
+
+uint32 spiwrite_32(uint32 c)
+{
+    return 0;
+}
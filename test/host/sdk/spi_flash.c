@@ -0,0 +1,98 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Simulated 4 MB SPI flash. Like the real one, erasing sets all bits and writing can only clear bits.
+// Address, buffer and size have to be 4 byte aligned (the SDK fails or crashes otherwise), violations are
+// reported and counted.
+
+#include <esp8266.h>
+#include "sdk.h"
+
+#define FLASH_SIZE          (4 * 1024 * 1024)
+#define FLASH_SECTOR_SIZE   4096
+
+static uint8 FLASH_au8Memory[FLASH_SIZE];
+static bool FLASH_bErased;
+static SDK_tstFlashStatistics FLASH_stStatistics;
+
+static bool FLASH_bCheckAccess(const char *name, uint32 address, const uint32 *buffer, uint32 size)
+{
+    // Unused flash is erased
+    if (!FLASH_bErased)
+    {
+        os_memset(FLASH_au8Memory, 0xFF, FLASH_SIZE);
+        FLASH_bErased = 1;
+    }
+    if ((address & 3) || ((uintptr_t) buffer & 3) || (size & 3) || (address > FLASH_SIZE) || (size > FLASH_SIZE - address))
+    {
+        fprintf(stderr, "%s: invalid access to 0x%06X, %u bytes (buffer %p)\n", name, address, size, (void*) buffer);
+        FLASH_stStatistics.errors++;
+        return 0;
+    }
+    return 1;
+}
+
+SpiFlashOpResult spi_flash_erase_sector(uint16 sec)
+{
+    if (!FLASH_bCheckAccess("spi_flash_erase_sector", sec * FLASH_SECTOR_SIZE, NULL, FLASH_SECTOR_SIZE))
+        return SPI_FLASH_RESULT_ERR;
+    os_memset(&FLASH_au8Memory[sec * FLASH_SECTOR_SIZE], 0xFF, FLASH_SECTOR_SIZE);
+    FLASH_stStatistics.erases++;
+    return SPI_FLASH_RESULT_OK;
+}
+
+SpiFlashOpResult spi_flash_write(uint32 des_addr, uint32 *src_addr, uint32 size)
+{
+    const uint8 *data = (const uint8*) src_addr;
+    uint32 i;
+
+    if (!FLASH_bCheckAccess("spi_flash_write", des_addr, src_addr, size))
+        return SPI_FLASH_RESULT_ERR;
+    for (i = 0; i < size; i++)
+        FLASH_au8Memory[des_addr + i] &= data[i];
+    FLASH_stStatistics.writes++;
+    FLASH_stStatistics.bytes_written += size;
+    return SPI_FLASH_RESULT_OK;
+}
+
+SpiFlashOpResult spi_flash_read(uint32 src_addr, uint32 *des_addr, uint32 size)
+{
+    if (!FLASH_bCheckAccess("spi_flash_read", src_addr, des_addr, size))
+        return SPI_FLASH_RESULT_ERR;
+    os_memcpy(des_addr, &FLASH_au8Memory[src_addr], size);
+    FLASH_stStatistics.reads++;
+    FLASH_stStatistics.bytes_read += size;
+    return SPI_FLASH_RESULT_OK;
+}
+
+void SDK_vGetFlashStatistics(SDK_tstFlashStatistics *statistics)
+{
+    *statistics = FLASH_stStatistics;
+}
+
+void SDK_vEraseFlash(void)
+{
+    os_memset(FLASH_au8Memory, 0xFF, FLASH_SIZE);
+    FLASH_bErased = 1;
+    os_memset(&FLASH_stStatistics, 0, sizeof(FLASH_stStatistics));
+}
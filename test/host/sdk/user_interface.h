@@ -0,0 +1,54 @@
+#ifndef HOST_USER_INTERFACE_H_
+#define HOST_USER_INTERFACE_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Host replacement of user_interface.h: Tasks and system time are simulated by sdk.c
+
+#include "c_types.h"
+#include "spi_flash.h"
+
+#define USER_TASK_PRIO_0    0
+#define USER_TASK_PRIO_1    1
+#define USER_TASK_PRIO_2    2
+#define USER_TASK_PRIO_MAX  3
+
+typedef uint32 os_signal_t;
+typedef uint32 os_param_t;
+
+typedef struct
+{
+    os_signal_t sig;
+    os_param_t par;
+} os_event_t;
+
+typedef void (*os_task_t)(os_event_t *e);
+
+bool system_os_task(os_task_t task, uint8 prio, os_event_t *queue, uint8 qlen);
+bool system_os_post(uint8 prio, os_signal_t sig, os_param_t par);
+uint32 system_get_time(void);
+uint32 system_get_free_heap_size(void);
+void system_restart(void);
+
+#endif /* HOST_USER_INTERFACE_H_ */
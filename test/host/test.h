@@ -0,0 +1,87 @@
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Minimal check macros for host tests. A failed check is reported and the test goes on.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static unsigned TEST_uFailed;
+
+#define TEST_CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            TEST_uFailed++; \
+        } \
+    } while (0)
+
+#define TEST_CHECK_EQUAL(actual, expected) \
+    do \
+    { \
+        long long test_actual = (long long)(actual); \
+        long long test_expected = (long long)(expected); \
+        if (test_actual != test_expected) \
+        { \
+            printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #actual, #expected, test_actual, test_expected); \
+            TEST_uFailed++; \
+        } \
+    } while (0)
+
+// Reads a capture file completely. Returns NULL (and counts a failure) if it can't be read.
+static unsigned char *TEST_pu8Load(const char *path, unsigned long *length)
+{
+    FILE *file = fopen(path, "rb");
+    unsigned char *data;
+
+    if (file == NULL)
+    {
+        printf("%s: can't open\n", path);
+        TEST_uFailed++;
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data = malloc(*length + 1);
+    if (fread(data, 1, *length, file) != *length)
+    {
+        printf("%s: read error\n", path);
+        TEST_uFailed++;
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    return data;
+}
+
+// Return value of main()
+#define TEST_RESULT(name) \
+    (printf("%s: %s\n", name, TEST_uFailed ? "FAILED" : "passed"), TEST_uFailed ? 1 : 0)
+
+#endif /* HOST_TEST_H_ */
@@ -0,0 +1,122 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// DNS cache against the simulated resolver: Hits within the TTL, negative entries, and the last known
+// address while lookups fail (serve stale), with retries spaced out by the negative TTL.
+
+#include <esp8266.h>
+#include "sdk.h"
+#include "dnscache.h"
+#include "timer.h"
+#include "test.h"
+
+#define TEST_HOST       "radio.example.com"
+#define TEST_UNKNOWN    "unknown.example.com"
+
+static uint32 TEST_u32Calls;
+static bool TEST_bFound;
+static ip_addr_t TEST_stIp;
+
+uint32 ICACHE_FLASH_ATTR Time_u32GetUptime(void)
+{
+    // Replaces timer.c: Seconds of simulated time
+    return SDK_u64GetTime() / 1000000;
+}
+
+static void TEST_vFound(const char *name, ip_addr_t *ip, void *arg)
+{
+    TEST_u32Calls++;
+    TEST_bFound = (ip != NULL);
+    if (ip != NULL)
+        TEST_stIp = *ip;
+}
+
+// Result of a lookup through the cache: ESPCONN_OK (cached), ESPCONN_ARG (cached failure) or result of callback
+static err_t TEST_s8Lookup(const char *hostname, ip_addr_t *ip)
+{
+    err_t result;
+
+    TEST_u32Calls = 0;
+    result = DNS_s8GetHostByName(NULL, hostname, ip, TEST_vFound);
+    if (result != ESPCONN_INPROGRESS)
+        return result;
+    SDK_vRun(1000000);
+    TEST_CHECK_EQUAL(TEST_u32Calls, 1);
+    *ip = TEST_stIp;
+    return TEST_bFound ? ESPCONN_INPROGRESS : ESPCONN_ARG;
+}
+
+int main(void)
+{
+    ip_addr_t expected;
+    ip_addr_t ip;
+    uint32 misses;
+
+    SDK_vReset();
+    SDK_bAddHost(TEST_HOST, "10.0.0.1");
+    IP4_ADDR(&expected, 10, 0, 0, 1);
+
+    // First lookup goes to the resolver, then the entry is used
+    TEST_CHECK_EQUAL(TEST_s8Lookup(TEST_HOST, &ip), ESPCONN_INPROGRESS);
+    TEST_CHECK_EQUAL(ip.addr, expected.addr);
+    TEST_CHECK_EQUAL(TEST_s8Lookup(TEST_HOST, &ip), ESPCONN_OK);
+    TEST_CHECK_EQUAL(ip.addr, expected.addr);
+    TEST_CHECK_EQUAL(DNS_u32GetHits(), 1);
+
+    // Unknown hostname: Negative entry
+    TEST_CHECK_EQUAL(TEST_s8Lookup(TEST_UNKNOWN, &ip), ESPCONN_ARG);
+    TEST_CHECK_EQUAL(TEST_s8Lookup(TEST_UNKNOWN, &ip), ESPCONN_ARG);
+    TEST_CHECK_EQUAL(DNS_u32GetHits(), 2);
+
+    // Entry expired and the resolver fails => Last known address is handed to the callback
+    SDK_vRun(DNS_TTL * 1000000);
+    SDK_vRemoveHost(TEST_HOST);
+    misses = DNS_u32GetMisses();
+    ip.addr = 0;
+    TEST_CHECK_EQUAL(TEST_s8Lookup(TEST_HOST, &ip), ESPCONN_INPROGRESS);
+    TEST_CHECK_EQUAL(ip.addr, expected.addr);
+    TEST_CHECK_EQUAL(DNS_u32GetMisses(), misses + 1);
+
+    // Next lookups are served from the cache until the negative TTL has passed, then the resolver is asked again
+    TEST_CHECK_EQUAL(TEST_s8Lookup(TEST_HOST, &ip), ESPCONN_OK);
+    TEST_CHECK_EQUAL(ip.addr, expected.addr);
+    SDK_vRun((DNS_NEGATIVE_TTL - 3) * 1000000);
+    TEST_CHECK_EQUAL(TEST_s8Lookup(TEST_HOST, &ip), ESPCONN_OK);
+    TEST_CHECK_EQUAL(DNS_u32GetMisses(), misses + 1);
+    SDK_vRun(2000000);
+    ip.addr = 0;
+    TEST_CHECK_EQUAL(TEST_s8Lookup(TEST_HOST, &ip), ESPCONN_INPROGRESS);
+    TEST_CHECK_EQUAL(ip.addr, expected.addr);
+    TEST_CHECK_EQUAL(DNS_u32GetMisses(), misses + 2);
+
+    // Resolver works again => New address replaces the stale one
+    SDK_vRun(DNS_NEGATIVE_TTL * 1000000);
+    SDK_bAddHost(TEST_HOST, "10.0.0.2");
+    IP4_ADDR(&expected, 10, 0, 0, 2);
+    TEST_CHECK_EQUAL(TEST_s8Lookup(TEST_HOST, &ip), ESPCONN_INPROGRESS);
+    TEST_CHECK_EQUAL(ip.addr, expected.addr);
+    TEST_CHECK_EQUAL(TEST_s8Lookup(TEST_HOST, &ip), ESPCONN_OK);
+    TEST_CHECK_EQUAL(ip.addr, expected.addr);
+
+    return TEST_RESULT("test_dnscache");
+}
@@ -0,0 +1,203 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Feeder scheduling simulation: DREQ driven feeder task against the former 500 us polling timer.
+// Network segments arrive at stream bitrate with jitter, other tasks block the CPU periodically
+// (WiFi, web server, flash writes). The VS1053 model reports how the SDI FIFO copes with it.
+
+#include <esp8266.h>
+#include "sdk.h"
+#include "vs1053.h"
+#include "vs1053_model.h"
+#include "test.h"
+
+#define SIM_SEGMENT_SIZE    1460
+#define SIM_PREBUFFER       500000
+#define SIM_DURATION        20000000
+// Polling interval of the former feeder (os_timer_arm_us)
+#define SIM_POLL_INTERVAL   500
+
+typedef enum
+{
+    SIM_enModeDreq,
+    SIM_enModePoll
+} SIM_tenMode;
+
+typedef struct
+{
+    const char *name;
+    uint32 period; // In ms (0 = no load)
+    uint32 duration; // CPU is blocked this long in us
+} SIM_tstLoad;
+
+typedef struct
+{
+    uint32 bitrate;
+    uint64 schedule; // Arrival time of current segment without jitter
+    uint64 next_segment; // Simulated time of next segment arrival
+    uint32 poll_calls;
+    uint64 poll_time; // CPU time spent in polling timer in us
+    os_timer_t poll_timer;
+    os_timer_t load_timer;
+    const SIM_tstLoad *load;
+} SIM_tstState;
+
+static SIM_tstState SIM_stState;
+
+static uint64 SIM_u64Network(void *arg)
+{
+    static uint8 segment[SIM_SEGMENT_SIZE];
+    uint64 interval = (uint64)SIM_SEGMENT_SIZE * 8 * 1000000 / SIM_stState.bitrate;
+    uint64 now = SDK_u64GetTime();
+
+    // Segments arrive at stream bitrate, each one delayed by up to two segment intervals
+    while (SIM_stState.next_segment <= now)
+    {
+        VS1053_u32WriteRingBuffer(segment, sizeof(segment));
+        SIM_stState.schedule += interval;
+        SIM_stState.next_segment = SIM_stState.schedule + os_random() % (2 * interval);
+    }
+    return SIM_stState.next_segment;
+}
+
+static void SIM_vLoad(void *arg)
+{
+    // Another task keeps the CPU busy
+    SDK_vSpend(SIM_stState.load->duration);
+}
+
+static void SIM_vPoll(void *arg)
+{
+    uint64 start = SDK_u64GetTime();
+
+    // Feeder as it was: One 32 byte block per timer call
+    VS1053_vPoll();
+    SIM_stState.poll_calls++;
+    SIM_stState.poll_time += SDK_u64GetTime() - start;
+}
+
+static void SIM_vRun(SIM_tenMode mode, uint32 bitrate, const SIM_tstLoad *load)
+{
+    VSMODEL_tstConfig config = { 0 };
+    VSMODEL_tstReport report;
+    uint32 wakeups;
+    uint64 busy;
+    uint32 busy_start;
+
+    SDK_vReset();
+    config.bitrate = bitrate;
+    config.sample_rate = 44100;
+    config.stereo = 1;
+    config.cancel_bytes = 64;
+    VSMODEL_vInit(&config);
+    VS1053_vInit();
+    VS1053_vFlushRingBuffer();
+    os_memset(&SIM_stState, 0, sizeof(SIM_stState));
+    SIM_stState.bitrate = bitrate;
+    SIM_stState.load = load;
+    SDK_vAddDevice(SIM_u64Network, NULL);
+    if (load->period != 0)
+    {
+        os_timer_setfn(&SIM_stState.load_timer, SIM_vLoad, NULL);
+        os_timer_arm(&SIM_stState.load_timer, load->period, 1);
+    }
+
+    // Prebuffering, then start feeding
+    SDK_vRun(SIM_PREBUFFER);
+    busy_start = VS1053_u32GetFeederBusyTime();
+    if (mode == SIM_enModeDreq)
+    {
+        VS1053_vEnableFeeder(1);
+    }
+    else
+    {
+        ETS_GPIO_INTR_DISABLE();
+        os_timer_setfn(&SIM_stState.poll_timer, SIM_vPoll, NULL);
+        os_timer_arm_us(&SIM_stState.poll_timer, SIM_POLL_INTERVAL, 1);
+    }
+    SDK_vRun(SIM_DURATION);
+
+    VSMODEL_vGetReport(&report);
+    if (mode == SIM_enModeDreq)
+    {
+        wakeups = report.dreq_edges;
+        busy = VS1053_u32GetFeederBusyTime() - busy_start;
+    }
+    else
+    {
+        wakeups = SIM_stState.poll_calls;
+        busy = SIM_stState.poll_time;
+    }
+    printf("%-5s %4u %-12s %6u %8.1f %6u %6u %7u %7u %8u %6.2f\n",
+        mode == SIM_enModeDreq ? "dreq" : "poll",
+        (unsigned)(bitrate / 1000),
+        load->name,
+        report.underruns,
+        report.underrun_time / 1e3,
+        report.fifo_min,
+        report.fifo_average,
+        report.latency_average,
+        report.latency_max,
+        (unsigned)(wakeups / (SIM_DURATION / 1000000)),
+        busy * 100.0 / SIM_DURATION);
+
+    TEST_CHECK_EQUAL(report.overflow_bytes, 0);
+    TEST_CHECK_EQUAL(report.protocol_errors, 0);
+    if (mode == SIM_enModeDreq)
+    {
+        // Feeder reacts on every DREQ edge: Loads that are shorter than the FIFO playing time cause no underrun
+        TEST_CHECK_EQUAL(report.underruns, 0);
+        TEST_CHECK(report.latency_max <= load->duration + 1000);
+    }
+    os_timer_disarm(&SIM_stState.poll_timer);
+    os_timer_disarm(&SIM_stState.load_timer);
+}
+
+int main(void)
+{
+    static const uint32 bitrates[] = { 128000, 320000 };
+    static const SIM_tstLoad loads[] =
+    {
+        { "none", 0, 0 },
+        { "5ms/50ms", 50, 5000 },
+        { "20ms/100ms", 100, 20000 },
+        { "40ms/100ms", 100, 40000 }
+    };
+    uint8 b;
+    uint8 l;
+
+    printf("Feeder simulation, %u s per run (FIFO %u bytes)\n", SIM_DURATION / 1000000, VSMODEL_FIFO_SIZE);
+    printf("%-5s %4s %-12s %6s %8s %6s %6s %7s %7s %8s %6s\n",
+        "mode", "kbps", "load", "underr", "silence", "fifo", "fifo", "latency", "latency", "wakeups", "cpu");
+    printf("%-5s %4s %-12s %6s %8s %6s %6s %7s %7s %8s %6s\n",
+        "", "", "", "", "ms", "min", "avg", "avg us", "max us", "per s", "%");
+    for (b = 0; b < sizeof(bitrates) / sizeof(bitrates[0]); b++)
+    {
+        for (l = 0; l < sizeof(loads) / sizeof(loads[0]); l++)
+        {
+            SIM_vRun(SIM_enModeDreq, bitrates[b], &loads[l]);
+            SIM_vRun(SIM_enModePoll, bitrates[b], &loads[l]);
+        }
+    }
+    return TEST_RESULT("test_feeder");
+}
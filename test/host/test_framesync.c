@@ -0,0 +1,324 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// ICY parser: Captured streams are replayed in one piece, split at every byte offset and byte by byte.
+
+// Frame synchronisation: Captured MPEG (constant and variable bitrate) and ADTS streams are replayed in one
+// piece, split at every byte offset and byte by byte. Output has to be exactly the complete frames, statistics
+// have to match the values the capture generator calculated (captures/*.expect). Random start positions in a
+// stream with sync words in the audio data must not keep the parser on a false header.
+
+#include <esp8266.h>
+#include "framesync.h"
+#include "test.h"
+
+// Tolerance of the average bitrate in kbit/s (frame duration is calculated in integer us)
+#define TEST_BITRATE_TOLERANCE  2
+// Random start: Stream length and number of runs. Bytes that may be lost at the start: Partial frame, candidate
+// and the frame of a false header in between (up to the longest ADTS frame).
+#define TEST_RANDOM_FRAMES      200
+#define TEST_RANDOM_RUNS        5000
+#define TEST_RANDOM_LOSS        (8191 + 2 * 418)
+
+typedef struct
+{
+    FSYNC_tstParser parser;
+    // Expected result
+    const uint8 *audio;
+    unsigned long audio_length;
+    unsigned long format;
+    unsigned long sample_rate;
+    unsigned long frames;
+    unsigned long sync_lost;
+    unsigned long discarded;
+    unsigned long bitrate;
+    unsigned long cut; // Discontinuity: Position of the gap in the capture
+    unsigned long partial; // Discontinuity: Bytes of the frame in front of the gap
+    unsigned long tail; // Discontinuity: Bytes at the end that have to be found back without the API call
+    // Result of current run
+    uint8 *output;
+    unsigned long received;
+} TEST_tstCapture;
+
+static void TEST_vOutput(void *arg, char *data, uint32 len)
+{
+    TEST_tstCapture *capture = arg;
+
+    // Too much output is a failure already => Keep the excess out of the buffer
+    if (capture->received + len <= capture->audio_length)
+        os_memcpy(capture->output + capture->received, data, len);
+    capture->received += len;
+}
+
+static bool TEST_bLoadExpect(TEST_tstCapture *capture, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char key[16];
+    unsigned long value;
+
+    if (file == NULL)
+    {
+        printf("%s: can't open\n", path);
+        return 0;
+    }
+    capture->cut = 0;
+    capture->partial = 0;
+    capture->tail = 0;
+    while (fscanf(file, "%15s %lu", key, &value) == 2)
+    {
+        if (os_strcmp(key, "format") == 0)
+            capture->format = value;
+        else if (os_strcmp(key, "sample_rate") == 0)
+            capture->sample_rate = value;
+        else if (os_strcmp(key, "frames") == 0)
+            capture->frames = value;
+        else if (os_strcmp(key, "sync_lost") == 0)
+            capture->sync_lost = value;
+        else if (os_strcmp(key, "discarded") == 0)
+            capture->discarded = value;
+        else if (os_strcmp(key, "bitrate") == 0)
+            capture->bitrate = value;
+        else if (os_strcmp(key, "cut") == 0)
+            capture->cut = value;
+        else if (os_strcmp(key, "partial") == 0)
+            capture->partial = value;
+        else if (os_strcmp(key, "tail") == 0)
+            capture->tail = value;
+    }
+    fclose(file);
+    return 1;
+}
+
+static void TEST_vBegin(TEST_tstCapture *capture)
+{
+    FSYNC_vInit(&capture->parser, TEST_vOutput, capture);
+    capture->received = 0;
+}
+
+// Hands over [start, end) of the capture, in two parts if split is within
+static void TEST_vFeed(TEST_tstCapture *capture, uint8 *stream, unsigned long start, unsigned long end, unsigned long split)
+{
+    if ((split > start) && (split < end))
+    {
+        FSYNC_vProcess(&capture->parser, (char *)stream + start, split - start);
+        start = split;
+    }
+    FSYNC_vProcess(&capture->parser, (char *)stream + start, end - start);
+}
+
+// Replays the capture split at the given offset. Gap is announced to the parser like httpclient does.
+static void TEST_vRun(TEST_tstCapture *capture, uint8 *stream, unsigned long length, unsigned long split)
+{
+    uint32 partial;
+
+    TEST_vBegin(capture);
+    if (capture->cut != 0)
+    {
+        TEST_vFeed(capture, stream, 0, capture->cut, split);
+        // Caller removes the part of the frame in front of the gap that has been handed over already
+        partial = FSYNC_u32Discontinuity(&capture->parser);
+        if (partial != capture->partial)
+            capture->received = capture->audio_length + 1;
+        else
+            capture->received -= partial;
+        TEST_vFeed(capture, stream, capture->cut, length, split);
+    }
+    else
+        TEST_vFeed(capture, stream, 0, length, split);
+}
+
+static bool TEST_bEnd(TEST_tstCapture *capture)
+{
+    long bitrate = FSYNC_u16GetBitrate(&capture->parser);
+
+    if ((capture->received != capture->audio_length) || (os_memcmp(capture->output, capture->audio, capture->audio_length) != 0))
+        return 0;
+    return (capture->parser.format == capture->format) && (capture->parser.sample_rate == capture->sample_rate) &&
+            (capture->parser.frames == capture->frames) && (capture->parser.sync_lost == capture->sync_lost) &&
+            (capture->parser.discarded == capture->discarded) && (labs(bitrate - (long)capture->bitrate) <= TEST_BITRATE_TOLERANCE);
+}
+
+static void TEST_vPrintResult(const char *name, TEST_tstCapture *capture)
+{
+    printf("%s: output %lu/%lu bytes, format %u, %u Hz, %u frames, sync lost %u, discarded %u, %u kbit/s\n", name,
+            capture->received, capture->audio_length, capture->parser.format, capture->parser.sample_rate,
+            capture->parser.frames, capture->parser.sync_lost, capture->parser.discarded, FSYNC_u16GetBitrate(&capture->parser));
+    printf("%s: expected format %lu, %lu Hz, %lu frames, sync lost %lu, discarded %lu, %lu kbit/s\n", name,
+            capture->format, capture->sample_rate, capture->frames, capture->sync_lost, capture->discarded, capture->bitrate);
+}
+
+static void TEST_vReplay(const char *name)
+{
+    static TEST_tstCapture capture;
+    char path[64];
+    unsigned long length;
+    unsigned long split;
+    unsigned long failed = 0;
+    uint8 *stream;
+
+    os_sprintf(path, "captures/%s.bin", name);
+    stream = TEST_pu8Load(path, &length);
+    os_sprintf(path, "captures/%s.audio", name);
+    capture.audio = TEST_pu8Load(path, &capture.audio_length);
+    os_sprintf(path, "captures/%s.expect", name);
+    if ((stream == NULL) || (capture.audio == NULL) || !TEST_bLoadExpect(&capture, path))
+    {
+        TEST_uFailed++;
+        return;
+    }
+    capture.output = malloc(capture.audio_length + 1);
+
+    // Complete capture at once (two parts if there is a gap)
+    TEST_vRun(&capture, stream, length, 0);
+    if (!TEST_bEnd(&capture))
+    {
+        TEST_vPrintResult(name, &capture);
+        TEST_uFailed++;
+    }
+
+    // Split into two parts at every offset
+    for (split = 0; split <= length; split++)
+    {
+        TEST_vRun(&capture, stream, length, split);
+        if (!TEST_bEnd(&capture))
+        {
+            if (failed == 0)
+                printf("%s: first failing split at %lu\n", name, split);
+            failed++;
+        }
+    }
+    TEST_CHECK_EQUAL(failed, 0);
+
+    // Byte by byte (every position is a split)
+    TEST_vBegin(&capture);
+    for (split = 0; split < length; split++)
+    {
+        if ((capture.cut != 0) && (split == capture.cut))
+            capture.received -= FSYNC_u32Discontinuity(&capture.parser);
+        FSYNC_vProcess(&capture.parser, (char *)stream + split, 1);
+    }
+    TEST_CHECK(TEST_bEnd(&capture));
+
+    printf("%s: %lu bytes, %lu frames, %lu splits\n", name, length, capture.frames, length + 1);
+    free(stream);
+    free(capture.output);
+    free((void *)capture.audio);
+}
+
+static void TEST_vUnannouncedGap(void)
+{
+    static TEST_tstCapture capture;
+    unsigned long length;
+    uint8 *stream;
+    uint8 *output;
+
+    // Same gap without FSYNC_u32Discontinuity(): Header check behind the frame fails, parser searches the next header
+    stream = TEST_pu8Load("captures/fsync_discontinuity.bin", &length);
+    capture.audio = TEST_pu8Load("captures/fsync_discontinuity.audio", &capture.audio_length);
+    if ((stream == NULL) || (capture.audio == NULL) || !TEST_bLoadExpect(&capture, "captures/fsync_discontinuity.expect"))
+    {
+        TEST_uFailed++;
+        return;
+    }
+    // Output gets garbage in front of the gap => Don't limit it to the expected length
+    output = malloc(length);
+    capture.output = output;
+    capture.audio_length = length;
+    TEST_vBegin(&capture);
+    FSYNC_vProcess(&capture.parser, (char *)stream, length);
+    TEST_CHECK_EQUAL(capture.parser.sync_lost, 1);
+    TEST_CHECK_EQUAL(capture.parser.format, capture.format);
+    TEST_CHECK(capture.received >= capture.tail);
+    TEST_CHECK(os_memcmp(output + capture.received - capture.tail, stream + length - capture.tail, capture.tail) == 0);
+    free(stream);
+    free(output);
+    free((void *)capture.audio);
+}
+
+static void TEST_vCountOutput(void *arg, char *data, uint32 len)
+{
+    *(unsigned long *)arg += len;
+}
+
+static void TEST_vRandomStart(void)
+{
+    static uint8 stream[TEST_RANDOM_FRAMES * 418];
+    FSYNC_tstParser parser;
+    unsigned long length = 0;
+    unsigned long received;
+    unsigned long offset;
+    unsigned long failed = 0;
+    uint32 rest = 0;
+    uint32 size;
+    uint32 i;
+    uint32 run;
+
+    // CBR 128 kbit/s stream with random payload (sync words within audio data like real streams)
+    for (i = 0; i < TEST_RANDOM_FRAMES; i++)
+    {
+        size = 417;
+        rest += 144000 * 128 % 44100;
+        if (rest >= 44100)
+        {
+            rest -= 44100;
+            size++;
+        }
+        stream[length] = 0xFF;
+        stream[length + 1] = 0xFB;
+        stream[length + 2] = 0x90 | ((size == 418) ? 0x02 : 0x00);
+        stream[length + 3] = 0x64;
+        for (offset = 4; offset < size; offset++)
+            stream[length + offset] = (os_random() >> 16) & 0xFF;
+        length += size;
+    }
+
+    // Playback starts anywhere. A false sync word costs the data its frame length covers, it must not keep the
+    // stream silent.
+    for (run = 0; run < TEST_RANDOM_RUNS; run++)
+    {
+        offset = os_random() % (length / 2);
+        received = 0;
+        FSYNC_vInit(&parser, TEST_vCountOutput, &received);
+        FSYNC_vProcess(&parser, (char *)stream + offset, length - offset);
+        if (!parser.locked || (received + TEST_RANDOM_LOSS < length - offset))
+        {
+            if (failed == 0)
+                printf("random_start: offset %lu passed %lu of %lu bytes\n", offset, received, length - offset);
+            failed++;
+        }
+    }
+    TEST_CHECK_EQUAL(failed, 0);
+    printf("random_start: %u runs, %lu bytes\n", TEST_RANDOM_RUNS, length);
+}
+
+int main(void)
+{
+    TEST_vReplay("fsync_mpeg_cbr");
+    TEST_vReplay("fsync_mpeg_vbr");
+    TEST_vReplay("fsync_adts");
+    TEST_vReplay("fsync_discontinuity");
+    TEST_vReplay("fsync_false_sync");
+    TEST_vUnannouncedGap();
+    TEST_vRandomStart();
+    return TEST_RESULT("test_framesync");
+}
@@ -0,0 +1,362 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// ICY parser: Captured streams are replayed in one piece, split at every byte offset and byte by byte.
+
+// HLS: Playlists are parsed in one piece, split at every byte offset and byte by byte, the result has to be
+// the same every time. A generated transport stream segment (captures/hls_segment.*) is demultiplexed with
+// the same splits, output has to be exactly the audio elementary stream.
+
+#include <esp8266.h>
+#include "hls.h"
+#include "test.h"
+
+#define TEST_BASE_URL   "http://radio.example.com/live/stream.m3u8?token=abc"
+
+typedef struct
+{
+    bool master;
+    const char *variant;
+    bool endlist;
+    uint16 target_duration;
+    uint8 count;
+    uint32 sequence[HLS_QUEUE_SIZE];
+    const char *url[HLS_QUEUE_SIZE];
+} TEST_tstPlaylistResult;
+
+typedef struct
+{
+    HLS_tstDemux demux;
+    const uint8 *audio;
+    unsigned long audio_length;
+    unsigned long discarded;
+    uint8 *output;
+    unsigned long received;
+} TEST_tstSegment;
+
+static bool TEST_bCheckPlaylist(HLS_tstPlaylist *playlist, const TEST_tstPlaylistResult *expected)
+{
+    uint8 i;
+
+    if ((playlist->master != expected->master) || (playlist->endlist != expected->endlist) ||
+            (playlist->target_duration != expected->target_duration) || (playlist->queue_count != expected->count))
+        return 0;
+    if (expected->master && (os_strcmp(playlist->variant, expected->variant) != 0))
+        return 0;
+    for (i = 0; i < expected->count; i++)
+    {
+        if ((playlist->queue[(playlist->queue_start + i) % HLS_QUEUE_SIZE].sequence != expected->sequence[i]) ||
+                (os_strcmp(playlist->queue[(playlist->queue_start + i) % HLS_QUEUE_SIZE].url, expected->url[i]) != 0))
+            return 0;
+    }
+    return 1;
+}
+
+static void TEST_vPrintPlaylist(HLS_tstPlaylist *playlist)
+{
+    uint8 i;
+
+    printf("  master %u (%s), endlist %u, target duration %u, %u segments\n", playlist->master, playlist->variant,
+            playlist->endlist, playlist->target_duration, playlist->queue_count);
+    for (i = 0; i < playlist->queue_count; i++)
+        printf("  %u %s\n", playlist->queue[(playlist->queue_start + i) % HLS_QUEUE_SIZE].sequence,
+                playlist->queue[(playlist->queue_start + i) % HLS_QUEUE_SIZE].url);
+}
+
+// Loads the text into a copy of the given playlist state, in two parts split at the given offset
+static void TEST_vLoad(HLS_tstPlaylist *playlist, const HLS_tstPlaylist *initial, const char *text, uint32 split)
+{
+    uint32 length = os_strlen(text);
+
+    os_memcpy(playlist, initial, sizeof(HLS_tstPlaylist));
+    HLS_vBeginPlaylist(playlist);
+    HLS_vProcessPlaylist(playlist, text, split);
+    HLS_vProcessPlaylist(playlist, text + split, length - split);
+    HLS_vFinishPlaylist(playlist);
+}
+
+static void TEST_vPlaylist(const char *name, const HLS_tstPlaylist *initial, const char *text, const TEST_tstPlaylistResult *expected)
+{
+    static HLS_tstPlaylist playlist;
+    uint32 length = os_strlen(text);
+    uint32 split;
+    uint32 failed = 0;
+    uint32 i;
+
+    // Complete playlist at once
+    TEST_vLoad(&playlist, initial, text, length);
+    if (!TEST_bCheckPlaylist(&playlist, expected))
+    {
+        printf("%s: unexpected result\n", name);
+        TEST_vPrintPlaylist(&playlist);
+        TEST_uFailed++;
+    }
+
+    // Split into two parts at every offset
+    for (split = 0; split <= length; split++)
+    {
+        TEST_vLoad(&playlist, initial, text, split);
+        if (!TEST_bCheckPlaylist(&playlist, expected))
+        {
+            if (failed == 0)
+                printf("%s: first failing split at %u\n", name, split);
+            failed++;
+        }
+    }
+    TEST_CHECK_EQUAL(failed, 0);
+
+    // Byte by byte
+    os_memcpy(&playlist, initial, sizeof(HLS_tstPlaylist));
+    HLS_vBeginPlaylist(&playlist);
+    for (i = 0; i < length; i++)
+        HLS_vProcessPlaylist(&playlist, text + i, 1);
+    HLS_vFinishPlaylist(&playlist);
+    TEST_CHECK(TEST_bCheckPlaylist(&playlist, expected));
+}
+
+static void TEST_vPlaylists(void)
+{
+    static HLS_tstPlaylist initial;
+    static HLS_tstPlaylist playlist;
+    static char text[2 * HLS_LINE_SIZE];
+    const char *live =
+            "#EXTM3U\r\n"
+            "#EXT-X-VERSION:3\r\n"
+            "#EXT-X-TARGETDURATION:6\r\n"
+            "#EXT-X-MEDIA-SEQUENCE:100\r\n"
+            "#EXTINF:6.0,\r\n"
+            "seg100.ts\r\n"
+            "#EXTINF:6.0,\r\n"
+            "seg101.ts\r\n"
+            "#EXTINF:6.0,\r\n"
+            "/other/seg102.aac\r\n"
+            "\r\n"
+            "#EXTINF:6.0,\r\n"
+            "http://cdn.example.com/seg103.ts?t=1\r\n"
+            "#EXTINF:6.0,\r\n"
+            "seg104.ts\r\n";
+    // Live edge: Oldest segments are dropped on the first load
+    const TEST_tstPlaylistResult live_result =
+    {
+        .target_duration = 6,
+        .count = 3,
+        .sequence = { 102, 103, 104 },
+        .url = { "http://radio.example.com/other/seg102.aac", "http://cdn.example.com/seg103.ts?t=1",
+                "http://radio.example.com/live/seg104.ts" }
+    };
+    const char *reload =
+            "#EXTM3U\n"
+            "#EXT-X-TARGETDURATION:6\n"
+            "#EXT-X-MEDIA-SEQUENCE:103\n"
+            "#EXTINF:6.0,\n"
+            "http://cdn.example.com/seg103.ts?t=1\n"
+            "#EXTINF:6.0,\n"
+            "seg104.ts\n"
+            "#EXTINF:6.0,\n"
+            "seg105.ts\n"
+            "#EXTINF:6.0,\n"
+            "seg106.ts";
+    // Reload after two segments have been fetched: Only new segments are queued, last line isn't terminated
+    const TEST_tstPlaylistResult reload_result =
+    {
+        .target_duration = 6,
+        .count = 3,
+        .sequence = { 104, 105, 106 },
+        .url = { "http://radio.example.com/live/seg104.ts", "http://radio.example.com/live/seg105.ts",
+                "http://radio.example.com/live/seg106.ts" }
+    };
+    const char *master =
+            "#EXTM3U\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=64000,CODECS=\"mp4a.40.5\"\n"
+            "low/index.m3u8\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=128000,CODECS=\"mp4a.40.2\"\n"
+            "high/index.m3u8\n";
+    const TEST_tstPlaylistResult master_result =
+    {
+        .master = 1,
+        .variant = "http://radio.example.com/live/low/index.m3u8"
+    };
+    const char *vod =
+            "#EXTM3U\n"
+            "#EXT-X-PLAYLIST-TYPE:VOD\n"
+            "#EXTINF:10.0,\n"
+            "a.ts\n"
+            "#EXTINF:10.0,\n"
+            "b.ts\n"
+            "#EXT-X-ENDLIST\n";
+    // No media sequence tag => Numbering starts at 0, default update interval
+    const TEST_tstPlaylistResult vod_result =
+    {
+        .endlist = 1,
+        .count = 2,
+        .sequence = { 0, 1 },
+        .url = { "http://radio.example.com/live/a.ts", "http://radio.example.com/live/b.ts" }
+    };
+    const TEST_tstPlaylistResult long_result =
+    {
+        .target_duration = 8,
+        .count = 1,
+        .sequence = { 6 },
+        .url = { "http://radio.example.com/live/ok.ts" }
+    };
+    uint32 length;
+
+    TEST_CHECK(HLS_bInit(&initial, TEST_BASE_URL));
+    TEST_vPlaylist("live", &initial, live, &live_result);
+    TEST_CHECK_EQUAL(HLS_u32GetUpdateInterval(&initial), HLS_DEFAULT_TARGET_DURATION * 1000 / 2);
+
+    // Two segments fetched, then the playlist is reloaded
+    TEST_vLoad(&playlist, &initial, live, os_strlen(live));
+    TEST_CHECK_EQUAL(HLS_u32GetUpdateInterval(&playlist), 3000);
+    HLS_vDropSegment(&playlist);
+    HLS_vDropSegment(&playlist);
+    os_memcpy(&initial, &playlist, sizeof(HLS_tstPlaylist));
+    TEST_vPlaylist("reload", &initial, reload, &reload_result);
+
+    TEST_CHECK(HLS_bInit(&initial, TEST_BASE_URL));
+    TEST_vPlaylist("master", &initial, master, &master_result);
+    TEST_vPlaylist("vod", &initial, vod, &vod_result);
+
+    // Overlong URI line is dropped as a whole (segment 5), following lines are parsed normally
+    length = os_sprintf(text, "#EXT-X-TARGETDURATION:8\n#EXT-X-MEDIA-SEQUENCE:5\n#EXTINF:8,\n");
+    os_memset(text + length, 'x', HLS_LINE_SIZE + 10);
+    length += HLS_LINE_SIZE + 10;
+    os_strcpy(text + length, ".ts\n#EXTINF:8,\nok.ts\n");
+    TEST_vPlaylist("long line", &initial, text, &long_result);
+
+    TEST_CHECK(HLS_bIsPlaylist("application/vnd.apple.mpegurl", "/live/stream"));
+    TEST_CHECK(HLS_bIsPlaylist("audio/x-mpegurl", "/live/STREAM.M3U8?token=abc"));
+    TEST_CHECK(!HLS_bIsPlaylist("audio/x-mpegurl", "/list.m3u"));
+    TEST_CHECK(!HLS_bIsPlaylist("audio/mpeg", "/m3u8"));
+    printf("playlists: %u splits\n", (unsigned)(os_strlen(live) + os_strlen(reload) + os_strlen(master) + os_strlen(vod) + length + 5));
+}
+
+static void TEST_vOutput(void *arg, char *data, uint32 len)
+{
+    TEST_tstSegment *segment = arg;
+
+    // Too much output is a failure already => Keep the excess out of the buffer
+    if (segment->received + len <= segment->audio_length)
+        os_memcpy(segment->output + segment->received, data, len);
+    segment->received += len;
+}
+
+static void TEST_vBeginSegment(TEST_tstSegment *segment)
+{
+    // Counter is cleared by the caller (httpclient) for every segment
+    HLS_vInitDemux(&segment->demux, TEST_vOutput, segment);
+    segment->demux.discarded = 0;
+    segment->received = 0;
+}
+
+static bool TEST_bEndSegment(TEST_tstSegment *segment)
+{
+    return (segment->demux.mode == HLS_enDemuxTs) && (segment->received == segment->audio_length) &&
+            (os_memcmp(segment->output, segment->audio, segment->audio_length) == 0) &&
+            (segment->demux.discarded == segment->discarded);
+}
+
+static void TEST_vTransportStream(void)
+{
+    static TEST_tstSegment segment;
+    unsigned long length;
+    unsigned long split;
+    unsigned long failed = 0;
+    uint8 *stream;
+    FILE *file;
+
+    stream = TEST_pu8Load("captures/hls_segment.bin", &length);
+    segment.audio = TEST_pu8Load("captures/hls_segment.audio", &segment.audio_length);
+    file = fopen("captures/hls_segment.expect", "r");
+    if ((stream == NULL) || (segment.audio == NULL) || (file == NULL) || (fscanf(file, "discarded %lu", &segment.discarded) != 1))
+    {
+        TEST_uFailed++;
+        return;
+    }
+    fclose(file);
+    segment.output = malloc(segment.audio_length + 1);
+
+    // Complete segment at once
+    TEST_vBeginSegment(&segment);
+    HLS_vDemux(&segment.demux, (char *)stream, length);
+    TEST_CHECK(TEST_bEndSegment(&segment));
+    TEST_CHECK_EQUAL(segment.demux.pmt_pid, 0x1000);
+    TEST_CHECK_EQUAL(segment.demux.audio_pid, 0x0101);
+
+    // Split into two parts at every offset (packets split at every position)
+    for (split = 0; split <= length; split++)
+    {
+        TEST_vBeginSegment(&segment);
+        HLS_vDemux(&segment.demux, (char *)stream, split);
+        HLS_vDemux(&segment.demux, (char *)stream + split, length - split);
+        if (!TEST_bEndSegment(&segment))
+        {
+            if (failed == 0)
+                printf("hls_segment: first failing split at %lu\n", split);
+            failed++;
+        }
+    }
+    TEST_CHECK_EQUAL(failed, 0);
+
+    // Byte by byte
+    TEST_vBeginSegment(&segment);
+    for (split = 0; split < length; split++)
+        HLS_vDemux(&segment.demux, (char *)stream + split, 1);
+    TEST_CHECK(TEST_bEndSegment(&segment));
+
+    printf("hls_segment: %lu bytes, %lu audio bytes, %lu splits\n", length, segment.audio_length, length + 1);
+    free(stream);
+    free(segment.output);
+    free((void *)segment.audio);
+}
+
+static void TEST_vPackedAudio(void)
+{
+    static TEST_tstSegment segment;
+    static uint8 data[1000];
+    uint32 i;
+
+    // Packed audio (ID3 tag in front of ADTS frames) is passed on unchanged
+    os_memcpy(data, "ID3\x04\x00\x00\x00\x00\x00\x0A", 10);
+    for (i = 10; i < sizeof(data); i++)
+        data[i] = (i * 7) & 0xFF;
+    segment.audio = data;
+    segment.audio_length = sizeof(data);
+    segment.output = malloc(sizeof(data));
+    TEST_vBeginSegment(&segment);
+    HLS_vDemux(&segment.demux, (char *)data, 0);
+    HLS_vDemux(&segment.demux, (char *)data, 333);
+    HLS_vDemux(&segment.demux, (char *)data + 333, sizeof(data) - 333);
+    TEST_CHECK_EQUAL(segment.demux.mode, HLS_enDemuxRaw);
+    TEST_CHECK_EQUAL(segment.received, sizeof(data));
+    TEST_CHECK(os_memcmp(segment.output, data, sizeof(data)) == 0);
+    free(segment.output);
+}
+
+int main(void)
+{
+    TEST_vPlaylists();
+    TEST_vTransportStream();
+    TEST_vPackedAudio();
+    return TEST_RESULT("test_hls");
+}
@@ -0,0 +1,206 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// ICY parser: Captured streams are replayed in one piece, split at every byte offset and byte by byte.
+// Audio output and title changes have to be the same for every split.
+
+#include <esp8266.h>
+#include "icy.h"
+#include "test.h"
+
+#define TEST_TITLE_COUNT    16
+
+typedef struct
+{
+    uint32 offset; // Audio bytes before the title became valid
+    char title[ICY_TITLE_SIZE];
+} TEST_tstTitle;
+
+typedef struct
+{
+    ICY_tstParser parser;
+    // Expected result
+    const uint8 *audio;
+    unsigned long audio_length;
+    TEST_tstTitle titles[TEST_TITLE_COUNT];
+    uint8 title_count;
+    // Result of current run
+    uint32 received;
+    bool audio_match;
+    TEST_tstTitle seen[TEST_TITLE_COUNT];
+    uint8 seen_count;
+    char title[ICY_TITLE_SIZE];
+} TEST_tstCapture;
+
+static void TEST_vAudio(void *arg, char *data, uint32 len)
+{
+    TEST_tstCapture *capture = arg;
+    const char *title = ICY_pcGetTitle(&capture->parser);
+
+    // Title changes are taken at the first audio byte behind the metadata block
+    if (os_strcmp(title, capture->title) != 0)
+    {
+        os_strcpy(capture->title, title);
+        if (capture->seen_count < TEST_TITLE_COUNT)
+        {
+            capture->seen[capture->seen_count].offset = capture->received;
+            os_strcpy(capture->seen[capture->seen_count].title, title);
+        }
+        capture->seen_count++;
+    }
+    if ((capture->received + len > capture->audio_length) || (os_memcmp(data, capture->audio + capture->received, len) != 0))
+        capture->audio_match = 0;
+    capture->received += len;
+}
+
+static bool TEST_bLoadTitles(TEST_tstCapture *capture, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char line[16 + ICY_TITLE_SIZE];
+    char *title;
+    unsigned long offset;
+
+    capture->title_count = 0;
+    if (file == NULL)
+    {
+        printf("%s: can't open\n", path);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        offset = strtoul(line, &title, 10);
+        title++;
+        title[strcspn(title, "\n")] = '\0';
+        capture->titles[capture->title_count].offset = offset;
+        os_strcpy(capture->titles[capture->title_count].title, title);
+        capture->title_count++;
+    }
+    fclose(file);
+    return 1;
+}
+
+static void TEST_vBegin(TEST_tstCapture *capture, uint32 interval)
+{
+    ICY_vInit(&capture->parser, interval, TEST_vAudio, capture);
+    capture->received = 0;
+    capture->audio_match = 1;
+    capture->seen_count = 0;
+    capture->title[0] = '\0';
+}
+
+static bool TEST_bEnd(TEST_tstCapture *capture)
+{
+    uint8 i;
+
+    if (!capture->audio_match || (capture->received != capture->audio_length))
+        return 0;
+    if (capture->seen_count != capture->title_count)
+        return 0;
+    for (i = 0; i < capture->title_count; i++)
+    {
+        if (capture->seen[i].offset != capture->titles[i].offset)
+            return 0;
+        if (os_strcmp(capture->seen[i].title, capture->titles[i].title) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+static void TEST_vReplay(const char *name, uint32 interval)
+{
+    static TEST_tstCapture capture;
+    char path[64];
+    unsigned long length;
+    unsigned long split;
+    unsigned long failed = 0;
+    uint8 *stream;
+
+    os_sprintf(path, "captures/%s.bin", name);
+    stream = TEST_pu8Load(path, &length);
+    os_sprintf(path, "captures/%s.audio", name);
+    capture.audio = TEST_pu8Load(path, &capture.audio_length);
+    os_sprintf(path, "captures/%s.titles", name);
+    if ((stream == NULL) || (capture.audio == NULL) || !TEST_bLoadTitles(&capture, path))
+    {
+        TEST_uFailed++;
+        return;
+    }
+
+    // Complete capture at once
+    TEST_vBegin(&capture, interval);
+    ICY_vProcess(&capture.parser, (char *)stream, length);
+    TEST_CHECK(TEST_bEnd(&capture));
+
+    // Split into two parts at every offset
+    for (split = 0; split <= length; split++)
+    {
+        TEST_vBegin(&capture, interval);
+        ICY_vProcess(&capture.parser, (char *)stream, split);
+        ICY_vProcess(&capture.parser, (char *)stream + split, length - split);
+        if (!TEST_bEnd(&capture))
+        {
+            if (failed == 0)
+                printf("%s: first failing split at %lu\n", name, split);
+            failed++;
+        }
+    }
+    TEST_CHECK_EQUAL(failed, 0);
+
+    // Byte by byte (every position is a split)
+    TEST_vBegin(&capture, interval);
+    for (split = 0; split < length; split++)
+        ICY_vProcess(&capture.parser, (char *)stream + split, 1);
+    TEST_CHECK(TEST_bEnd(&capture));
+
+    printf("%s: %lu bytes, %u titles, %lu splits\n", name, length, capture.title_count, length + 1);
+    free(stream);
+    free((void *)capture.audio);
+}
+
+static void TEST_vNoMetadata(void)
+{
+    static TEST_tstCapture capture;
+    unsigned long split;
+
+    // Without icy-metaint everything is audio
+    capture.audio = TEST_pu8Load("captures/icy_metadata.bin", &capture.audio_length);
+    if (capture.audio == NULL)
+        return;
+    capture.title_count = 0;
+    for (split = 0; split <= capture.audio_length; split += 97)
+    {
+        TEST_vBegin(&capture, 0);
+        ICY_vProcess(&capture.parser, (char *)capture.audio, split);
+        ICY_vProcess(&capture.parser, (char *)capture.audio + split, capture.audio_length - split);
+        TEST_CHECK(TEST_bEnd(&capture));
+    }
+    free((void *)capture.audio);
+}
+
+int main(void)
+{
+    TEST_vReplay("icy_metadata", 1000);
+    TEST_vReplay("icy_long_block", 4096);
+    TEST_vNoMetadata();
+    return TEST_RESULT("test_icy");
+}
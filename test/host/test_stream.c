@@ -0,0 +1,215 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Streaming rig: httpclient.c, timer.c and the VS1053 driver run against Icecast stand-ins on the simulated
+// network and the chip model. Each scenario runs in its own process, the firmware modules keep their state
+// in globals that can't be reset. Built twice: test_stream and test_stream_standby (WARM_STANDBY defined).
+
+#include <esp8266.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "sdk.h"
+#include "httpclient.h"
+#include "timer.h"
+#include "vs1053.h"
+#include "vs1053_model.h"
+#include "icecast.h"
+#include "test.h"
+
+#define TEST_HOST_A     "icecast-a.test"
+#define TEST_HOST_B     "icecast-b.test"
+#define TEST_IP_A       "10.0.0.1"
+#define TEST_IP_B       "10.0.0.2"
+#define TEST_URL_A      "http://" TEST_HOST_A ":8000/stream"
+#define TEST_URL_B      "http://" TEST_HOST_B ":8000/stream"
+
+typedef struct
+{
+    const char *name;
+    ICE_tstConfig config;
+    uint32 duration; // in s
+    uint32 max_ttfa; // in ms
+    uint32 underruns;
+    uint32 min_stalls;
+    uint32 max_stalls;
+    uint32 min_reconnects;
+    uint32 max_connections; // To the station (stalls and reconnects open new ones)
+} TEST_tstScenario;
+
+#ifdef WARM_STANDBY
+#define TEST_NAME       "test_stream_standby"
+#else
+#define TEST_NAME       "test_stream"
+#endif
+
+static const TEST_tstScenario TEST_stScenarios[] =
+{
+    // kbit/s, metaint, burst, jitter, stall start/duration, disconnect   s, ttfa, underruns, stalls, reconnects, connections
+    { "steady",         { 128, 16000, 65536, 0, 0, 0, 0 }, 30, 1500, 0, 0, 0, 0, 1 },
+    { "no burst",       { 128, 16000, 0, 100000, 0, 0, 0 }, 30, 2500, 0, 0, 0, 0, 1 },
+    { "320 kbit/s",     { 320, 16000, 65536, 50000, 0, 0, 0 }, 30, 1500, 0, 0, 0, 0, 1 },
+    { "stall 4 s",      { 128, 16000, 65536, 50000, 10000000, 4000000, 0 }, 30, 1500, 0, 1, 2, 0, 3 },
+    // Closed every 10 s => Reconnect at 10 s and 20 s
+    { "disconnect",     { 128, 16000, 65536, 50000, 0, 0, 10000000 }, 30, 1500, 0, 0, 0, 2, 3 }
+};
+
+static ICE_tstServer TEST_stServerA;
+static ICE_tstServer TEST_stServerB;
+
+static void TEST_vStart(const ICE_tstConfig *config)
+{
+    VSMODEL_tstConfig model = { 0 };
+
+    SDK_vReset();
+    SDK_bAddHost(TEST_HOST_A, TEST_IP_A);
+    SDK_bAddHost(TEST_HOST_B, TEST_IP_B);
+    ICE_bInit(&TEST_stServerA, config, TEST_IP_A, 8000);
+    ICE_bInit(&TEST_stServerB, config, TEST_IP_B, 8000);
+    model.bitrate = config->bitrate * 1000;
+    model.sample_rate = 44100;
+    model.stereo = 1;
+    model.cancel_bytes = 64;
+    VSMODEL_vInit(&model);
+    // Start sequence of user_init() and the got IP event
+    VS1053_vInit();
+    Time_vTimerInit();
+}
+
+static void TEST_vPrint(const char *name, uint32 duration)
+{
+    VSMODEL_tstReport report;
+    SDK_tstNetworkStatistics network;
+
+    VSMODEL_vGetReport(&report);
+    SDK_vGetNetworkStatistics(&network);
+    printf("%-16s %5u %5u %6u %8.1f %6u %6u %6u %6u %8u %5u %5u %6.2f\n",
+        name,
+        HTTPC_u32GetTimeToFirstByte(),
+        HTTPC_u32GetTimeToFirstAudio(),
+        report.underruns,
+        report.underrun_time / 1e3,
+        VS1053_u16GetPeakBufferSize(),
+        HTTPC_u32GetStalls(),
+        HTTPC_u32GetReconnectCount(),
+        HTTPC_u32GetHoldCount(),
+        HTTPC_u32GetDroppedBytes(),
+        HTTPC_u32GetSyncLost(),
+        network.connections,
+        (HTTPC_u32GetReceiveTime() + VS1053_u32GetFeederBusyTime()) / (duration * 1e4));
+}
+
+static void TEST_vScenario(const TEST_tstScenario *scenario)
+{
+    VSMODEL_tstReport report;
+
+    TEST_vStart(&scenario->config);
+    HTTPC_vStartStreaming(TEST_URL_A, "Icy-MetaData:1\r\n", Timer_StreamingCallback);
+    SDK_vRun(scenario->duration * 1000000);
+    TEST_vPrint(scenario->name, scenario->duration);
+
+    VSMODEL_vGetReport(&report);
+    TEST_CHECK(HTTPC_u32GetTimeToFirstAudio() != 0);
+    TEST_CHECK(HTTPC_u32GetTimeToFirstAudio() <= scenario->max_ttfa);
+    TEST_CHECK(report.underruns <= scenario->underruns);
+    TEST_CHECK(HTTPC_u32GetStalls() >= scenario->min_stalls);
+    TEST_CHECK(HTTPC_u32GetStalls() <= scenario->max_stalls);
+    TEST_CHECK(HTTPC_u32GetReconnectCount() >= scenario->min_reconnects);
+    TEST_CHECK(TEST_stServerA.statistics.connections <= scenario->max_connections);
+    TEST_CHECK_EQUAL(HTTPC_u32GetSyncLost(), 0);
+    TEST_CHECK_EQUAL(report.overflow_bytes, 0);
+    TEST_CHECK_EQUAL(report.protocol_errors, 0);
+    // Playback went on until the end (stream recovered)
+    TEST_CHECK(VSMODEL_u32GetFifoLevel() != 0);
+}
+
+#ifdef WARM_STANDBY
+static void TEST_vStandby(const ICE_tstConfig *config)
+{
+    uint32 ttfa_b;
+
+    // A -> B -> A: Old stream stays open as standby, switching back takes it over again
+    TEST_vStart(config);
+    HTTPC_vStartStreaming(TEST_URL_A, "Icy-MetaData:1\r\n", Timer_StreamingCallback);
+    SDK_vRun(10000000);
+    HTTPC_vStartStreaming(TEST_URL_B, "Icy-MetaData:1\r\n", Timer_StreamingCallback);
+    SDK_vRun(10000000);
+    ttfa_b = HTTPC_u32GetTimeToFirstAudio();
+    TEST_CHECK(!HTTPC_bIsTimeToFirstAudioStandby());
+    HTTPC_vStartStreaming(TEST_URL_A, "Icy-MetaData:1\r\n", Timer_StreamingCallback);
+    SDK_vRun(10000000);
+    TEST_vPrint("standby A-B-A", 30);
+
+    TEST_CHECK(HTTPC_bIsTimeToFirstAudioStandby());
+    TEST_CHECK(HTTPC_u32GetTimeToFirstAudio() < ttfa_b);
+    TEST_CHECK_EQUAL(TEST_stServerA.statistics.connections, 1);
+    TEST_CHECK_EQUAL(TEST_stServerB.statistics.connections, 1);
+    TEST_CHECK(VSMODEL_u32GetFifoLevel() != 0);
+}
+#endif
+
+static void TEST_vRun(const TEST_tstScenario *scenario)
+{
+    pid_t pid;
+    int status;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0)
+    {
+        // Counts failures of this scenario only
+        TEST_uFailed = 0;
+        if (scenario != NULL)
+            TEST_vScenario(scenario);
+#ifdef WARM_STANDBY
+        else
+            TEST_vStandby(&TEST_stScenarios[0].config);
+#endif
+        fflush(stdout);
+        _exit(TEST_uFailed ? 1 : 0);
+    }
+    if ((pid < 0) || (waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+    {
+        printf("%s: scenario failed\n", (scenario != NULL) ? scenario->name : "standby");
+        TEST_uFailed++;
+    }
+}
+
+int main(void)
+{
+#ifndef WARM_STANDBY
+    uint8 i;
+#endif
+
+    printf("Streaming rig, MP3 at 44.1 kHz from Icecast stand-ins (latency 20 ms, window 5840 bytes)\n");
+    printf("%-16s %5s %5s %6s %8s %6s %6s %6s %6s %8s %5s %5s %6s\n",
+        "scenario", "ttfb", "ttfa", "underr", "silence", "peak", "stalls", "recon", "holds", "dropped", "sync", "conn", "cpu");
+    printf("%-16s %5s %5s %6s %8s %6s %6s %6s %6s %8s %5s %5s %6s\n",
+        "", "ms", "ms", "", "ms", "bytes", "", "", "", "bytes", "lost", "", "%");
+#ifdef WARM_STANDBY
+    TEST_vRun(NULL);
+#else
+    for (i = 0; i < sizeof(TEST_stScenarios) / sizeof(TEST_stScenarios[0]); i++)
+        TEST_vRun(&TEST_stScenarios[i]);
+#endif
+    return TEST_RESULT(TEST_NAME);
+}
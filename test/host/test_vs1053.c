@@ -0,0 +1,186 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// vs1053.c against the VS1053 model: Init sequence, DREQ driven feeding, underrun and cancel
+
+#include <esp8266.h>
+#include "sdk.h"
+#include "vs1053.h"
+#include "vs1053_model.h"
+#include "test.h"
+
+#define TEST_BITRATE        128000
+// Producer delivers one second of audio in 10 ms steps
+#define TEST_PRODUCER_MS    10
+#define TEST_PRODUCER_BYTES (TEST_BITRATE / 8 / (1000 / TEST_PRODUCER_MS))
+
+static os_timer_t TEST_stProducer;
+static uint32 TEST_u32Produced;
+static uint32 TEST_u32Received;
+static bool TEST_bInOrder;
+
+static void TEST_vProduce(void *arg)
+{
+    uint8 data[TEST_PRODUCER_BYTES];
+    uint32 i;
+
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = (uint8)(TEST_u32Produced + i);
+    TEST_u32Produced += VS1053_u32WriteRingBuffer(data, sizeof(data));
+}
+
+static void TEST_vSink(void *arg, const uint8 *data, uint32 length)
+{
+    uint32 i;
+
+    // Chip has to get the bytes in the order they have been written
+    for (i = 0; i < length; i++)
+        if (data[i] != (uint8)(TEST_u32Received + i))
+            TEST_bInOrder = 0;
+    TEST_u32Received += length;
+}
+
+static void TEST_vStart(uint32 cancel_bytes)
+{
+    VSMODEL_tstConfig config = { 0 };
+
+    SDK_vReset();
+    config.bitrate = TEST_BITRATE;
+    config.sample_rate = 44100;
+    config.stereo = 1;
+    config.cancel_bytes = cancel_bytes;
+    config.sdi_sink = TEST_vSink;
+    VSMODEL_vInit(&config);
+    TEST_u32Produced = 0;
+    TEST_u32Received = 0;
+    TEST_bInOrder = 1;
+    VS1053_vInit();
+    VS1053_vFlushRingBuffer();
+}
+
+static void TEST_vInit(void)
+{
+    VSMODEL_tstReport report;
+
+    TEST_vStart(64);
+    VSMODEL_vGetReport(&report);
+    TEST_CHECK_EQUAL(report.hardware_resets, 1);
+    TEST_CHECK_EQUAL(report.protocol_errors, 0);
+    TEST_CHECK_EQUAL(VSMODEL_u16GetRegister(0x03), 0xF800);
+    TEST_CHECK_EQUAL(VSMODEL_u16GetRegister(0x00), 0x4802);
+    // Volume 50 % of stored setting
+    TEST_CHECK_EQUAL(VSMODEL_u16GetRegister(0x0B), 0x8282);
+    // Driver counts the same SCI accesses the chip sees
+    TEST_CHECK_EQUAL(VS1053_u32GetSciReads(), report.sci_reads);
+    TEST_CHECK_EQUAL(VS1053_u32GetSciWrites(), report.sci_writes);
+    TEST_CHECK_EQUAL(VS1053_u16ReadSampleRate(), 0);
+}
+
+static void TEST_vStreaming(void)
+{
+    VSMODEL_tstReport report;
+    uint8 i;
+
+    TEST_vStart(64);
+    os_timer_setfn(&TEST_stProducer, TEST_vProduce, NULL);
+    os_timer_arm(&TEST_stProducer, TEST_PRODUCER_MS, 1);
+    // Prebuffer 0.5 s, then play 10 s
+    SDK_vRun(500000);
+    VS1053_vEnableFeeder(1);
+    SDK_vRun(10000000);
+    VSMODEL_vPrintReport("streaming");
+    VSMODEL_vGetReport(&report);
+    TEST_CHECK_EQUAL(report.underruns, 0);
+    TEST_CHECK_EQUAL(report.overflow_bytes, 0);
+    TEST_CHECK_EQUAL(report.protocol_errors, 0);
+    TEST_CHECK(TEST_bInOrder);
+    TEST_CHECK_EQUAL(TEST_u32Received, report.sdi_bytes);
+    // Feeder refills the FIFO on every DREQ edge => It never drops far below the DREQ threshold
+    TEST_CHECK(report.fifo_min >= VSMODEL_FIFO_SIZE - 256);
+    TEST_CHECK(report.decoded_bytes >= 10 * TEST_BITRATE / 8 - 64);
+    TEST_CHECK_EQUAL(VS1053_u16ReadDecodedTime(), 10);
+    TEST_CHECK_EQUAL(VS1053_u16ReadSampleRate(), 44100);
+    TEST_CHECK_EQUAL(VS1053_u8ReadChannelCount(), 1);
+    TEST_CHECK_EQUAL(VS1053_u8ReadFileType(), 1);
+    TEST_CHECK_EQUAL(VS1053_u8ReadBitRate(), 128);
+    TEST_CHECK_EQUAL(VS1053_u32GetUnderruns(), 0);
+
+    // Producer stops: Ring buffer (0.5 s) and FIFO run empty
+    os_timer_disarm(&TEST_stProducer);
+    SDK_vRun(2000000);
+    VSMODEL_vGetReport(&report);
+    TEST_CHECK_EQUAL(report.underruns, 1);
+    TEST_CHECK(report.underrun_time > 1000000);
+    TEST_CHECK_EQUAL(VS1053_u16GetUsedBufferSize(), 0);
+
+    // Producer resumes with a burst of 0.5 s (like a server after a stall): Playback continues without a reset
+    for (i = 0; i < 50; i++)
+        TEST_vProduce(NULL);
+    os_timer_arm(&TEST_stProducer, TEST_PRODUCER_MS, 1);
+    SDK_vRun(1000000);
+    VSMODEL_vGetReport(&report);
+    TEST_CHECK_EQUAL(report.underruns, 1);
+    TEST_CHECK_EQUAL(report.overflow_bytes, 0);
+    TEST_CHECK(TEST_bInOrder);
+    os_timer_disarm(&TEST_stProducer);
+}
+
+static void TEST_vCancel(uint32 cancel_bytes)
+{
+    VSMODEL_tstReport report;
+
+    TEST_vStart(cancel_bytes);
+    os_timer_setfn(&TEST_stProducer, TEST_vProduce, NULL);
+    os_timer_arm(&TEST_stProducer, TEST_PRODUCER_MS, 1);
+    VS1053_vEnableFeeder(1);
+    SDK_vRun(1000000);
+    os_timer_disarm(&TEST_stProducer);
+    VS1053_vCancelPlayback();
+    VSMODEL_vGetReport(&report);
+    TEST_CHECK_EQUAL(VS1053_u16GetUsedBufferSize(), 0);
+    TEST_CHECK_EQUAL(VSMODEL_u32GetFifoLevel(), 0);
+    TEST_CHECK_EQUAL(VSMODEL_u16GetRegister(0x00) & 0x000C, 0);
+    TEST_CHECK_EQUAL(VSMODEL_u16GetRegister(0x03), 0xF800);
+    TEST_CHECK_EQUAL(report.protocol_errors, 0);
+    TEST_CHECK_EQUAL(report.overflow_bytes, 0);
+    if (cancel_bytes != 0)
+    {
+        TEST_CHECK_EQUAL(report.cancels, 1);
+        TEST_CHECK_EQUAL(report.software_resets, 0);
+    }
+    else
+    {
+        // Chip does not react => Driver falls back to software reset
+        TEST_CHECK_EQUAL(report.cancels, 0);
+        TEST_CHECK_EQUAL(report.software_resets, 1);
+    }
+}
+
+int main(void)
+{
+    TEST_vInit();
+    TEST_vStreaming();
+    TEST_vCancel(64);
+    TEST_vCancel(0);
+    return TEST_RESULT("test_vs1053");
+}
@@ -0,0 +1,522 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <esp8266.h>
+#include "sdk.h"
+#include "vs1053_model.h"
+
+// SCI instructions and registers (see vs1053.c)
+#define VSMODEL_SCI_WRITE       0x02
+#define VSMODEL_SCI_READ        0x03
+#define VSMODEL_SCI_MODE        0x00
+#define VSMODEL_SCI_STATUS      0x01
+#define VSMODEL_SCI_CLOCKF      0x03
+#define VSMODEL_SCI_DECODE_TIME 0x04
+#define VSMODEL_SCI_AUDATA      0x05
+#define VSMODEL_SCI_WRAM        0x06
+#define VSMODEL_SCI_WRAMADDR    0x07
+#define VSMODEL_SCI_HDAT0       0x08
+#define VSMODEL_SCI_HDAT1       0x09
+#define VSMODEL_SM_RESET        0x0004
+#define VSMODEL_SM_CANCEL       0x0008
+#define VSMODEL_PARA_END_FILL   0x1E06
+// Reset values
+#define VSMODEL_MODE_DEFAULT    0x4800
+#define VSMODEL_STATUS_DEFAULT  0x0040
+// Crystal frequency in Hz
+#define VSMODEL_XTALI           12288000
+
+typedef struct
+{
+    VSMODEL_tstConfig config;
+    // Pins
+    uint8 xreset;
+    uint8 xcs;
+    uint8 xdcs;
+    uint8 dreq;
+    // SCI
+    uint16 sci[16];
+    uint8 sci_position; // 16 bit words received since XCS went low
+    uint8 sci_opcode;
+    uint8 sci_address;
+    uint16 wram_address;
+    sint32 decode_time_offset; // In s
+    uint64 busy_until; // DREQ is low until then (reset, SCI command)
+    // SDI and decoder
+    double fifo; // Bytes in FIFO (decoder takes fractions of bytes)
+    double decoded;
+    bool playing; // Data received since last reset or cancel
+    bool filled; // FIFO has been full since playback started
+    bool underrun;
+    bool cancel_pending;
+    uint32 cancel_count;
+    bool edge_pending; // DREQ went high because the decoder made space, no data sent since
+    double edge_time; // Exact time of that edge in us
+    double latency_sum;
+    uint32 latency_count;
+    uint64 update_time;
+    uint32 spend_ns; // Transfer time not spent yet (less than 1 us)
+    // Report
+    VSMODEL_tstReport report;
+    double fifo_area; // Integral of FIFO level over play time
+} VSMODEL_tstChip;
+
+static VSMODEL_tstChip VSMODEL_stChip;
+
+static void VSMODEL_vResetRegisters(void)
+{
+    os_memset(VSMODEL_stChip.sci, 0, sizeof(VSMODEL_stChip.sci));
+    VSMODEL_stChip.sci[VSMODEL_SCI_MODE] = VSMODEL_MODE_DEFAULT;
+    VSMODEL_stChip.sci[VSMODEL_SCI_STATUS] = VSMODEL_STATUS_DEFAULT;
+    VSMODEL_stChip.decode_time_offset = 0;
+}
+
+static void VSMODEL_vStopPlayback(void)
+{
+    // Decoder forgets everything received so far
+    VSMODEL_stChip.fifo = 0;
+    VSMODEL_stChip.decoded = 0;
+    VSMODEL_stChip.playing = 0;
+    VSMODEL_stChip.filled = 0;
+    VSMODEL_stChip.underrun = 0;
+    VSMODEL_stChip.cancel_pending = 0;
+    VSMODEL_stChip.edge_pending = 0;
+}
+
+static void VSMODEL_vDecode(uint64 duration)
+{
+    double rate = VSMODEL_stChip.config.bitrate / 8e6; // Bytes per us
+    double drain = rate * duration;
+    double threshold = VSMODEL_FIFO_SIZE - VSMODEL_DREQ_FREE;
+    double empty;
+
+    VSMODEL_stChip.report.play_time += duration;
+    // Remember when the chip asked for data (updates are not done at the exact time of the edge)
+    if ((VSMODEL_stChip.fifo > threshold) && (VSMODEL_stChip.fifo - drain <= threshold))
+    {
+        VSMODEL_stChip.edge_pending = 1;
+        VSMODEL_stChip.edge_time = VSMODEL_stChip.update_time + (VSMODEL_stChip.fifo - threshold) / rate;
+    }
+    if (VSMODEL_stChip.fifo >= drain)
+    {
+        VSMODEL_stChip.fifo_area += (VSMODEL_stChip.fifo - drain / 2) * duration;
+        VSMODEL_stChip.fifo -= drain;
+        VSMODEL_stChip.decoded += drain;
+    }
+    else
+    {
+        // FIFO runs empty within this interval => Decoder is starving for the rest of it
+        empty = VSMODEL_stChip.fifo / rate;
+        VSMODEL_stChip.fifo_area += VSMODEL_stChip.fifo * empty / 2;
+        VSMODEL_stChip.decoded += VSMODEL_stChip.fifo;
+        VSMODEL_stChip.fifo = 0;
+        VSMODEL_stChip.report.underrun_time += duration - (uint64)empty;
+        if (!VSMODEL_stChip.underrun)
+        {
+            VSMODEL_stChip.underrun = 1;
+            VSMODEL_stChip.report.underruns++;
+        }
+    }
+    if (VSMODEL_stChip.filled && (VSMODEL_stChip.fifo < VSMODEL_stChip.report.fifo_min))
+        VSMODEL_stChip.report.fifo_min = VSMODEL_stChip.fifo;
+}
+
+static void VSMODEL_vUpdate(void)
+{
+    uint64 now = SDK_u64GetTime();
+    uint8 dreq;
+
+    // Decoder consumes data at stream bitrate since last update
+    if (VSMODEL_stChip.playing && VSMODEL_stChip.xreset && (now > VSMODEL_stChip.update_time) && (VSMODEL_stChip.config.bitrate != 0))
+        VSMODEL_vDecode(now - VSMODEL_stChip.update_time);
+    VSMODEL_stChip.update_time = now;
+
+    dreq = VSMODEL_stChip.xreset
+        && (now >= VSMODEL_stChip.busy_until)
+        && (VSMODEL_FIFO_SIZE - VSMODEL_stChip.fifo >= VSMODEL_DREQ_FREE);
+    if (dreq == VSMODEL_stChip.dreq)
+        return;
+    VSMODEL_stChip.dreq = dreq;
+    if (dreq)
+        VSMODEL_stChip.report.dreq_edges++;
+    // Edge raises the GPIO interrupt of the driver
+    SDK_vSetGpioInput(VSMODEL_DREQ_GPIO, dreq);
+}
+
+static uint64 VSMODEL_u64Poll(void *arg)
+{
+    double rate = VSMODEL_stChip.config.bitrate / 8e6;
+    double excess;
+    uint64 now;
+
+    VSMODEL_vUpdate();
+    now = SDK_u64GetTime();
+    if (!VSMODEL_stChip.xreset)
+        return UINT64_MAX;
+    if (now < VSMODEL_stChip.busy_until)
+        return VSMODEL_stChip.busy_until;
+    if (!VSMODEL_stChip.playing || (rate == 0))
+        return UINT64_MAX;
+    // Next DREQ rising edge
+    if (!VSMODEL_stChip.dreq)
+    {
+        excess = VSMODEL_stChip.fifo - (VSMODEL_FIFO_SIZE - VSMODEL_DREQ_FREE);
+        return now + 1 + (uint64)(excess / rate);
+    }
+    // FIFO runs empty (underrun is detected in time)
+    if (VSMODEL_stChip.fifo > 0)
+        return now + 1 + (uint64)(VSMODEL_stChip.fifo / rate);
+    return UINT64_MAX;
+}
+
+static void VSMODEL_vTransfer(uint32 bits)
+{
+    uint32 ns;
+
+    // Transfer blocks the CPU (SPI driver waits until the transaction is done)
+    ns = VSMODEL_stChip.spend_ns + VSMODEL_SPI_OVERHEAD + (uint32)((uint64)bits * 1000000000 / SDK_u32GetSpiClock());
+    SDK_vSpend(ns / 1000);
+    VSMODEL_stChip.spend_ns = ns % 1000;
+    VSMODEL_vUpdate();
+}
+
+static void VSMODEL_vCheckClock(void)
+{
+    static const uint8 multiplier[8] = { 2, 4, 5, 6, 7, 8, 9, 10 }; // SC_MULT in steps of 0.5
+    uint32 clki = VSMODEL_XTALI / 2 * multiplier[VSMODEL_stChip.sci[VSMODEL_SCI_CLOCKF] >> 13];
+
+    // Data sheet: SPI clock for writes must not exceed CLKI/4
+    if (SDK_u32GetSpiClock() > clki / 4)
+        VSMODEL_stChip.report.protocol_errors++;
+}
+
+static uint32 VSMODEL_u32DecodeTime(void)
+{
+    // Seconds of audio decoded
+    if (VSMODEL_stChip.config.bitrate == 0)
+        return 0;
+    return VSMODEL_stChip.decoded * 8 / VSMODEL_stChip.config.bitrate;
+}
+
+static void VSMODEL_vSciWrite(uint8 address, uint16 value)
+{
+    uint16 mode = VSMODEL_stChip.sci[VSMODEL_SCI_MODE];
+
+    VSMODEL_stChip.report.sci_writes++;
+    VSMODEL_stChip.busy_until = SDK_u64GetTime() + VSMODEL_SCI_TIME;
+    switch (address)
+    {
+        case VSMODEL_SCI_MODE:
+            if (value & VSMODEL_SM_RESET)
+            {
+                // Software reset: Clock setting is lost, bit clears itself
+                VSMODEL_stChip.report.software_resets++;
+                VSMODEL_vStopPlayback();
+                VSMODEL_stChip.sci[VSMODEL_SCI_CLOCKF] = 0;
+                VSMODEL_stChip.busy_until = SDK_u64GetTime() + VSMODEL_RESET_TIME;
+                value &= ~VSMODEL_SM_RESET;
+            }
+            else if ((value & VSMODEL_SM_CANCEL) && !(mode & VSMODEL_SM_CANCEL))
+            {
+                VSMODEL_stChip.cancel_pending = 1;
+                VSMODEL_stChip.cancel_count = 0;
+            }
+            VSMODEL_stChip.sci[address] = value;
+            break;
+        case VSMODEL_SCI_DECODE_TIME:
+            VSMODEL_stChip.decode_time_offset = value - VSMODEL_u32DecodeTime();
+            break;
+        case VSMODEL_SCI_WRAM:
+            if (VSMODEL_stChip.wram_address == VSMODEL_PARA_END_FILL)
+                VSMODEL_stChip.config.end_fill_byte = value & 0xFF;
+            VSMODEL_stChip.wram_address++;
+            break;
+        case VSMODEL_SCI_WRAMADDR:
+            VSMODEL_stChip.wram_address = value;
+            break;
+        default:
+            VSMODEL_stChip.sci[address] = value;
+            break;
+    }
+}
+
+static uint16 VSMODEL_u16SciRead(uint8 address)
+{
+    uint16 value;
+
+    VSMODEL_stChip.report.sci_reads++;
+    switch (address)
+    {
+        case VSMODEL_SCI_DECODE_TIME:
+            return VSMODEL_stChip.decode_time_offset + VSMODEL_u32DecodeTime();
+        case VSMODEL_SCI_AUDATA:
+            if (!VSMODEL_stChip.playing)
+                return 0;
+            return (VSMODEL_stChip.config.sample_rate & 0xFFFE) | VSMODEL_stChip.config.stereo;
+        case VSMODEL_SCI_WRAM:
+            value = 0;
+            if (VSMODEL_stChip.wram_address == VSMODEL_PARA_END_FILL)
+                value = VSMODEL_stChip.config.end_fill_byte;
+            VSMODEL_stChip.wram_address++;
+            return value;
+        case VSMODEL_SCI_HDAT0:
+            // Byte rate in 8 byte/s steps (driver multiplies with 8)
+            return VSMODEL_stChip.playing ? VSMODEL_stChip.config.bitrate / 1000 / 8 : 0;
+        case VSMODEL_SCI_HDAT1:
+            // MPEG layer 3 sync word
+            return VSMODEL_stChip.playing ? 0xFFFB : 0;
+        default:
+            return VSMODEL_stChip.sci[address];
+    }
+}
+
+static uint16 VSMODEL_u16SciWord(uint16 word)
+{
+    switch (VSMODEL_stChip.sci_position++)
+    {
+        case 0:
+            // Instruction and address
+            VSMODEL_stChip.sci_opcode = word >> 8;
+            VSMODEL_stChip.sci_address = word & 0xFF;
+            return 0;
+        case 1:
+            if (VSMODEL_stChip.sci_address >= 16)
+                break;
+            if (VSMODEL_stChip.sci_opcode == VSMODEL_SCI_WRITE)
+            {
+                VSMODEL_vSciWrite(VSMODEL_stChip.sci_address, word);
+                return 0;
+            }
+            if (VSMODEL_stChip.sci_opcode == VSMODEL_SCI_READ)
+                return VSMODEL_u16SciRead(VSMODEL_stChip.sci_address);
+            break;
+        default:
+            break;
+    }
+    // Unknown instruction, invalid address or more than one register per chip select
+    VSMODEL_stChip.report.protocol_errors++;
+    return 0;
+}
+
+static void VSMODEL_vSdiWrite(const uint8 *data, uint32 length)
+{
+    uint32 free;
+    uint32 latency;
+
+    if (!VSMODEL_stChip.xreset)
+        return;
+    if (VSMODEL_stChip.cancel_pending)
+    {
+        // Decoder stops after it has seen enough of the fill bytes. Data is not played.
+        VSMODEL_stChip.cancel_count += length;
+        if ((VSMODEL_stChip.config.cancel_bytes != 0) && (VSMODEL_stChip.cancel_count >= VSMODEL_stChip.config.cancel_bytes))
+        {
+            VSMODEL_stChip.report.cancels++;
+            VSMODEL_stChip.sci[VSMODEL_SCI_MODE] &= ~VSMODEL_SM_CANCEL;
+            VSMODEL_vStopPlayback();
+        }
+        return;
+    }
+    // Data sent while the FIFO is full is lost (driver has to check DREQ before every 32 bytes)
+    free = VSMODEL_FIFO_SIZE - (uint32)VSMODEL_stChip.fifo;
+    if (length > free)
+    {
+        VSMODEL_stChip.report.overflow_bytes += length - free;
+        length = free;
+    }
+    if (length == 0)
+        return;
+    if (VSMODEL_stChip.edge_pending)
+    {
+        latency = SDK_u64GetTime() - VSMODEL_stChip.edge_time;
+        VSMODEL_stChip.edge_pending = 0;
+        VSMODEL_stChip.latency_sum += latency;
+        VSMODEL_stChip.latency_count++;
+        if (latency > VSMODEL_stChip.report.latency_max)
+            VSMODEL_stChip.report.latency_max = latency;
+    }
+    VSMODEL_stChip.fifo += length;
+    VSMODEL_stChip.report.sdi_bytes += length;
+    VSMODEL_stChip.playing = 1;
+    VSMODEL_stChip.underrun = 0;
+    if (VSMODEL_stChip.fifo >= VSMODEL_FIFO_SIZE - VSMODEL_DREQ_FREE)
+        VSMODEL_stChip.filled = 1;
+    if (VSMODEL_stChip.fifo > VSMODEL_stChip.report.fifo_max)
+        VSMODEL_stChip.report.fifo_max = VSMODEL_stChip.fifo;
+    if (VSMODEL_stChip.config.sdi_sink != NULL)
+        VSMODEL_stChip.config.sdi_sink(VSMODEL_stChip.config.arg, data, length);
+}
+
+void VSMODEL_vInit(const VSMODEL_tstConfig *config)
+{
+    os_memset(&VSMODEL_stChip, 0, sizeof(VSMODEL_stChip));
+    VSMODEL_stChip.config = *config;
+    VSMODEL_stChip.report.fifo_min = VSMODEL_FIFO_SIZE;
+    VSMODEL_stChip.xreset = 1;
+    VSMODEL_stChip.xcs = 1;
+    VSMODEL_stChip.xdcs = 1;
+    VSMODEL_stChip.update_time = SDK_u64GetTime();
+    VSMODEL_vResetRegisters();
+    VSMODEL_vUpdate();
+    SDK_vAddDevice(VSMODEL_u64Poll, NULL);
+}
+
+void VSMODEL_vSetBitrate(uint32 bitrate)
+{
+    VSMODEL_vUpdate();
+    VSMODEL_stChip.config.bitrate = bitrate;
+}
+
+uint16 VSMODEL_u16GetRegister(uint8 address)
+{
+    return VSMODEL_stChip.sci[address & 0x0F];
+}
+
+uint32 VSMODEL_u32GetFifoLevel(void)
+{
+    VSMODEL_vUpdate();
+    return VSMODEL_stChip.fifo;
+}
+
+void VSMODEL_vGetReport(VSMODEL_tstReport *report)
+{
+    VSMODEL_vUpdate();
+    *report = VSMODEL_stChip.report;
+    report->decoded_bytes = VSMODEL_stChip.decoded;
+    report->fifo_average = 0;
+    if (report->play_time != 0)
+        report->fifo_average = VSMODEL_stChip.fifo_area / report->play_time;
+    report->latency_average = 0;
+    if (VSMODEL_stChip.latency_count != 0)
+        report->latency_average = VSMODEL_stChip.latency_sum / VSMODEL_stChip.latency_count;
+    if (!VSMODEL_stChip.filled && (report->fifo_min == VSMODEL_FIFO_SIZE))
+        report->fifo_min = 0;
+}
+
+void VSMODEL_vPrintReport(const char *name)
+{
+    VSMODEL_tstReport report;
+
+    VSMODEL_vGetReport(&report);
+    printf("%s: VS1053 model after %.3f s\n", name, SDK_u64GetTime() / 1e6);
+    printf("  SDI bytes %llu, decoded %llu, overflow %u\n",
+        (unsigned long long)report.sdi_bytes, (unsigned long long)report.decoded_bytes, report.overflow_bytes);
+    printf("  FIFO min %u, avg %u, max %u of %u bytes over %.3f s playing\n",
+        report.fifo_min, report.fifo_average, report.fifo_max, VSMODEL_FIFO_SIZE, report.play_time / 1e6);
+    printf("  Underruns %u (%.3f s silence), DREQ edges %u, latency avg %u us, max %u us\n",
+        report.underruns, report.underrun_time / 1e6, report.dreq_edges, report.latency_average, report.latency_max);
+    printf("  SCI reads %u, writes %u, resets hw %u / sw %u, cancels %u, protocol errors %u\n",
+        report.sci_reads, report.sci_writes, report.hardware_resets, report.software_resets, report.cancels, report.protocol_errors);
+}
+
+uint8 VSMODEL_u8Dreq(void)
+{
+    VSMODEL_vUpdate();
+    // Busy waiting for DREQ takes time
+    if (!VSMODEL_stChip.dreq)
+    {
+        SDK_vSpend(1);
+        VSMODEL_vUpdate();
+    }
+    return VSMODEL_stChip.dreq;
+}
+
+void VSMODEL_vXReset(uint8 value)
+{
+    VSMODEL_vUpdate();
+    if (VSMODEL_stChip.xreset && !value)
+    {
+        // Chip is held in reset: Everything is lost
+        VSMODEL_stChip.report.hardware_resets++;
+        VSMODEL_vStopPlayback();
+        VSMODEL_vResetRegisters();
+    }
+    else if (!VSMODEL_stChip.xreset && value)
+    {
+        // Chip boots
+        VSMODEL_stChip.busy_until = SDK_u64GetTime() + VSMODEL_RESET_TIME;
+    }
+    VSMODEL_stChip.xreset = value ? 1 : 0;
+    VSMODEL_vUpdate();
+}
+
+void VSMODEL_vXCs(uint8 value)
+{
+    // New SCI transaction starts with falling edge
+    if (VSMODEL_stChip.xcs && !value)
+        VSMODEL_stChip.sci_position = 0;
+    VSMODEL_stChip.xcs = value ? 1 : 0;
+}
+
+void VSMODEL_vXDcs(uint8 value)
+{
+    VSMODEL_stChip.xdcs = value ? 1 : 0;
+}
+
+uint32 VSMODEL_u32Spi(uint32 value, uint8 bits)
+{
+    uint8 data[4];
+    uint32 result = 0;
+    uint8 i;
+
+    VSMODEL_vTransfer(bits);
+    VSMODEL_vCheckClock();
+    if (!VSMODEL_stChip.xreset || (!VSMODEL_stChip.xcs && !VSMODEL_stChip.xdcs) || (bits % 16))
+    {
+        VSMODEL_stChip.report.protocol_errors++;
+        return 0;
+    }
+    if (!VSMODEL_stChip.xcs)
+    {
+        // SCI: 16 bit words, most significant first
+        for (i = bits; i > 0; i -= 16)
+            result = (result << 16) | VSMODEL_u16SciWord((value >> (i - 16)) & 0xFFFF);
+    }
+    else if (!VSMODEL_stChip.xdcs)
+    {
+        for (i = 0; i < bits / 8; i++)
+            data[i] = value >> (bits - 8 * (i + 1));
+        VSMODEL_vSdiWrite(data, bits / 8);
+    }
+    else
+    {
+        VSMODEL_stChip.report.protocol_errors++;
+    }
+    VSMODEL_vUpdate();
+    return result;
+}
+
+uint32 VSMODEL_u32SpiBlock(const uint8 *data, uint32 length)
+{
+    VSMODEL_vTransfer(length * 8);
+    VSMODEL_vCheckClock();
+    if (!VSMODEL_stChip.xreset || !VSMODEL_stChip.xcs || VSMODEL_stChip.xdcs)
+    {
+        // Blocks are only used for SDI
+        VSMODEL_stChip.report.protocol_errors++;
+        return 0;
+    }
+    VSMODEL_vSdiWrite(data, length);
+    VSMODEL_vUpdate();
+    return length;
+}
@@ -0,0 +1,103 @@
+#ifndef HOST_VS1053_MODEL_H_
+#define HOST_VS1053_MODEL_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Model of the VS1053 as seen from the SPI bus: SCI register file, 2048 byte SDI FIFO with DREQ and a decoder
+// that consumes the FIFO at the stream bitrate. vs1053.c is built against it with VS1053_MODEL defined, which
+// routes the hardware access macros of the driver to the functions below.
+
+#include "c_types.h"
+
+// Size of SDI FIFO. DREQ is high as long as at least 32 bytes are free.
+#define VSMODEL_FIFO_SIZE           2048
+#define VSMODEL_DREQ_FREE           32
+// DREQ stays low after hardware or software reset (22000 clock cycles at 12.288 MHz)
+#define VSMODEL_RESET_TIME          1800
+// DREQ stays low while a SCI command is processed in us
+#define VSMODEL_SCI_TIME            5
+// Time for toggling a chip select and setting up a SPI transaction of the ESP8266 in ns
+#define VSMODEL_SPI_OVERHEAD        1000
+// GPIO of DREQ (drives the interrupt of the driver)
+#define VSMODEL_DREQ_GPIO           4
+
+typedef void (*VSMODEL_tpfSdiSink)(void *arg, const uint8 *data, uint32 length);
+
+typedef struct
+{
+    uint32 bitrate; // Decoder consumption in bit/s
+    uint16 sample_rate; // Reported in SCI_AUDATA
+    bool stereo;
+    uint8 end_fill_byte; // Value of parameter endFillByte
+    uint32 cancel_bytes; // SM_CANCEL is cleared after this many SDI bytes (0 = never, forces software reset)
+    VSMODEL_tpfSdiSink sdi_sink; // Optional: Receives every SDI byte accepted by the chip
+    void *arg;
+} VSMODEL_tstConfig;
+
+typedef struct
+{
+    uint64 sdi_bytes; // Accepted into FIFO
+    uint64 decoded_bytes; // Consumed by decoder
+    uint32 overflow_bytes; // Sent while FIFO was full (lost, driver ignored DREQ)
+    uint32 underruns; // FIFO ran empty while playing
+    uint64 underrun_time; // Time the decoder had no data while playing in us
+    uint32 fifo_min; // Lowest FIFO level while playing (before first underrun of an empty FIFO it is 0)
+    uint32 fifo_max;
+    uint32 fifo_average; // Time weighted while playing
+    uint64 play_time; // Time with playback active in us
+    uint32 sci_reads;
+    uint32 sci_writes;
+    uint32 dreq_edges; // Rising edges of DREQ
+    uint32 latency_average; // Time from DREQ rising (FIFO drained below threshold) until next SDI data in us
+    uint32 latency_max;
+    uint32 hardware_resets;
+    uint32 software_resets;
+    uint32 cancels; // SM_CANCEL acknowledged by the chip
+    uint32 protocol_errors; // Both chip selects active, SPI clock too fast, data without chip select
+} VSMODEL_tstReport;
+
+void VSMODEL_vInit(const VSMODEL_tstConfig *config);
+void VSMODEL_vSetBitrate(uint32 bitrate);
+uint16 VSMODEL_u16GetRegister(uint8 address);
+uint32 VSMODEL_u32GetFifoLevel(void);
+void VSMODEL_vGetReport(VSMODEL_tstReport *report);
+void VSMODEL_vPrintReport(const char *name);
+
+// Hardware access of the driver (see VS1053_DREQ() and friends in vs1053.c)
+uint8 VSMODEL_u8Dreq(void);
+void VSMODEL_vXReset(uint8 value);
+void VSMODEL_vXCs(uint8 value);
+void VSMODEL_vXDcs(uint8 value);
+uint32 VSMODEL_u32Spi(uint32 value, uint8 bits);
+uint32 VSMODEL_u32SpiBlock(const uint8 *data, uint32 length);
+
+#define VS1053_DREQ()               VSMODEL_u8Dreq()
+#define VS1053_XRESET(value)        VSMODEL_vXReset(value)
+#define VS1053_XDCS(value)          VSMODEL_vXDcs(value)
+#define VS1053_XCS(value)           VSMODEL_vXCs(value)
+#define VS1053_SPI_WRITE16(value)   VSMODEL_u32Spi(value, 16)
+#define VS1053_SPI_WRITE32(value)   VSMODEL_u32Spi(value, 32)
+#define VS1053_SPI_WRITE_BLOCK(data, length) VSMODEL_u32SpiBlock(data, length)
+
+#endif /* HOST_VS1053_MODEL_H_ */
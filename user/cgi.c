@@ -13,6 +13,9 @@
 #include "timer.h"
 #include "stdout.h"
 #include "control.h"
+#include "dnscache.h"
+#include "stationdb.h"
+#include "stationimport.h"
 
 //WiFi access point data
 typedef struct
@@ -32,6 +35,28 @@ typedef struct
     int noAps;
 } ScanResultData;
 
+typedef struct
+{
+    STATIONIMPORT_tstParser parser;
+    bool writing; // Station list is being written
+    uint32 start_time;
+    uint32 heap; // Free heap before upload
+    uint32 heap_min; // Lowest free heap during upload
+} ImportData;
+
+// Maximum number of stations returned by a search
+#define SEARCH_MAX_RESULTS 50
+
+typedef struct
+{
+    STATIONDB_tstQuery query;
+    uint32 results;
+    bool pending; // Result did not fit into send buffer
+    uint32 index;
+    char name[STATIONDB_NAME_SIZE];
+    os_timer_t timer; // Continues search when nothing was sent
+} SearchData;
+
 //Static scan status storage.
 static ScanResultData cgiWifiAps;
 
@@ -51,8 +76,7 @@ int ICACHE_FLASH_ATTR IndexStreamCgi(HttpdConnData *connData)
     int len;
     char buff[1024];
     uint32 select = 0;
-
-
+    static HTTPC_tstStation station;
 
     len = httpdFindArg(connData->post->buff, "stream", buff, sizeof(buff));
     if (len != 0)
@@ -63,9 +87,9 @@ int ICACHE_FLASH_ATTR IndexStreamCgi(HttpdConnData *connData)
     len = httpdFindArg(connData->post->buff, "stream_control", buff, sizeof(buff));
     if (len != 0)
     {
-        if (os_strcmp(buff, "PLAY") == 0)
+        if ((os_strcmp(buff, "PLAY") == 0) && STATIONDB_bGetStation(select, &station))
         {
-            HTTPC_vStartStreaming(&stream_address[select][0], "Icy-MetaData:1\r\n", Timer_StreamingCallback);
+            HTTPC_vStartStreamingStation(&station, "Icy-MetaData:1\r\n", Timer_StreamingCallback);
         }
         if (os_strcmp(buff, "STOP") == 0)
             HTTPC_vStopStreaming();
@@ -264,20 +288,230 @@ int ICACHE_FLASH_ATTR IndexTemplate(HttpdConnData *connData, char *token, void *
         if(Control_u8GetSpartialProcessingLevel() == Control_enSpartialProcessing_Extreme)
             httpdSend(connData, "checked='checked'", -1);
 
-    if (os_strcmp(token, "StreamSelected_0")==0)
-        //if(Control_u8GetSpartialProcessingLevel() == Control_enSpartialProcessing_Extreme)
-        httpdSend(connData, "checked='checked'", -1);
+    return HTTPD_CGI_DONE;
+}
+
+// Station list upload of index page (raw .txt/.m3u/.pls/CSV file as POST body)
+// Body is parsed while it arrives in chunks of the post buffer. The new list replaces the active one when complete.
+int ICACHE_FLASH_ATTR IndexImportCgi(HttpdConnData *connData)
+{
+    ImportData *import = (ImportData*) connData->cgiData;
+    char buff[160];
+    uint32 heap;
+    uint32 time;
+    bool ok;
+
+    if (connData->conn == NULL)
+    {
+        //Connection aborted. Clean up. Active station list stays in use.
+        if (import != NULL)
+        {
+            if (import->writing)
+                STATIONIMPORT_vAbort(&import->parser);
+            os_free(import);
+        }
+        return HTTPD_CGI_DONE;
+    }
+
+    if (import == NULL)
+    {
+        // First call
+        heap = system_get_free_heap_size();
+        if (connData->post->len > 0)
+            import = (ImportData*) os_malloc(sizeof(ImportData));
+        if (import == NULL)
+        {
+            httpdStartResponse(connData, 400);
+            httpdHeader(connData, "Content-Type", "text/plain");
+            httpdEndHeaders(connData);
+            httpdSend(connData, "Import failed\n", -1);
+            return HTTPD_CGI_DONE;
+        }
+        import->heap = heap;
+        import->heap_min = heap;
+        import->start_time = system_get_time();
+        import->writing = STATIONIMPORT_bBegin(&import->parser);
+        connData->cgiData = import;
+    }
+
+    if (import->writing)
+        STATIONIMPORT_vProcess(&import->parser, connData->post->buff, connData->post->buffLen);
+    heap = system_get_free_heap_size();
+    if (heap < import->heap_min)
+        import->heap_min = heap;
+    if (connData->post->received < connData->post->len)
+        return HTTPD_CGI_MORE;
+
+    // Upload complete => New list becomes active
+    ok = import->writing && STATIONIMPORT_bFinish(&import->parser);
+    time = (system_get_time() - import->start_time) / 1000;
+    os_sprintf(buff, "%s\nStations: %d\nSkipped: %d\nTime: %d ms (%d entries/s)\nPeak heap: %d bytes\n", ok ? "Import done" : "Import failed",
+            import->parser.entries, import->parser.skipped, time, import->parser.entries * 1000 / ((time != 0) ? time : 1), import->heap - import->heap_min);
+    myprintf("%s", buff);
+    httpdStartResponse(connData, ok ? 200 : 400);
+    httpdHeader(connData, "Content-Type", "text/plain");
+    httpdEndHeaders(connData);
+    httpdSend(connData, buff, -1);
+    os_free(import);
+    connData->cgiData = NULL;
+    return HTTPD_CGI_DONE;
+}
+
+static bool ICACHE_FLASH_ATTR ApiSendStation(HttpdConnData *connData, SearchData *search)
+{
+    char buff[STATIONDB_NAME_SIZE * 6 + 32];
+    char *dst;
+    char *src;
+
+    // {"id":1,"name":"..."} with JSON escaped name
+    dst = buff + os_sprintf(buff, "%s{\"id\":%d,\"name\":\"", (search->results != 0) ? "," : "", search->index);
+    for (src = search->name; *src != '\0'; src++)
+    {
+        if ((*src == '"') || (*src == '\\'))
+        {
+            *dst++ = '\\';
+            *dst++ = *src;
+        }
+        else if ((uint8) *src < 0x20)
+            dst += os_sprintf(dst, "\\u%04x", (uint8) *src);
+        else
+            *dst++ = *src;
+    }
+    os_strcpy(dst, "\"}");
+    return httpdSend(connData, buff, -1);
+}
+
+static void ICACHE_FLASH_ATTR ApiStationsContinue(void *arg)
+{
+    httpdContinue((HttpdConnData*) arg);
+}
+
+// Station search: /api/stations?q=text returns a JSON array of matching stations
+// Every call only does a limited amount of work, results are sent as they are found.
+int ICACHE_FLASH_ATTR ApiStationsCgi(HttpdConnData *connData)
+{
+    SearchData *search = (SearchData*) connData->cgiData;
+    char buff[STATIONDB_QUERY_SIZE];
+    STATIONDB_tenFind result;
+    bool sent = 0;
+
+    if (connData->conn == NULL)
+    {
+        //Connection aborted. Clean up.
+        if (search != NULL)
+        {
+            os_timer_disarm(&search->timer);
+            os_free(search);
+        }
+        return HTTPD_CGI_DONE;
+    }
 
-    if (os_strcmp(token, "StreamName_0")==0)
-        httpdSend(connData, &stream_name[0][0], -1);
-    if (os_strcmp(token, "StreamName_1")==0)
-        httpdSend(connData, &stream_name[1][0], -1);
-    if (os_strcmp(token, "StreamName_2")==0)
-        httpdSend(connData, &stream_name[2][0], -1);
+    if (search == NULL)
+    {
+        // First call
+        search = (SearchData*) os_malloc(sizeof(SearchData));
+        if (search == NULL)
+            return HTTPD_CGI_NOTFOUND;
+        if (httpdFindArg(connData->getArgs, "q", buff, sizeof(buff)) < 0)
+            buff[0] = '\0';
+        STATIONDB_vInitQuery(&search->query, buff);
+        search->results = 0;
+        search->pending = 0;
+        os_timer_setfn(&search->timer, (os_timer_func_t*) ApiStationsContinue, connData);
+        connData->cgiData = search;
+        httpdStartResponse(connData, 200);
+        httpdHeader(connData, "Content-Type", "application/json");
+        httpdEndHeaders(connData);
+        httpdSend(connData, "[", -1);
+        sent = 1;
+    }
 
+    // Send buffer is empty at the beginning of a call => Pending result always fits
+    if (search->pending)
+    {
+        ApiSendStation(connData, search);
+        search->pending = 0;
+        search->results++;
+        sent = 1;
+    }
+    while (search->results < SEARCH_MAX_RESULTS)
+    {
+        result = STATIONDB_enFind(&search->query, &search->index, search->name);
+        if (result == STATIONDB_enFindMore)
+        {
+            // Without data there is no sent callback => Continue after other tasks had their turn
+            if (!sent)
+                os_timer_arm(&search->timer, 1, 0);
+            return HTTPD_CGI_MORE;
+        }
+        if (result == STATIONDB_enFindDone)
+            break;
+        // Station that does not fit any more is sent with the next call
+        if (!ApiSendStation(connData, search))
+        {
+            search->pending = 1;
+            return HTTPD_CGI_MORE;
+        }
+        search->results++;
+        sent = 1;
+    }
+    httpdSend(connData, "]", -1);
+    os_free(search);
+    connData->cgiData = NULL;
     return HTTPD_CGI_DONE;
 }
 
+// Station list of index page as <option> elements
+// Entries are read from flash one at a time. Position is kept in cgiData, nothing is allocated.
+int ICACHE_FLASH_ATTR IndexStationsCgi(HttpdConnData *connData)
+{
+    char name[STATIONDB_NAME_SIZE];
+    char buff[STATIONDB_NAME_SIZE * 6 + 32];
+    char *dst;
+    char *src;
+    uint32 index = (uint32) connData->cgiData;
+
+    if (connData->conn == NULL)
+    {
+        //Connection aborted. Clean up.
+        return HTTPD_CGI_DONE;
+    }
+
+    // First call
+    if (index == 0)
+    {
+        httpdStartResponse(connData, 200);
+        httpdHeader(connData, "Content-Type", "text/html");
+        httpdEndHeaders(connData);
+        index = 1;
+    }
+    // Fill send buffer. Entry that does not fit any more is sent with the next call.
+    for (; index <= STATIONDB_u32GetCount(); index++)
+    {
+        if (!STATIONDB_bGetName(index - 1, name))
+            continue;
+        dst = buff + os_sprintf(buff, "<option value='%d'>", index - 1);
+        for (src = name; *src != '\0'; src++)
+        {
+            if (*src == '&')
+                dst += os_sprintf(dst, "&amp;");
+            else if (*src == '<')
+                dst += os_sprintf(dst, "&lt;");
+            else if (*src == '>')
+                dst += os_sprintf(dst, "&gt;");
+            else
+                *dst++ = *src;
+        }
+        os_strcpy(dst, "</option>\n");
+        if (!httpdSend(connData, buff, -1))
+            break;
+    }
+    if (index > STATIONDB_u32GetCount())
+        return HTTPD_CGI_DONE;
+    connData->cgiData = (void*) index;
+    return HTTPD_CGI_MORE;
+}
+
 //Cgi that turns the LED on or off according to the 'led' param in the POST data
 int ICACHE_FLASH_ATTR cgiSettings(HttpdConnData *connData)
 {
@@ -573,6 +807,8 @@ int ICACHE_FLASH_ATTR cgiWiFiSetMode(HttpdConnData *connData)
         httpd_printf("cgiWifiSetMode: %s\n", buff);
 #ifndef DEMO_MODE
         wifi_set_opmode(strtol(buff, NULL, 0));
+        // Pending settings would be lost otherwise
+        Control_vFlushSettings();
         system_restart();
 #endif
     }
@@ -881,7 +1117,7 @@ void ICACHE_FLASH_ATTR cgiPrepareOtaUpdate(void)
     }
 
     // dns lookup
-    result = espconn_gethostbyname(conn, OTA_HOST, &ip, cgiOtaDnsIpFound);
+    result = DNS_s8GetHostByName(conn, OTA_HOST, &ip, cgiOtaDnsIpFound);
 
     if (result == ESPCONN_OK)
     {
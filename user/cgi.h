@@ -9,6 +9,9 @@ int ICACHE_FLASH_ATTR IndexPlaybackCgi(HttpdConnData *connData);
 int ICACHE_FLASH_ATTR IndexVolumeCgi(HttpdConnData *connData);
 int ICACHE_FLASH_ATTR IndexEnhancerCgi(HttpdConnData *connData);
 int ICACHE_FLASH_ATTR IndexSpartialCgi(HttpdConnData *connData);
+int ICACHE_FLASH_ATTR IndexStationsCgi(HttpdConnData *connData);
+int ICACHE_FLASH_ATTR IndexImportCgi(HttpdConnData *connData);
+int ICACHE_FLASH_ATTR ApiStationsCgi(HttpdConnData *connData);
 int ICACHE_FLASH_ATTR IndexTemplate(HttpdConnData *connData, char *token, void **arg);
 int ICACHE_FLASH_ATTR cgiSettings(HttpdConnData *connData);
 int tplSettings(HttpdConnData *connData, char *token, void **arg);
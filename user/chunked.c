@@ -0,0 +1,155 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <esp8266.h>
+#include "chunked.h"
+
+static sint8 ICACHE_FLASH_ATTR CHUNKED_s8HexValue(char c)
+{
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    if ((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+    if ((c >= 'A') && (c <= 'F'))
+        return c - 'A' + 10;
+    return -1;
+}
+
+static void ICACHE_FLASH_ATTR CHUNKED_vEndSizeLine(CHUNKED_tstParser *parser)
+{
+    if (parser->digits == 0)
+        parser->state = CHUNKED_enStateError;
+    else
+        if (parser->remaining == 0)
+        {
+            // Last chunk => Only trailer follows
+            parser->state = CHUNKED_enStateTrailer;
+            parser->line_empty = 1;
+        }
+        else
+            parser->state = CHUNKED_enStateData;
+}
+
+void ICACHE_FLASH_ATTR CHUNKED_vInit(CHUNKED_tstParser *parser, CHUNKED_tpfDataCallback data_callback, void *arg)
+{
+    parser->state = CHUNKED_enStateSize;
+    parser->remaining = 0;
+    parser->digits = 0;
+    parser->line_empty = 1;
+    parser->data_callback = data_callback;
+    parser->arg = arg;
+}
+
+CHUNKED_tenResult ICACHE_FLASH_ATTR CHUNKED_enProcess(CHUNKED_tstParser *parser, char *data, uint32 length)
+{
+    uint32 count;
+    sint8 value;
+    char c;
+
+    // Data can be split at any position. Parser state is kept between calls.
+    while ((length != 0) && (parser->state != CHUNKED_enStateDone) && (parser->state != CHUNKED_enStateError))
+    {
+        if (parser->state == CHUNKED_enStateData)
+        {
+            // Hand over contiguous chunk content without copying
+            count = length;
+            if (count > parser->remaining)
+                count = parser->remaining;
+            parser->data_callback(parser->arg, data, count);
+            data += count;
+            length -= count;
+            parser->remaining -= count;
+            if (parser->remaining == 0)
+                parser->state = CHUNKED_enStateDataEnd;
+            continue;
+        }
+
+        c = *data++;
+        length--;
+        // Line endings might be sent without CR
+        if (c == '\r')
+            continue;
+
+        switch (parser->state)
+        {
+            case CHUNKED_enStateSize:
+                value = CHUNKED_s8HexValue(c);
+                if (value >= 0)
+                {
+                    if (parser->digits >= CHUNKED_SIZE_DIGITS_MAX)
+                        parser->state = CHUNKED_enStateError;
+                    parser->remaining = (parser->remaining << 4) | value;
+                    parser->digits++;
+                }
+                else
+                    if (c == '\n')
+                        CHUNKED_vEndSizeLine(parser);
+                    else
+                        if ((c == ';') || (c == ' ') || (c == '\t'))
+                            parser->state = CHUNKED_enStateExtension;
+                        else
+                            parser->state = CHUNKED_enStateError;
+                break;
+            case CHUNKED_enStateExtension:
+                // Extensions are not used
+                if (c == '\n')
+                    CHUNKED_vEndSizeLine(parser);
+                break;
+            case CHUNKED_enStateDataEnd:
+                if (c == '\n')
+                {
+                    // Next chunk size follows
+                    parser->state = CHUNKED_enStateSize;
+                    parser->remaining = 0;
+                    parser->digits = 0;
+                }
+                else
+                    parser->state = CHUNKED_enStateError;
+                break;
+            case CHUNKED_enStateTrailer:
+                // Trailer fields are ignored, empty line ends the body
+                if (c == '\n')
+                {
+                    if (parser->line_empty)
+                        parser->state = CHUNKED_enStateDone;
+                    parser->line_empty = 1;
+                }
+                else
+                    parser->line_empty = 0;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (parser->state == CHUNKED_enStateDone)
+        return CHUNKED_enResultDone;
+    if (parser->state == CHUNKED_enStateError)
+        return CHUNKED_enResultError;
+    return CHUNKED_enResultMore;
+}
+
+bool ICACHE_FLASH_ATTR CHUNKED_bIsDone(CHUNKED_tstParser *parser)
+{
+    return parser->state == CHUNKED_enStateDone;
+}
@@ -0,0 +1,64 @@
+#ifndef USER_CHUNKED_H_
+#define USER_CHUNKED_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Chunk size is limited to 7 hex digits (256 MB)
+#define CHUNKED_SIZE_DIGITS_MAX     7
+
+typedef void (*CHUNKED_tpfDataCallback)(void *arg, char *data, uint32 len);
+
+typedef enum
+{
+    CHUNKED_enResultMore, // Body not complete yet => Feed next segment
+    CHUNKED_enResultDone, // Last chunk and trailer received
+    CHUNKED_enResultError // Invalid chunk framing
+} CHUNKED_tenResult;
+
+typedef enum
+{
+    CHUNKED_enStateSize, // Hex digits of chunk size
+    CHUNKED_enStateExtension, // Chunk extension until end of line
+    CHUNKED_enStateData, // Chunk content
+    CHUNKED_enStateDataEnd, // CRLF behind chunk content
+    CHUNKED_enStateTrailer, // Trailer lines until empty line
+    CHUNKED_enStateDone,
+    CHUNKED_enStateError
+} CHUNKED_tenState;
+
+typedef struct
+{
+    CHUNKED_tenState state;
+    uint32 remaining; // Bytes left in current chunk (or size parsed so far)
+    uint8 digits; // Hex digits of current chunk size
+    bool line_empty; // Trailer: No character in current line yet
+    CHUNKED_tpfDataCallback data_callback;
+    void *arg;
+} CHUNKED_tstParser;
+
+void ICACHE_FLASH_ATTR CHUNKED_vInit(CHUNKED_tstParser *parser, CHUNKED_tpfDataCallback data_callback, void *arg);
+CHUNKED_tenResult ICACHE_FLASH_ATTR CHUNKED_enProcess(CHUNKED_tstParser *parser, char *data, uint32 length);
+bool ICACHE_FLASH_ATTR CHUNKED_bIsDone(CHUNKED_tstParser *parser);
+
+#endif /* USER_CHUNKED_H_ */
@@ -26,17 +26,22 @@
 #include "cgiwebsocket.h"
 #include "vs1053.h"
 #include "espfs.h"
+#include "httpclient.h"
+#include "settings.h"
+#include "stationdb.h"
+#include "stationimport.h"
+
+// Quiet period after the last change before settings are written to flash
+#define CONTROL_SETTINGS_FLUSH_MS 2000
+// Stations whose hostnames are resolved in advance
+#define CONTROL_PREFETCH_COUNT 3
 
 #define BKP_ReadBackupRegister(x) Control_tstBackupDataRegister.x
-#define BKP_WriteBackupRegister(x, y) Control_tstBackupDataRegister.x = y
 
+// Layout used before the settings log (only read once for migration)
 #define PREBACKUPDATAREGISTERACTION() \
         spi_flash_read(ESP_SPI_FLASH_LAST_PAGE * ESP_SPI_FLASH_PAGE_SIZE, (uint32*) &Control_tstBackupDataRegister, sizeof(Control_tstBackupDataRegister));
 
-#define POSTBACKUPDATAREGISTERACTION() \
-        spi_flash_erase_sector(ESP_SPI_FLASH_LAST_PAGE); \
-        spi_flash_write(ESP_SPI_FLASH_LAST_PAGE * ESP_SPI_FLASH_PAGE_SIZE, (uint32*) &Control_tstBackupDataRegister, sizeof(Control_tstBackupDataRegister));
-
 struct Control_stBackupDataRegister
 {
     /* Needs to be byte aligned by 4!! */
@@ -55,73 +60,103 @@ struct Control_stBackupDataRegister
 /* Needs to be byte aligned by 4!! */
 } Control_tstBackupDataRegister;
 
+// Keys of settings log (never reorder, stored in flash)
+typedef enum
+{
+    Control_enSettingVolumeLeft,
+    Control_enSettingVolumeRight,
+    Control_enSettingTrebleAmp,
+    Control_enSettingTrebleLim,
+    Control_enSettingBassAmp,
+    Control_enSettingBassLim,
+    Control_enSettingAutoStart,
+    Control_enSettingSpartialProcessing
+} Control_tenSetting;
+
 Control_tstEnhancerSettings Control_stEnhancerData = { 0, 3, 0, 10 };
 uint8_t Control_u8VolumeLeft = 0;
 uint8_t Control_u8VolumeRight = 0;
 uint8_t Control_u8AutoStart = 0;
 Control_tenSpartialProcessing Control_enSpartialProcessingLevel = Control_enSpartialProcessing_Off;
+bool Control_bSettingsDirty = 0;
+os_timer_t Control_SettingsTimerObject;
+HTTPC_tstStation Control_stStation;
 
-void ICACHE_FLASH_ATTR Control_vInit(void)
+static void ICACHE_FLASH_ATTR Control_vMigrateBackupRegister(void)
 {
     // Load SPI flash content
     PREBACKUPDATAREGISTERACTION();
 
-    // Check for magic byte in data register 1
+    // Check for magic byte in data register 1 (not valid => Defaults are kept)
     if (BKP_ReadBackupRegister(BKP_DR1) != 0xA5)
-    {
-        // Data not valid (or has not been written yet) => Get default settings
-        Control_u8VolumeLeft = 0;
-        Control_u8VolumeRight = 0;
-        Control_stEnhancerData.TrebleAmp = 0;
-        Control_stEnhancerData.TrebleLim = 3;
-        Control_stEnhancerData.BassAmp = 0;
-        Control_stEnhancerData.BassLim = 10;
-        Control_u8AutoStart = 0;
-        Control_enSpartialProcessingLevel = Control_enSpartialProcessing_Off;
+        return;
+    myprintf("Control: Moving settings to settings log\n");
+    SETTINGS_vSet(Control_enSettingVolumeLeft, BKP_ReadBackupRegister(BKP_DR2));
+    SETTINGS_vSet(Control_enSettingVolumeRight, BKP_ReadBackupRegister(BKP_DR3));
+    SETTINGS_vSet(Control_enSettingTrebleAmp, BKP_ReadBackupRegister(BKP_DR4));
+    SETTINGS_vSet(Control_enSettingTrebleLim, BKP_ReadBackupRegister(BKP_DR5));
+    SETTINGS_vSet(Control_enSettingBassAmp, BKP_ReadBackupRegister(BKP_DR6));
+    SETTINGS_vSet(Control_enSettingBassLim, BKP_ReadBackupRegister(BKP_DR7));
+    SETTINGS_vSet(Control_enSettingAutoStart, BKP_ReadBackupRegister(BKP_DR8));
+    SETTINGS_vSet(Control_enSettingSpartialProcessing, BKP_ReadBackupRegister(BKP_DR9));
+}
 
-        // Save default data to backup register
-        BKP_WriteBackupRegister(BKP_DR2, Control_u8VolumeLeft);
-        BKP_WriteBackupRegister(BKP_DR3, Control_u8VolumeRight);
-        BKP_WriteBackupRegister(BKP_DR4, Control_stEnhancerData.TrebleAmp);
-        BKP_WriteBackupRegister(BKP_DR5, Control_stEnhancerData.TrebleLim);
-        BKP_WriteBackupRegister(BKP_DR6, Control_stEnhancerData.BassAmp);
-        BKP_WriteBackupRegister(BKP_DR7, Control_stEnhancerData.BassLim);
-        BKP_WriteBackupRegister(BKP_DR8, Control_u8AutoStart);
-        BKP_WriteBackupRegister(BKP_DR9, Control_enSpartialProcessingLevel);
+static uint8 ICACHE_FLASH_ATTR Control_u8LoadSetting(Control_tenSetting key, uint8 default_value)
+{
+    uint8 value;
 
-        // Set backup data register version (used for compatibility with future versions)
-        BKP_WriteBackupRegister(BKP_DR0, 0x00);
-        // Write magic byte to data register 1
-        BKP_WriteBackupRegister(BKP_DR1, 0xA5);
-    }
-    else
-    {
-        // #### For future use - In case of new data entrys this can be used ####
-        //switch (BKP_ReadBackupRegister(BKP_DR0))
-        //{
-        //    case 0:
-        //        // We will write new data register now
-        //        BKP_WriteBackupRegister(BKP_DR24, 10);
-        //        // Increment Software Version register
-        //        BKP_WriteBackupRegister(BKP_DR0, 0x01);
-        //    default:
-        //        // do nothing
-        //        break;
-        //}
+    // Setting has never been changed => Default
+    if (!SETTINGS_bGet(key, &value))
+        return default_value;
+    return value;
+}
 
-        // Data is valid => Load register values to RAM
-        Control_u8VolumeLeft = BKP_ReadBackupRegister(BKP_DR2);
-        Control_u8VolumeRight = BKP_ReadBackupRegister(BKP_DR3);
-        Control_stEnhancerData.TrebleAmp = BKP_ReadBackupRegister(BKP_DR4);
-        Control_stEnhancerData.TrebleLim = BKP_ReadBackupRegister(BKP_DR5);
-        Control_stEnhancerData.BassAmp = BKP_ReadBackupRegister(BKP_DR6);
-        Control_stEnhancerData.BassLim = BKP_ReadBackupRegister(BKP_DR7);
-        Control_u8AutoStart = BKP_ReadBackupRegister(BKP_DR8);
-        Control_enSpartialProcessingLevel = BKP_ReadBackupRegister(BKP_DR9);
-    }
+static void ICACHE_FLASH_ATTR Control_vSettingsTimerCallback(void *arg)
+{
+    Control_vFlushSettings();
+}
+
+static void ICACHE_FLASH_ATTR Control_vMarkDirty(void)
+{
+    // Every change restarts the quiet period => Dragging a slider ends up in one flush
+    Control_bSettingsDirty = 1;
+    os_timer_disarm(&Control_SettingsTimerObject);
+    os_timer_setfn(&Control_SettingsTimerObject, (os_timer_func_t*) Control_vSettingsTimerCallback, NULL);
+    os_timer_arm(&Control_SettingsTimerObject, CONTROL_SETTINGS_FLUSH_MS, 0);
+}
 
-    // Save SPI flash content
-    POSTBACKUPDATAREGISTERACTION();
+void ICACHE_FLASH_ATTR Control_vFlushSettings(void)
+{
+    os_timer_disarm(&Control_SettingsTimerObject);
+    if (!Control_bSettingsDirty)
+        return;
+    Control_bSettingsDirty = 0;
+    // Settings log only writes values that differ from the stored ones
+    SETTINGS_vSet(Control_enSettingVolumeLeft, Control_u8VolumeLeft);
+    SETTINGS_vSet(Control_enSettingVolumeRight, Control_u8VolumeRight);
+    SETTINGS_vSet(Control_enSettingTrebleAmp, Control_stEnhancerData.TrebleAmp);
+    SETTINGS_vSet(Control_enSettingTrebleLim, Control_stEnhancerData.TrebleLim);
+    SETTINGS_vSet(Control_enSettingBassAmp, Control_stEnhancerData.BassAmp);
+    SETTINGS_vSet(Control_enSettingBassLim, Control_stEnhancerData.BassLim);
+    SETTINGS_vSet(Control_enSettingAutoStart, Control_u8AutoStart);
+    SETTINGS_vSet(Control_enSettingSpartialProcessing, Control_enSpartialProcessingLevel);
+}
+
+void ICACHE_FLASH_ATTR Control_vInit(void)
+{
+    // Settings log doesn't exist before the first change => Take over values of old layout
+    if (!SETTINGS_bInit())
+        Control_vMigrateBackupRegister();
+
+    // Load values to RAM
+    Control_u8VolumeLeft = Control_u8LoadSetting(Control_enSettingVolumeLeft, 0);
+    Control_u8VolumeRight = Control_u8LoadSetting(Control_enSettingVolumeRight, 0);
+    Control_stEnhancerData.TrebleAmp = Control_u8LoadSetting(Control_enSettingTrebleAmp, 0);
+    Control_stEnhancerData.TrebleLim = Control_u8LoadSetting(Control_enSettingTrebleLim, 3);
+    Control_stEnhancerData.BassAmp = Control_u8LoadSetting(Control_enSettingBassAmp, 0);
+    Control_stEnhancerData.BassLim = Control_u8LoadSetting(Control_enSettingBassLim, 10);
+    Control_u8AutoStart = Control_u8LoadSetting(Control_enSettingAutoStart, 0);
+    Control_enSpartialProcessingLevel = Control_u8LoadSetting(Control_enSettingSpartialProcessing, Control_enSpartialProcessing_Off);
 }
 
 void ICACHE_FLASH_ATTR Control_vSetVolume(uint8 value)
@@ -134,10 +169,8 @@ void ICACHE_FLASH_ATTR Control_vSetVolume(uint8 value)
     temp = 0xFF - ((Control_u8VolumeLeft * 5) / 2);
     // Send value to VS1053
     VS1053_vSetVolume(temp, temp);
-    // Save to persistent memory
-    PREBACKUPDATAREGISTERACTION();
-    BKP_WriteBackupRegister(BKP_DR2, value);
-    POSTBACKUPDATAREGISTERACTION();
+    // Save to persistent memory later
+    Control_vMarkDirty();
 }
 
 uint8 ICACHE_FLASH_ATTR Control_u8GetVolume(void)
@@ -155,13 +188,8 @@ void ICACHE_FLASH_ATTR Control_vSetEnhancer(Control_tstEnhancerSettings *data)
     Control_stEnhancerData.BassLim = data->BassLim;
     // Send value to VS1053
     VS1053_vSetEnhancer(Control_stEnhancerData.TrebleAmp, Control_stEnhancerData.TrebleLim, Control_stEnhancerData.BassAmp, Control_stEnhancerData.BassLim);
-    // Save to persistent memory
-    PREBACKUPDATAREGISTERACTION();
-    BKP_WriteBackupRegister(BKP_DR4, Control_stEnhancerData.TrebleAmp);
-    BKP_WriteBackupRegister(BKP_DR5, Control_stEnhancerData.TrebleLim);
-    BKP_WriteBackupRegister(BKP_DR6, Control_stEnhancerData.BassAmp);
-    BKP_WriteBackupRegister(BKP_DR7, Control_stEnhancerData.BassLim);
-    POSTBACKUPDATAREGISTERACTION();
+    // Save to persistent memory later
+    Control_vMarkDirty();
 }
 
 void ICACHE_FLASH_ATTR Control_vGetEnhancer(Control_tstEnhancerSettings *data)
@@ -178,10 +206,8 @@ void ICACHE_FLASH_ATTR Control_vSetAutoStart(uint8 value)
 {
     // Store value
     Control_u8AutoStart = value;
-    // Save to persistent memory
-    PREBACKUPDATAREGISTERACTION();
-    BKP_WriteBackupRegister(BKP_DR8, value);
-    POSTBACKUPDATAREGISTERACTION();
+    // Save to persistent memory later
+    Control_vMarkDirty();
 }
 
 uint8 ICACHE_FLASH_ATTR Control_u8GetAutoStart(void)
@@ -195,10 +221,8 @@ void ICACHE_FLASH_ATTR Control_vSetSpartialProcessingLevel(
 {
     // Store value
     Control_enSpartialProcessingLevel = Level;
-    // Save to persistent memory
-    PREBACKUPDATAREGISTERACTION();
-    BKP_WriteBackupRegister(BKP_DR9, Level);
-    POSTBACKUPDATAREGISTERACTION();
+    // Save to persistent memory later
+    Control_vMarkDirty();
 }
 
 Control_tenSpartialProcessing ICACHE_FLASH_ATTR Control_u8GetSpartialProcessingLevel(
@@ -208,102 +232,50 @@ Control_tenSpartialProcessing ICACHE_FLASH_ATTR Control_u8GetSpartialProcessingL
     return Control_enSpartialProcessingLevel;
 }
 
-static char* Control_ptrReadStreamTxt(void)
+static void ICACHE_FLASH_ATTR Control_vImportStreamTxt(void)
 {
     EspFsFile *file;
-    int filesize, readsize;
-    char *content;
+    STATIONIMPORT_tstParser *parser;
+    char chunk[128];
+    int len;
 
-    // Read file
+    // Default list of the file system. Read in chunks, so the file size doesn't matter.
     file = espFsOpen("streamlist.txt");
-    // Get filesize
-    filesize = espFsFilesize(file);
-    // Allocate memory for file
-    content = (char*) os_malloc(filesize);
-    // Check for success
-    if (content == NULL)
+    if (file == NULL)
+        return;
+    parser = (STATIONIMPORT_tstParser*) os_malloc(sizeof(STATIONIMPORT_tstParser));
+    if (parser == NULL)
     {
         myprintf("os_malloc() returned NULL\n");
-        return NULL;
+        espFsClose(file);
+        return;
     }
-    // Copy file content to RAM
-    readsize = espFsRead(file, content, filesize);
-    // Return
-    return content;
-}
-
-char stream_name[3][30];
-char stream_address[3][100];
-
-static void Control_vParseStreamTxt(char *data)
-{
-    char *start_pos;
-    char *end_pos;
-    uint32 count = 0;
-
-    start_pos = data;
-
-    // Iterate over file
-    while (true)
+    if (STATIONIMPORT_bBegin(parser))
     {
-        // Search for first ";"
-        end_pos = ets_strstr(start_pos, ";");
-        // Check if any ";" has been found
-        if (end_pos == NULL)
-        {
-            // No ";" found
-            break;
-        }
-        else
-        {
-            // ";" has been found
-            // Copy content to array
-            os_memcpy(&stream_name[count][0], start_pos, end_pos - start_pos);
-            // Terminate
-            stream_name[count][end_pos - start_pos] = '\0';
-        }
-        // Update search parameter
-        start_pos = end_pos + 1;
-        // Search for first "newline"
-        end_pos = ets_strstr(start_pos, "\r\n");
-        // Check if any "newline" has been found
-        if (end_pos == NULL) // Only one entry
-        {
-            // No "newline" found
-            break;
-        }
-        else
-        {
-            // "newline" has been found
-            // Copy content to array
-            os_memcpy(&stream_address[count][0], start_pos, end_pos - start_pos);
-            // Terminate
-            stream_address[count][end_pos - start_pos] = '\0';
-        }
-        // Update search parameter
-        start_pos = end_pos + 2;
-        // Increment count variable
-        count++;
+        while ((len = espFsRead(file, chunk, sizeof(chunk))) > 0)
+            STATIONIMPORT_vProcess(parser, chunk, len);
+        STATIONIMPORT_bFinish(parser);
     }
+    os_free(parser);
+    espFsClose(file);
 }
 
-static void ICACHE_FLASH_ATTR Control_vGetStreamCount(void)
+void ICACHE_FLASH_ATTR Control_v8GetStreamList(void)
 {
-    char *content;
-
-    // Open and read StreamList.txt
-    content = Control_ptrReadStreamTxt();
-    // Parse Stream List
-    Control_vParseStreamTxt(content);
-    // Printout SteamList content
-    myprintf("Name: %s Address: %s\n", &stream_name[0][0], &stream_address[0][0]);
-    myprintf("Name: %s Address: %s\n", &stream_name[1][0], &stream_address[1][0]);
-    myprintf("Name: %s Address: %s\n", &stream_name[2][0], &stream_address[2][0]);
-    // Free allocated memory
-    os_free(content);
+    // Station list in flash is created from streamlist.txt on first start
+    if (!STATIONDB_bInit())
+        Control_vImportStreamTxt();
+    myprintf("Stations: %d\n", STATIONDB_u32GetCount());
 }
 
-void ICACHE_FLASH_ATTR Control_v8GetStreamList(void)
+void ICACHE_FLASH_ATTR Control_vPrefetchStreams(void)
 {
-    Control_vGetStreamCount();
+    uint32 i;
+
+    // Resolve hostnames of first stations so PLAY does not wait for DNS
+    for (i = 0; (i < STATIONDB_u32GetCount()) && (i < CONTROL_PREFETCH_COUNT); i++)
+    {
+        if (STATIONDB_bGetStation(i, &Control_stStation) && (Control_stStation.count != 0))
+            HTTPC_vPrefetchUrl(Control_stStation.url[0]);
+    }
 }
@@ -24,6 +24,8 @@
  * SOFTWARE.
  */
 
+#include "httpclient.h"
+
 typedef struct
 {
         int8 TrebleAmp; // 1.5 dB steps (-8..7, 0 = off)
@@ -40,10 +42,8 @@ typedef enum
     Control_enSpartialProcessing_Extreme
 } Control_tenSpartialProcessing;
 
-char stream_name[3][30];
-char stream_address[3][100];
-
 void ICACHE_FLASH_ATTR Control_vInit(void);
+void ICACHE_FLASH_ATTR Control_vFlushSettings(void);
 void ICACHE_FLASH_ATTR Control_vSetVolume(uint8 value);
 uint8 ICACHE_FLASH_ATTR Control_u8GetVolume(void);
 void ICACHE_FLASH_ATTR Control_vSetEnhancer(Control_tstEnhancerSettings *data);
@@ -53,5 +53,6 @@ uint8 ICACHE_FLASH_ATTR Control_u8GetAutoStart(void);
 void ICACHE_FLASH_ATTR Control_vSetSpartialProcessingLevel(Control_tenSpartialProcessing Level);
 Control_tenSpartialProcessing ICACHE_FLASH_ATTR Control_u8GetSpartialProcessingLevel(void);
 void ICACHE_FLASH_ATTR Control_v8GetStreamList(void);
+void ICACHE_FLASH_ATTR Control_vPrefetchStreams(void);
 
 #endif /* CONTROL_H_ */
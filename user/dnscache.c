@@ -0,0 +1,193 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <esp8266.h>
+#include "dnscache.h"
+#include "timer.h"
+
+DNS_tstEntry DNS_astCache[DNS_CACHE_SIZE];
+DNS_tstPending DNS_astPending[DNS_PENDING_SIZE];
+uint32 DNS_u32UseCounter = 0;
+uint32 DNS_u32Hits = 0;
+uint32 DNS_u32Misses = 0;
+uint32 DNS_u32LookupTime = 0;
+
+static DNS_tstEntry* ICACHE_FLASH_ATTR DNS_pstFind(const char *hostname)
+{
+    uint8 i;
+
+    for (i = 0; i < DNS_CACHE_SIZE; i++)
+    {
+        if ((DNS_astCache[i].hostname[0] != '\0') && (os_strcmp(DNS_astCache[i].hostname, hostname) == 0))
+            return &DNS_astCache[i];
+    }
+    return NULL;
+}
+
+static bool ICACHE_FLASH_ATTR DNS_bIsValid(DNS_tstEntry *entry)
+{
+    uint32 age = Time_u32GetUptime() - entry->timestamp;
+
+    return age < (entry->found ? DNS_TTL : DNS_NEGATIVE_TTL);
+}
+
+// Returns the address for the caller: Result of the lookup or last known address if the lookup failed
+static ip_addr_t* ICACHE_FLASH_ATTR DNS_pstStore(const char *hostname, ip_addr_t *ip)
+{
+    DNS_tstEntry *entry = DNS_pstFind(hostname);
+    uint8 i;
+
+    if (entry == NULL)
+    {
+        // Use free entry or replace least recently used one
+        entry = &DNS_astCache[0];
+        for (i = 0; i < DNS_CACHE_SIZE; i++)
+        {
+            if (DNS_astCache[i].hostname[0] == '\0')
+            {
+                entry = &DNS_astCache[i];
+                break;
+            }
+            if (DNS_astCache[i].last_used < entry->last_used)
+                entry = &DNS_astCache[i];
+        }
+        os_strcpy(entry->hostname, hostname);
+    }
+    else
+        if ((ip == NULL) && entry->found)
+        {
+            // Lookup failed (network trouble?) => Last known address is used again. It stays valid as long as
+            // a negative entry would, so retries are spaced out.
+            entry->timestamp = Time_u32GetUptime() - (DNS_TTL - DNS_NEGATIVE_TTL);
+            entry->last_used = ++DNS_u32UseCounter;
+            return &entry->ip;
+        }
+
+    entry->found = (ip != NULL);
+    if (ip != NULL)
+        entry->ip = *ip;
+    entry->timestamp = Time_u32GetUptime();
+    entry->last_used = ++DNS_u32UseCounter;
+    return ip;
+}
+
+static DNS_tstPending* ICACHE_FLASH_ATTR DNS_pstGetPending(void)
+{
+    uint8 i;
+
+    for (i = 0; i < DNS_PENDING_SIZE; i++)
+    {
+        if (!DNS_astPending[i].busy)
+            return &DNS_astPending[i];
+    }
+    return NULL;
+}
+
+static void ICACHE_FLASH_ATTR DNS_vFoundCallback(const char *name, ip_addr_t *ip, void *arg)
+{
+    DNS_tstPending *pending = (DNS_tstPending*) arg;
+
+    DNS_u32LookupTime = (system_get_time() - pending->start_time) / 1000;
+    ip = DNS_pstStore(pending->hostname, ip);
+    pending->busy = 0;
+    if (!pending->prefetch)
+        pending->callback(pending->hostname, ip, pending->conn);
+}
+
+err_t ICACHE_FLASH_ATTR DNS_s8GetHostByName(struct espconn *conn, const char *hostname, ip_addr_t *addr, dns_found_callback callback)
+{
+    DNS_tstEntry *entry;
+    DNS_tstPending *pending;
+    err_t result;
+
+    // Same interface as SDK resolver. Hostnames that don't fit are not cached.
+    if (os_strlen(hostname) >= DNS_HOSTNAME_SIZE)
+        return espconn_gethostbyname(conn, hostname, addr, callback);
+
+    entry = DNS_pstFind(hostname);
+    if ((entry != NULL) && DNS_bIsValid(entry))
+    {
+        DNS_u32Hits++;
+        DNS_u32LookupTime = 0;
+        entry->last_used = ++DNS_u32UseCounter;
+        if (!entry->found)
+            return ESPCONN_ARG;
+        *addr = entry->ip;
+        return ESPCONN_OK;
+    }
+    DNS_u32Misses++;
+
+    pending = DNS_pstGetPending();
+    if (pending == NULL)
+        return espconn_gethostbyname(conn, hostname, addr, callback);
+
+    // SDK passes the connection pointer only as argument to the callback
+    os_strcpy(pending->hostname, hostname);
+    pending->prefetch = (callback == NULL);
+    pending->conn = conn;
+    pending->callback = callback;
+    pending->start_time = system_get_time();
+    result = espconn_gethostbyname((struct espconn*) pending, hostname, &pending->ip, DNS_vFoundCallback);
+    if (result == ESPCONN_INPROGRESS)
+    {
+        pending->busy = 1;
+        return result;
+    }
+    if (result == ESPCONN_OK)
+    {
+        // IP address or already in SDK table
+        DNS_pstStore(hostname, &pending->ip);
+        *addr = pending->ip;
+    }
+    return result;
+}
+
+void ICACHE_FLASH_ATTR DNS_vPrefetch(const char *hostname)
+{
+    ip_addr_t addr;
+    DNS_tstEntry *entry;
+
+    // Without a free slot the result could not be stored
+    if ((os_strlen(hostname) >= DNS_HOSTNAME_SIZE) || (DNS_pstGetPending() == NULL))
+        return;
+    // Resolve in background so the first request does not have to wait
+    entry = DNS_pstFind(hostname);
+    if ((entry != NULL) && DNS_bIsValid(entry))
+        return;
+    DNS_s8GetHostByName(NULL, hostname, &addr, NULL);
+}
+
+uint32 ICACHE_FLASH_ATTR DNS_u32GetHits(void)
+{
+    return DNS_u32Hits;
+}
+
+uint32 ICACHE_FLASH_ATTR DNS_u32GetMisses(void)
+{
+    return DNS_u32Misses;
+}
+
+uint32 ICACHE_FLASH_ATTR DNS_u32GetLookupTime(void)
+{
+    return DNS_u32LookupTime;
+}
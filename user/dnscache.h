@@ -0,0 +1,63 @@
+#ifndef USER_DNSCACHE_H_
+#define USER_DNSCACHE_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Number of hostnames kept (least recently used entry is replaced)
+#define DNS_CACHE_SIZE          8
+// Number of lookups that can run in parallel through the cache
+#define DNS_PENDING_SIZE        4
+// Longer hostnames are passed to the SDK resolver without caching
+#define DNS_HOSTNAME_SIZE       64
+// SDK does not report the record TTL => Fixed lifetime of positive and negative entries (s)
+#define DNS_TTL                 (10 * 60)
+#define DNS_NEGATIVE_TTL        30
+
+typedef struct
+{
+    char hostname[DNS_HOSTNAME_SIZE]; // Empty if entry is unused
+    ip_addr_t ip;
+    bool found; // Negative entry if not set
+    uint32 timestamp; // Uptime of lookup in s
+    uint32 last_used; // For least recently used replacement
+} DNS_tstEntry;
+
+typedef struct
+{
+    bool busy;
+    bool prefetch; // Nobody waits for result
+    char hostname[DNS_HOSTNAME_SIZE];
+    ip_addr_t ip; // Needed by SDK resolver until lookup is done
+    uint32 start_time; // In us
+    struct espconn *conn; // Argument for user callback
+    dns_found_callback callback;
+} DNS_tstPending;
+
+err_t ICACHE_FLASH_ATTR DNS_s8GetHostByName(struct espconn *conn, const char *hostname, ip_addr_t *addr, dns_found_callback callback);
+void ICACHE_FLASH_ATTR DNS_vPrefetch(const char *hostname);
+uint32 ICACHE_FLASH_ATTR DNS_u32GetHits(void);
+uint32 ICACHE_FLASH_ATTR DNS_u32GetMisses(void);
+uint32 ICACHE_FLASH_ATTR DNS_u32GetLookupTime(void);
+
+#endif /* USER_DNSCACHE_H_ */
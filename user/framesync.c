@@ -0,0 +1,313 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <esp8266.h>
+#include "framesync.h"
+
+// Average bitrate is calculated over roughly this amount of playing time (us)
+#define FSYNC_AVERAGE_TIME  10000000
+
+// Bits of the third header byte that have to stay constant within a stream
+#define FSYNC_REFERENCE_MASK_MPEG   0x0C // Sample rate
+#define FSYNC_REFERENCE_MASK_ADTS   0xFC // Profile and sample rate
+
+// Bitrates in kbit/s: MPEG1 layer 1, 2, 3 and MPEG2/2.5 layer 1, layer 2/3
+static const uint16 FSYNC_au16BitrateMpeg1[3][16] =
+{
+    { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },
+    { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },
+    { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 }
+};
+static const uint16 FSYNC_au16BitrateMpeg2[2][16] =
+{
+    { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },
+    { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 }
+};
+// Sample rates in Hz of MPEG1 (MPEG2: half, MPEG2.5: quarter)
+static const uint16 FSYNC_au16SampleRateMpeg[3] = { 44100, 48000, 32000 };
+static const uint32 FSYNC_au32SampleRateAdts[13] = { 96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350 };
+
+static uint32 ICACHE_FLASH_ATTR FSYNC_u32CheckMpeg(const uint8 *header, uint32 *samples, uint32 *sample_rate, uint16 *bitrate)
+{
+    uint8 version = (header[1] >> 3) & 0x03; // 3: MPEG1, 2: MPEG2, 0: MPEG2.5
+    uint8 layer = 4 - ((header[1] >> 1) & 0x03); // 1..3 (4: reserved)
+    uint8 index = header[2] >> 4;
+    uint8 rate = (header[2] >> 2) & 0x03;
+    uint8 padding = (header[2] >> 1) & 0x01;
+
+    // Reserved values and free format bitrate are not supported
+    if ((version == 1) || (layer == 4) || (index == 0) || (index == 15) || (rate == 3))
+        return 0;
+
+    *sample_rate = FSYNC_au16SampleRateMpeg[rate];
+    if (version == 3)
+    {
+        *bitrate = FSYNC_au16BitrateMpeg1[layer - 1][index];
+        *samples = (layer == 1) ? 384 : 1152;
+    }
+    else
+    {
+        *sample_rate >>= (version == 2) ? 1 : 2;
+        *bitrate = FSYNC_au16BitrateMpeg2[(layer == 1) ? 0 : 1][index];
+        *samples = (layer == 1) ? 384 : ((layer == 2) ? 1152 : 576);
+    }
+
+    // Layer 1 uses 4 byte slots
+    if (layer == 1)
+        return (12 * 1000 * (uint32) *bitrate / *sample_rate + padding) * 4;
+    return *samples / 8 * 1000 * (uint32) *bitrate / *sample_rate + padding;
+}
+
+static uint32 ICACHE_FLASH_ATTR FSYNC_u32CheckAdts(const uint8 *header, uint32 *samples, uint32 *sample_rate, uint16 *bitrate)
+{
+    uint8 rate = (header[2] >> 2) & 0x0F;
+    uint32 length = ((uint32) (header[3] & 0x03) << 11) | ((uint32) header[4] << 3) | (header[5] >> 5);
+
+    if ((rate >= sizeof(FSYNC_au32SampleRateAdts) / sizeof(FSYNC_au32SampleRateAdts[0])) || (length < FSYNC_HEADER_SIZE))
+        return 0;
+
+    *sample_rate = FSYNC_au32SampleRateAdts[rate];
+    *samples = 1024 * ((header[6] & 0x03) + 1);
+    *bitrate = length * 8 * (*sample_rate / 1000) / *samples;
+    return length;
+}
+
+static uint32 ICACHE_FLASH_ATTR FSYNC_u32CheckHeader(FSYNC_tstParser *parser, const uint8 *header)
+{
+    FSYNC_tenFormat format;
+    uint32 length;
+    uint32 samples;
+    uint32 sample_rate;
+    uint16 bitrate;
+    uint8 mask;
+
+    if ((header[0] != 0xFF) || ((header[1] & 0xE0) != 0xE0))
+        return 0;
+
+    // ADTS uses a 12 bit sync word and layer 0. This is a reserved combination for MPEG audio.
+    if ((header[1] & 0xF6) == 0xF0)
+    {
+        format = FSYNC_enFormatAdts;
+        length = FSYNC_u32CheckAdts(header, &samples, &sample_rate, &bitrate);
+    }
+    else
+    {
+        format = FSYNC_enFormatMpeg;
+        length = FSYNC_u32CheckMpeg(header, &samples, &sample_rate, &bitrate);
+    }
+    if (length < FSYNC_HEADER_SIZE)
+        return 0;
+
+    // Sync words appear in audio data as well. Version, layer and sample rate don't change within a stream.
+    // MPEG bitrate and padding change from frame to frame (VBR), ADTS keeps profile and sample rate.
+    mask = (format == FSYNC_enFormatAdts) ? FSYNC_REFERENCE_MASK_ADTS : FSYNC_REFERENCE_MASK_MPEG;
+    if (parser->format == FSYNC_enFormatUnknown)
+    {
+        // First header is only a candidate. The header behind its frame has to match before anything is handed over.
+        parser->format = format;
+        parser->reference[0] = header[1];
+        parser->reference[1] = header[2] & mask;
+        parser->probing = 1;
+        return length;
+    }
+    if ((parser->format != format) || (parser->reference[0] != header[1]) || (parser->reference[1] != (header[2] & mask)))
+        return 0;
+    parser->probing = 0;
+
+    // Keep statistics for bitrate and duration calculation
+    parser->sample_rate = sample_rate;
+    parser->bitrate = bitrate;
+    parser->frames++;
+    parser->bytes += length;
+    parser->time += samples * 1000 / (sample_rate / 1000);
+    if (parser->time > FSYNC_AVERAGE_TIME)
+    {
+        parser->bytes /= 2;
+        parser->time /= 2;
+    }
+    return length;
+}
+
+static void ICACHE_FLASH_ATTR FSYNC_vDropCandidate(FSYNC_tstParser *parser)
+{
+    // Candidate was a sync word within audio data => Search again without reference
+    parser->probing = 0;
+    parser->format = FSYNC_enFormatUnknown;
+}
+
+static void ICACHE_FLASH_ATTR FSYNC_vLoseSync(FSYNC_tstParser *parser)
+{
+    if (parser->locked)
+    {
+        parser->locked = 0;
+        parser->sync_lost++;
+    }
+    parser->discarded++;
+}
+
+void ICACHE_FLASH_ATTR FSYNC_vInit(FSYNC_tstParser *parser, FSYNC_tpfOutputCallback output_callback, void *arg)
+{
+    parser->locked = 0;
+    parser->probing = 0;
+    parser->format = FSYNC_enFormatUnknown;
+    parser->header_length = 0;
+    parser->frame_length = 0;
+    parser->remaining = 0;
+    parser->sample_rate = 0;
+    parser->bitrate = 0;
+    parser->bytes = 0;
+    parser->time = 0;
+    parser->frames = 0;
+    parser->sync_lost = 0;
+    parser->discarded = 0;
+    parser->output_callback = output_callback;
+    parser->arg = arg;
+}
+
+void ICACHE_FLASH_ATTR FSYNC_vProcess(FSYNC_tstParser *parser, char *data, uint32 length)
+{
+    uint8 *ptr = (uint8*) data;
+    uint32 start = 0; // Begin of data that has not been handed over yet
+    uint32 pos = 0;
+    uint32 count;
+
+    while (pos < length)
+    {
+        if (parser->remaining != 0)
+        {
+            // Inside of a frame => Pass through
+            count = length - pos;
+            if (count > parser->remaining)
+                count = parser->remaining;
+            if (parser->probing)
+            {
+                // Frame of a candidate => Hand over frames before and drop it
+                if (pos > start)
+                    parser->output_callback(parser->arg, (char*) &ptr[start], pos - start);
+                parser->discarded += count;
+                start = pos + count;
+            }
+            pos += count;
+            parser->remaining -= count;
+        }
+        else
+            if ((parser->header_length == 0) && (length - pos >= FSYNC_HEADER_SIZE))
+            {
+                // Header is complete within data => Check it in place
+                parser->frame_length = FSYNC_u32CheckHeader(parser, &ptr[pos]);
+                if (parser->frame_length != 0)
+                {
+                    parser->locked = !parser->probing;
+                    parser->remaining = parser->frame_length;
+                }
+                else if (parser->probing)
+                {
+                    // Same position is checked again without reference
+                    FSYNC_vDropCandidate(parser);
+                }
+                else
+                {
+                    // Hand over frames before and search byte by byte
+                    if (pos > start)
+                        parser->output_callback(parser->arg, (char*) &ptr[start], pos - start);
+                    FSYNC_vLoseSync(parser);
+                    pos++;
+                    start = pos;
+                }
+            }
+            else
+            {
+                // Header is split => Hand over complete frames and collect header bytes
+                if (pos > start)
+                    parser->output_callback(parser->arg, (char*) &ptr[start], pos - start);
+                while ((parser->header_length < FSYNC_HEADER_SIZE) && (pos < length))
+                    parser->header[parser->header_length++] = ptr[pos++];
+                start = pos;
+                if (parser->header_length < FSYNC_HEADER_SIZE)
+                    break;
+                parser->frame_length = FSYNC_u32CheckHeader(parser, parser->header);
+                if (parser->frame_length != 0)
+                {
+                    // Only the header has to be copied
+                    parser->locked = !parser->probing;
+                    parser->remaining = parser->frame_length - FSYNC_HEADER_SIZE;
+                    parser->header_length = 0;
+                    if (parser->probing)
+                        parser->discarded += FSYNC_HEADER_SIZE;
+                    else
+                        parser->output_callback(parser->arg, (char*) parser->header, FSYNC_HEADER_SIZE);
+                }
+                else if (parser->probing)
+                {
+                    // Same header bytes are checked again without reference
+                    FSYNC_vDropCandidate(parser);
+                }
+                else
+                {
+                    // Move search window by one byte
+                    FSYNC_vLoseSync(parser);
+                    parser->header_length--;
+                    os_memmove(parser->header, &parser->header[1], parser->header_length);
+                }
+            }
+    }
+
+    if (pos > start)
+        parser->output_callback(parser->arg, (char*) &ptr[start], pos - start);
+}
+
+uint32 ICACHE_FLASH_ATTR FSYNC_u32Discontinuity(FSYNC_tstParser *parser)
+{
+    uint32 partial = 0;
+
+    // Part of the current frame has been handed over already. Caller should remove it if possible.
+    if ((parser->remaining != 0) && !parser->probing)
+        partial = parser->frame_length - parser->remaining;
+    // Candidate can't be confirmed anymore
+    if (parser->probing)
+        FSYNC_vDropCandidate(parser);
+    parser->discarded += partial + parser->header_length;
+    parser->remaining = 0;
+    parser->header_length = 0;
+    // Data behind discontinuity is discarded until next frame header
+    parser->locked = 0;
+    return partial;
+}
+
+uint16 ICACHE_FLASH_ATTR FSYNC_u16GetBitrate(FSYNC_tstParser *parser)
+{
+    // Average over recent frames (variable bitrate streams)
+    if (parser->time < 1000)
+        return parser->bitrate;
+    return parser->bytes * 8 / (parser->time / 1000);
+}
+
+uint32 ICACHE_FLASH_ATTR FSYNC_u32GetDuration(FSYNC_tstParser *parser, uint32 bytes)
+{
+    uint16 bitrate = FSYNC_u16GetBitrate(parser);
+
+    // Playing time in ms of the given amount of data
+    if (bitrate == 0)
+        return 0;
+    return bytes * 8 / bitrate;
+}
@@ -0,0 +1,66 @@
+#ifndef USER_FRAMESYNC_H_
+#define USER_FRAMESYNC_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Bytes needed to check a frame header (ADTS header without CRC, MPEG header uses only 4 of them)
+#define FSYNC_HEADER_SIZE   7
+
+typedef void (*FSYNC_tpfOutputCallback)(void *arg, char *data, uint32 len);
+
+typedef enum
+{
+    FSYNC_enFormatUnknown,
+    FSYNC_enFormatMpeg, // MPEG 1/2/2.5 audio layer 1/2/3
+    FSYNC_enFormatAdts // AAC with ADTS header
+} FSYNC_tenFormat;
+
+typedef struct
+{
+    bool locked; // Frame boundaries are known, otherwise data is discarded until a header is found
+    bool probing; // Reference is taken from a single header, its frame is discarded until the next header confirms it
+    FSYNC_tenFormat format;
+    uint8 reference[3]; // Header bytes that have to stay constant within a stream
+    uint8 header[FSYNC_HEADER_SIZE]; // Header split over two data blocks
+    uint8 header_length;
+    uint32 frame_length; // Length of current frame incl. header
+    uint32 remaining; // Bytes left in current frame
+    uint32 sample_rate; // Of last frame in Hz
+    uint16 bitrate; // Of last frame in kbit/s
+    uint32 bytes; // Bytes of recent frames (for average bitrate)
+    uint32 time; // Playing time of recent frames in us
+    uint32 frames; // Number of frames passed
+    uint32 sync_lost; // Number of times a header was expected but not found
+    uint32 discarded; // Bytes not belonging to a complete frame
+    FSYNC_tpfOutputCallback output_callback;
+    void *arg;
+} FSYNC_tstParser;
+
+void ICACHE_FLASH_ATTR FSYNC_vInit(FSYNC_tstParser *parser, FSYNC_tpfOutputCallback output_callback, void *arg);
+void ICACHE_FLASH_ATTR FSYNC_vProcess(FSYNC_tstParser *parser, char *data, uint32 length);
+uint32 ICACHE_FLASH_ATTR FSYNC_u32Discontinuity(FSYNC_tstParser *parser);
+uint16 ICACHE_FLASH_ATTR FSYNC_u16GetBitrate(FSYNC_tstParser *parser);
+uint32 ICACHE_FLASH_ATTR FSYNC_u32GetDuration(FSYNC_tstParser *parser, uint32 bytes);
+
+#endif /* USER_FRAMESYNC_H_ */
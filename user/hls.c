@@ -0,0 +1,383 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <esp8266.h>
+#include "hls.h"
+
+// First byte of every MPEG-TS packet
+#define HLS_TS_SYNC_BYTE            0x47
+// PID of program association table
+#define HLS_TS_PAT_PID              0x0000
+
+static const char* ICACHE_FLASH_ATTR HLS_pcGetTagValue(const char *line, const char *tag)
+{
+    uint32 length = os_strlen(tag);
+
+    if (os_strncmp(line, tag, length) != 0)
+        return NULL;
+    return line + length;
+}
+
+static bool ICACHE_FLASH_ATTR HLS_bResolveUrl(const char *base, const char *ref, char *url, uint16 size)
+{
+    const char *end;
+    uint32 prefix;
+
+    if ((os_strncmp(ref, "http://", 7) == 0) || (os_strncmp(ref, "https://", 8) == 0))
+    {
+        // Absolute URL
+        prefix = 0;
+    }
+    else
+        if (ref[0] == '/')
+        {
+            // Absolute path => Same server as playlist
+            end = os_strstr(base, "://");
+            end = (end != NULL) ? os_strchr(end + 3, '/') : NULL;
+            prefix = (end != NULL) ? end - base : os_strlen(base);
+        }
+        else
+        {
+            // Relative path => Same directory as playlist (query string of playlist doesn't belong to it)
+            end = os_strchr(base, '?');
+            prefix = (end != NULL) ? end - base : os_strlen(base);
+            while ((prefix > 0) && (base[prefix - 1] != '/'))
+                prefix--;
+        }
+    if (prefix + os_strlen(ref) >= size)
+        return 0;
+    os_memcpy(url, base, prefix);
+    os_strcpy(url + prefix, ref);
+    return 1;
+}
+
+static void ICACHE_FLASH_ATTR HLS_vQueueSegment(HLS_tstPlaylist *playlist, uint32 sequence, const char *uri)
+{
+    HLS_tstSegment *segment;
+
+    // Segment has been queued by an earlier load
+    if (playlist->loaded && (sequence < playlist->next_sequence))
+        return;
+    if (playlist->queue_count == HLS_QUEUE_SIZE)
+    {
+        // Rest is queued by one of the next reloads
+        if (playlist->loaded)
+            return;
+        // First load => Playback starts close to the live edge, oldest segments are dropped
+        playlist->queue_start = (playlist->queue_start + 1) % HLS_QUEUE_SIZE;
+        playlist->queue_count--;
+    }
+    segment = &playlist->queue[(playlist->queue_start + playlist->queue_count) % HLS_QUEUE_SIZE];
+    if (!HLS_bResolveUrl(playlist->base, uri, segment->url, HLS_URL_SIZE))
+        return;
+    segment->sequence = sequence;
+    playlist->queue_count++;
+    playlist->next_sequence = sequence + 1;
+}
+
+static void ICACHE_FLASH_ATTR HLS_vParseLine(HLS_tstPlaylist *playlist)
+{
+    const char *line = playlist->line;
+    const char *value;
+
+    if (line[0] == '\0')
+        return;
+    if ((value = HLS_pcGetTagValue(line, "#EXT-X-TARGETDURATION:")) != NULL)
+        playlist->target_duration = TEXT_u32ParseNumber(value, NULL);
+    else
+        if ((value = HLS_pcGetTagValue(line, "#EXT-X-MEDIA-SEQUENCE:")) != NULL)
+            playlist->media_sequence = TEXT_u32ParseNumber(value, NULL);
+        else
+            if (HLS_pcGetTagValue(line, "#EXT-X-ENDLIST") != NULL)
+                playlist->endlist = 1;
+            else
+                if (HLS_pcGetTagValue(line, "#EXT-X-STREAM-INF:") != NULL)
+                    playlist->variant_next = 1;
+                else
+                    if (line[0] != '#')
+                    {
+                        // URI line
+                        if (playlist->variant_next)
+                        {
+                            // Master playlist => First variant is used
+                            playlist->variant_next = 0;
+                            if (!playlist->master && HLS_bResolveUrl(playlist->base, line, playlist->variant, HLS_URL_SIZE))
+                                playlist->master = 1;
+                            return;
+                        }
+                        HLS_vQueueSegment(playlist, playlist->media_sequence + playlist->index, line);
+                        playlist->index++;
+                    }
+    // Other tags and comments are ignored
+}
+
+static void ICACHE_FLASH_ATTR HLS_vSkipLine(HLS_tstPlaylist *playlist)
+{
+    // Truncated URI is useless, but the segment keeps its sequence number (numbering of later ones stays right)
+    if (playlist->line[0] == '#')
+        return;
+    if (playlist->variant_next)
+        playlist->variant_next = 0;
+    else
+        playlist->index++;
+}
+
+bool ICACHE_FLASH_ATTR HLS_bIsPlaylist(const char *content_type, const char *path)
+{
+    // application/vnd.apple.mpegurl (other mpegurl types are plain .m3u playlists unless the path says otherwise)
+    if (os_strstr(content_type, "vnd.apple.mpegurl") != NULL)
+        return 1;
+    return TEXT_bHasExtension(path, ".m3u8");
+}
+
+bool ICACHE_FLASH_ATTR HLS_bInit(HLS_tstPlaylist *playlist, const char *url)
+{
+    if (os_strlen(url) >= HLS_URL_SIZE)
+        return 0;
+    os_strcpy(playlist->base, url);
+    playlist->loaded = 0;
+    playlist->next_sequence = 0;
+    playlist->queue_start = 0;
+    playlist->queue_count = 0;
+    HLS_vBeginPlaylist(playlist);
+    return 1;
+}
+
+void ICACHE_FLASH_ATTR HLS_vBeginPlaylist(HLS_tstPlaylist *playlist)
+{
+    // Playlist is parsed from scratch. Queued segments are kept.
+    TEXT_vInitLine(&playlist->reader);
+    playlist->variant_next = 0;
+    playlist->media_sequence = 0;
+    playlist->index = 0;
+    playlist->master = 0;
+    playlist->endlist = 0;
+    playlist->target_duration = 0;
+}
+
+static void ICACHE_FLASH_ATTR HLS_vHandleLine(HLS_tstPlaylist *playlist)
+{
+    if (!playlist->reader.truncated)
+        HLS_vParseLine(playlist);
+    else
+        HLS_vSkipLine(playlist);
+}
+
+void ICACHE_FLASH_ATTR HLS_vProcessPlaylist(HLS_tstPlaylist *playlist, const char *data, uint32 length)
+{
+    uint32 consumed;
+
+    while (length != 0)
+    {
+        if (TEXT_bReadLine(&playlist->reader, playlist->line, sizeof(playlist->line), data, length, &consumed))
+            HLS_vHandleLine(playlist);
+        data += consumed;
+        length -= consumed;
+    }
+}
+
+void ICACHE_FLASH_ATTR HLS_vFinishPlaylist(HLS_tstPlaylist *playlist)
+{
+    if (TEXT_bFinishLine(&playlist->reader, playlist->line))
+        HLS_vHandleLine(playlist);
+    TEXT_vInitLine(&playlist->reader);
+    playlist->loaded = 1;
+}
+
+const char* ICACHE_FLASH_ATTR HLS_pcGetSegment(HLS_tstPlaylist *playlist)
+{
+    // URL stays valid until the playlist is processed again
+    if (playlist->queue_count == 0)
+        return NULL;
+    return playlist->queue[playlist->queue_start].url;
+}
+
+void ICACHE_FLASH_ATTR HLS_vDropSegment(HLS_tstPlaylist *playlist)
+{
+    if (playlist->queue_count == 0)
+        return;
+    playlist->queue_start = (playlist->queue_start + 1) % HLS_QUEUE_SIZE;
+    playlist->queue_count--;
+}
+
+uint32 ICACHE_FLASH_ATTR HLS_u32GetUpdateInterval(HLS_tstPlaylist *playlist)
+{
+    uint32 duration = (playlist->target_duration != 0) ? playlist->target_duration : HLS_DEFAULT_TARGET_DURATION;
+
+    // Reloading at half the target duration keeps the queue filled without missing segments
+    return duration * 1000 / 2;
+}
+
+// Returns offset of table data and offset behind it (CRC is not checked), 0 if the table doesn't fit into the packet
+static uint32 ICACHE_FLASH_ATTR HLS_u32GetSection(const uint8 *packet, uint32 offset, uint8 table_id, uint32 *end)
+{
+    uint32 length;
+
+    // Skip pointer field
+    offset += 1 + packet[offset];
+    if ((offset + 3 > HLS_TS_PACKET_SIZE) || (packet[offset] != table_id))
+        return 0;
+    length = ((packet[offset + 1] & 0x0F) << 8) | packet[offset + 2];
+    // Tables of a single program always fit into one packet
+    if ((length < 4) || (offset + 3 + length > HLS_TS_PACKET_SIZE))
+        return 0;
+    *end = offset + 3 + length - 4;
+    return offset;
+}
+
+static void ICACHE_FLASH_ATTR HLS_vParsePat(HLS_tstDemux *demux, const uint8 *packet, uint32 offset)
+{
+    uint32 end;
+    uint32 i;
+
+    offset = HLS_u32GetSection(packet, offset, 0x00, &end);
+    if (offset == 0)
+        return;
+    // Program number (2 bytes) and PID of its map table (13 bits) => First real program is used
+    for (i = offset + 8; i + 4 <= end; i += 4)
+    {
+        if ((packet[i] != 0) || (packet[i + 1] != 0))
+        {
+            demux->pmt_pid = ((packet[i + 2] & 0x1F) << 8) | packet[i + 3];
+            return;
+        }
+    }
+}
+
+static void ICACHE_FLASH_ATTR HLS_vParsePmt(HLS_tstDemux *demux, const uint8 *packet, uint32 offset)
+{
+    uint32 end;
+    uint32 i;
+    uint8 type;
+
+    offset = HLS_u32GetSection(packet, offset, 0x02, &end);
+    if ((offset == 0) || (offset + 12 > end))
+        return;
+    // Stream type (1 byte), PID (13 bits) and length of descriptors follow the program descriptors
+    i = offset + 12 + (((packet[offset + 10] & 0x0F) << 8) | packet[offset + 11]);
+    while (i + 5 <= end)
+    {
+        type = packet[i];
+        // AAC with ADTS header, MPEG 1 audio, MPEG 2 audio
+        if ((type == 0x0F) || (type == 0x03) || (type == 0x04))
+        {
+            demux->audio_pid = ((packet[i + 1] & 0x1F) << 8) | packet[i + 2];
+            return;
+        }
+        i += 5 + (((packet[i + 3] & 0x0F) << 8) | packet[i + 4]);
+    }
+}
+
+static void ICACHE_FLASH_ATTR HLS_vParsePacket(HLS_tstDemux *demux)
+{
+    uint8 *packet = demux->packet;
+    uint16 pid = ((packet[1] & 0x1F) << 8) | packet[2];
+    bool start = (packet[1] & 0x40) != 0;
+    uint32 offset = 4;
+
+    // Skip adaptation field
+    if (packet[3] & 0x20)
+        offset += 1 + packet[4];
+    // No payload
+    if (!(packet[3] & 0x10) || (offset >= HLS_TS_PACKET_SIZE))
+        return;
+
+    if (pid == HLS_TS_PAT_PID)
+    {
+        if (start)
+            HLS_vParsePat(demux, packet, offset);
+        return;
+    }
+    if ((demux->pmt_pid != 0) && (pid == demux->pmt_pid))
+    {
+        if (start)
+            HLS_vParsePmt(demux, packet, offset);
+        return;
+    }
+    if ((demux->audio_pid == 0) || (pid != demux->audio_pid))
+        return;
+
+    if (start)
+    {
+        // PES header: Start code, stream id, length, flags and optional fields
+        if ((offset + 9 > HLS_TS_PACKET_SIZE) || (packet[offset] != 0) || (packet[offset + 1] != 0) || (packet[offset + 2] != 1))
+            return;
+        offset += 9 + packet[offset + 8];
+        if (offset >= HLS_TS_PACKET_SIZE)
+            return;
+    }
+    // Frames of elementary stream are passed on in the order they arrive
+    demux->output_callback(demux->arg, (char*) &packet[offset], HLS_TS_PACKET_SIZE - offset);
+}
+
+void ICACHE_FLASH_ATTR HLS_vInitDemux(HLS_tstDemux *demux, HLS_tpfOutputCallback output_callback, void *arg)
+{
+    demux->mode = HLS_enDemuxUnknown;
+    demux->length = 0;
+    demux->pmt_pid = 0;
+    demux->audio_pid = 0;
+    demux->output_callback = output_callback;
+    demux->arg = arg;
+}
+
+void ICACHE_FLASH_ATTR HLS_vDemux(HLS_tstDemux *demux, char *data, uint32 length)
+{
+    uint32 count;
+
+    if (length == 0)
+        return;
+    // Segment is either a transport stream or packed audio
+    if (demux->mode == HLS_enDemuxUnknown)
+        demux->mode = ((uint8) data[0] == HLS_TS_SYNC_BYTE) ? HLS_enDemuxTs : HLS_enDemuxRaw;
+    if (demux->mode == HLS_enDemuxRaw)
+    {
+        // Frame sync skips ID3 tag in front of the first frame
+        demux->output_callback(demux->arg, data, length);
+        return;
+    }
+
+    // Packets can be split at any position. Only the current packet is kept between calls.
+    while (length != 0)
+    {
+        if ((demux->length == 0) && ((uint8) *data != HLS_TS_SYNC_BYTE))
+        {
+            // Lost packet alignment => Search next sync byte
+            demux->discarded++;
+            data++;
+            length--;
+            continue;
+        }
+        count = HLS_TS_PACKET_SIZE - demux->length;
+        if (count > length)
+            count = length;
+        os_memcpy(&demux->packet[demux->length], data, count);
+        demux->length += count;
+        data += count;
+        length -= count;
+        if (demux->length == HLS_TS_PACKET_SIZE)
+        {
+            HLS_vParsePacket(demux);
+            demux->length = 0;
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef USER_HLS_H_
+#define USER_HLS_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "text.h"
+
+// Maximum length of a playlist line and of a resolved URL (longer ones are ignored)
+#define HLS_LINE_SIZE               256
+#define HLS_URL_SIZE                256
+// Segments queued ahead of the one being fetched
+#define HLS_QUEUE_SIZE              3
+// Target duration assumed if the playlist doesn't give one in s
+#define HLS_DEFAULT_TARGET_DURATION 10
+#define HLS_TS_PACKET_SIZE          188
+
+typedef void (*HLS_tpfOutputCallback)(void *arg, char *data, uint32 len);
+
+typedef struct
+{
+    uint32 sequence; // Media sequence number
+    char url[HLS_URL_SIZE];
+} HLS_tstSegment;
+
+typedef struct
+{
+    // State of current (re)load
+    TEXT_tstLine reader;
+    bool variant_next; // Next URI belongs to an #EXT-X-STREAM-INF tag
+    uint32 media_sequence; // Sequence number of first segment in playlist
+    uint32 index; // Segments in playlist so far
+    char line[HLS_LINE_SIZE];
+    // Result
+    char base[HLS_URL_SIZE]; // URL of playlist, relative URIs are resolved against it
+    bool master; // Playlist lists variants instead of segments
+    char variant[HLS_URL_SIZE]; // URL of first variant (master playlist only)
+    bool endlist; // No segments will be added (not a live stream)
+    uint16 target_duration; // Maximum segment duration in s
+    // Segments not fetched yet. Filled from the playlist on every reload.
+    bool loaded; // Playlist has been loaded before => next_sequence is valid
+    uint32 next_sequence; // Sequence number of next segment to be queued
+    uint8 queue_start;
+    uint8 queue_count;
+    HLS_tstSegment queue[HLS_QUEUE_SIZE];
+} HLS_tstPlaylist;
+
+typedef enum
+{
+    HLS_enDemuxUnknown, // No data yet
+    HLS_enDemuxTs, // MPEG transport stream => Audio elementary stream is extracted
+    HLS_enDemuxRaw // Packed audio (ADTS or MPEG frames, maybe with ID3 tag) => Passed as it is
+} HLS_tenDemuxMode;
+
+typedef struct
+{
+    HLS_tenDemuxMode mode;
+    uint8 length; // Bytes of current TS packet received so far
+    uint16 pmt_pid; // PID of program map table (0 = not known yet)
+    uint16 audio_pid; // PID of audio stream (0 = not known yet)
+    uint32 discarded; // Bytes skipped while searching for the start of a TS packet
+    uint8 packet[HLS_TS_PACKET_SIZE]; // TS packet split over two data blocks
+    HLS_tpfOutputCallback output_callback;
+    void *arg;
+} HLS_tstDemux;
+
+bool ICACHE_FLASH_ATTR HLS_bIsPlaylist(const char *content_type, const char *path);
+bool ICACHE_FLASH_ATTR HLS_bInit(HLS_tstPlaylist *playlist, const char *url);
+void ICACHE_FLASH_ATTR HLS_vBeginPlaylist(HLS_tstPlaylist *playlist);
+void ICACHE_FLASH_ATTR HLS_vProcessPlaylist(HLS_tstPlaylist *playlist, const char *data, uint32 length);
+void ICACHE_FLASH_ATTR HLS_vFinishPlaylist(HLS_tstPlaylist *playlist);
+const char* ICACHE_FLASH_ATTR HLS_pcGetSegment(HLS_tstPlaylist *playlist);
+void ICACHE_FLASH_ATTR HLS_vDropSegment(HLS_tstPlaylist *playlist);
+uint32 ICACHE_FLASH_ATTR HLS_u32GetUpdateInterval(HLS_tstPlaylist *playlist);
+void ICACHE_FLASH_ATTR HLS_vInitDemux(HLS_tstDemux *demux, HLS_tpfOutputCallback output_callback, void *arg);
+void ICACHE_FLASH_ATTR HLS_vDemux(HLS_tstDemux *demux, char *data, uint32 length);
+
+#endif /* USER_HLS_H_ */
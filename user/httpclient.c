@@ -14,6 +14,13 @@
 #include "limits.h"
 #include "httpclient.h"
 #include "vs1053.h"
+#include "icy.h"
+#include "httpheader.h"
+#include "framesync.h"
+#include "playlist.h"
+#include "dnscache.h"
+#include "chunked.h"
+#include "hls.h"
 
 // Debug output.
 #if 1
@@ -22,27 +29,235 @@
 #define PRINTF(...)
 #endif
 
+// Flow control: Stop receiving as soon as the ring buffer has less free space than this
+#define HTTPC_HOLD_FREE_BYTES       (2 * 1460)
+// Flow control: Continue receiving after the ring buffer has been drained down to this level
+#define HTTPC_UNHOLD_USED_BYTES     (VS1053_BUFFER_SIZE / 2)
+// Flow control: Interval for checking the ring buffer level while receiving is on hold
+#define HTTPC_FLOW_TIMER_MS         10
+// Data that did not fit into ring buffer is parked here until there is space again
+#define HTTPC_PARK_BUFFER_SIZE      (2 * 1460)
+// Playback starts as soon as this amount of audio (in ms) is buffered
+#define HTTPC_PREBUFFER_MS          1000
+// Bitrate assumed until it is known from header or first frame (kbit/s)
+#define HTTPC_DEFAULT_BITRATE       128
+// Prebuffer needs to stay below the flow control level. Otherwise receiving would be stopped before playback starts.
+#define HTTPC_PREBUFFER_MAX_BYTES   (VS1053_BUFFER_SIZE - 2 * HTTPC_HOLD_FREE_BYTES)
+// Reconnect: Delay before first attempt, doubled with every further attempt up to HTTPC_RECONNECT_MAX_MS
+#define HTTPC_RECONNECT_BASE_MS     250
+#define HTTPC_RECONNECT_MAX_MS      16000
+// Reconnect: Give up after this many attempts without receiving audio data
+#define HTTPC_RECONNECT_MAX_ATTEMPTS 12
+// Maximum number of redirects and playlists followed until audio data is received
+#define HTTPC_REDIRECT_MAX          5
+// Number of stations the resolved URL (after redirects and playlists) is remembered for
+#define HTTPC_RESOLVE_CACHE_SIZE    4
+#define HTTPC_HOSTNAME_SIZE         128
+#define HTTPC_PATH_SIZE             256
+#define HTTPC_URL_SIZE              HTTPC_STATION_URL_SIZE
+#define HTTPC_HEADERS_SIZE          64
+// Stall watchdog: Inbound data rate is compared against bitrate in this interval
+#define HTTPC_WATCHDOG_MS           250
+// Stall watchdog: Rate has to stay below bitrate at least this long before it counts as stall
+#define HTTPC_WATCHDOG_STALL_MS     (2 * HTTPC_WATCHDOG_MS)
+// Stall watchdog: Switch to alternate URL if ring buffer would run dry within this time (connection setup time)
+#define HTTPC_FAILOVER_MARGIN_MS    1500
+// Stall watchdog: Margin is limited to this share of the ring buffer playing time (higher bitrates fit less)
+#define HTTPC_FAILOVER_MARGIN_PERCENT 50
+// Bitrate tiers: Buffer trend is evaluated over this window
+#define HTTPC_TIER_WINDOW_MS        4000
+// Bitrate tiers: Buffer has to shrink by more than this within a window to count as negative trend
+#define HTTPC_TIER_TREND_MS         200
+// Bitrate tiers: Ring buffer has to be kept filled this long before a higher tier is tried (doubled after each drop)
+#define HTTPC_TIER_UP_MS            30000
+#define HTTPC_TIER_UP_MAX_MS        480000
+// Mirror racing: Connections to different URLs of a station competing at station start
+#define HTTPC_RACE_COUNT            2
+// Mirror racing: Delay before the next URL joins the race
+#define HTTPC_RACE_STAGGER_MS       300
+// Number of stations the fastest mirror is remembered for
+#define HTTPC_MIRROR_CACHE_SIZE     8
+// Requests running at the same time (stream or racing mirrors, stream being closed, failover, playlist/metadata/OTA fetch and warm standby)
+#ifdef WARM_STANDBY
+#define HTTPC_CONTEXT_COUNT         6
+#else
+#define HTTPC_CONTEXT_COUNT         5
+#endif
+// Warm standby: Audio data buffered for the standby station while its connection is kept open
+#define HTTPC_STANDBY_BUFFER_SIZE   8192
+// Warm standby: Playback starts right away after switching if at least this amount has been buffered
+#define HTTPC_STANDBY_START_BYTES   4096
+
+typedef struct
+{
+    struct espconn *conn; // Connection receiving is on hold for (NULL if connection is gone)
+    bool hold;
+    uint32 hold_start; // Timestamp of hold begin in us
+    uint32 hold_time; // Total time spent on hold in ms
+    uint32 hold_count;
+    uint32 dropped_bytes;
+    uint16 park_length;
+    uint8 park_buffer[HTTPC_PARK_BUFFER_SIZE];
+} HTTPC_tstFlowControl;
+
+typedef struct
+{
+    uint32 count; // Successful reconnects (audio data received again)
+    uint32 outage_start; // Timestamp of connection loss in us
+    uint32 outage_time; // Duration of last outage in ms
+    uint32 outage_max; // Longest outage in ms
+    uint32 buffered; // Bytes left in ring buffer when audio data was received again
+} HTTPC_tstReconnect;
+
+typedef struct
+{
+    uint32 stalls; // Stalls detected by watchdog
+    uint32 failovers; // Alternate connections that took over the stream
+    uint32 detect_time; // Timestamp of last stall detection in us
+    uint32 failover_time; // Time from stall detection until alternate delivered audio in ms
+    uint32 underruns; // Underrun count at stall detection
+    uint32 avoided; // Failovers completed without underrun since detection
+} HTTPC_tstWatchdog;
+
 typedef struct
 {
-    char *path;
+    uint32 hash; // Hash of URL requested by user
+    char *url; // URL audio data has been received from
+} HTTPC_tstResolveCache;
+
+typedef struct
+{
+    bool used; // Context belongs to a running request
+    struct espconn *conn; // Points to espconn below while connected (NULL otherwise)
+    struct espconn espconn;
+    esp_tcp tcp;
+    char url[HTTPC_URL_SIZE]; // URL requested by user (empty if not a stream)
+    char path[HTTPC_PATH_SIZE];
     int port;
     char *post_data;
-    char *headers;
-    char *hostname;
-    char *buffer;
-    int buffer_size;
+    char headers[HTTPC_HEADERS_SIZE];
+    char hostname[HTTPC_HOSTNAME_SIZE];
     bool secure;
     http_callback user_callback;
-    bool buffer_wait_timer_elapsed;
+    HTTPC_tstBodyCallbacks body_callbacks; // Body is handed over to caller instead of being played (on_data != NULL)
     bool header_received;
-    uint32 music_bytes_until_next_icycast;
-    uint32 icycast_info_interval;
-} request_args;
+    bool closing; // Disconnect has been requested => Remaining data is ignored
+    HTTPH_tstParser header;
+    CHUNKED_tstParser chunked;
+    ICY_tstParser icy;
+    FSYNC_tstParser fsync;
+    uint16 bitrate; // Stream bitrate in kbit/s (0 = unknown)
+    uint32 start_time; // Time of stream request in us
+    bool playing; // Feeder has been enabled for this stream
+    bool audio_received; // Audio data has been received at least once
+    bool discontinuity; // Data has been lost since last frame sync run
+    bool from_cache; // Request uses resolved URL from cache
+    bool playlist; // Response body is a playlist
+    uint8 redirects; // Redirects and playlists followed so far
+    const char *follow_url; // Continue with this URL after disconnect (points into header or playlist parser)
+    PLAYLIST_tstParser playlist_parser;
+    bool reconnect_pending; // Reconnect timer is armed
+    uint8 reconnect_attempts; // Attempts since connection loss
+    os_timer_t reconnect_timer;
+    bool stop; // Request has been cancelled => Close connection as soon as possible
+    bool standby; // Warm standby: Audio data goes to standby buffer instead of ring buffer
+    bool held; // Warm standby: Receiving is on hold because standby buffer is full (HLS prefetch: until segment takes over)
+    uint16 standby_length;
+    uint8 *standby_buffer;
+    uint32 received; // Bytes received on all connections of this request
+    uint8 mirror; // Index of URL in station list
+    bool failover; // Takes over the stream as soon as it delivers audio
+    bool tier_switch; // Failover has been started to change bitrate tier
+    os_timer_t watchdog_timer;
+    uint32 watchdog_received; // Bytes received at last watchdog check
+    uint32 stall_time; // Time inbound rate has been below bitrate in ms
+    bool racing; // Competes with other URLs of the station, first one delivering audio becomes the stream
+    bool hls_playlist; // Response body is an HLS playlist
+    bool hls; // Response body is an HLS segment
+    bool prefetch; // Next HLS segment: Receiving is on hold until the current one is done
+} HTTPC_tstContext;
+
+typedef struct
+{
+    uint32 goodput; // Average inbound rate while receiving is not on hold in Byte/s
+    uint32 window_time; // Time since start of trend window in ms
+    uint32 window_buffered; // Buffered audio at start of trend window in ms
+    uint32 headroom_time; // Time the link kept the ring buffer filled in ms
+    uint32 hold_count; // Flow control hold count at last check
+    uint32 hold_age; // Time since last flow control hold in ms
+    uint32 up_delay; // Headroom needed before a higher tier is tried in ms
+    uint32 switches; // Tier switches (up and down)
+} HTTPC_tstTier;
+
+typedef struct
+{
+    uint32 hash; // Hash of first URL of station
+    uint8 mirror; // URL that won the last race
+    uint32 startup_time; // Time until it delivered audio in ms
+} HTTPC_tstMirrorCache;
+
+typedef struct
+{
+    bool active;
+    uint8 first; // URL started first (winner of last race)
+    uint8 count; // URLs taking part (all URLs of one tier)
+    uint8 started; // URLs started so far
+    uint32 start_time; // Time of station start in us
+    uint32 time; // Startup time of last winner in ms
+    char headers[HTTPC_HEADERS_SIZE];
+    http_callback user_callback; // Handed over to winner
+    HTTPC_tstContext *racer[HTTPC_RACE_COUNT]; // NULL = free slot
+} HTTPC_tstRace;
 
-uint32 data_count = 0;
-bool StopStreaming = 0;
-bool SteamStarted = 0;
-os_timer_t HTTPC_TimerObject;
+typedef struct
+{
+    bool active; // Stream is made of HLS segments
+    bool idle; // Current segment is done, next one is not in the playlist yet
+    HTTPC_tstContext *owner; // Loads the playlist or fetches the current segment
+    HTTPC_tstContext *prefetch; // Fetches the next segment
+    HTTPC_tstContext *update; // Reloads the playlist
+    char headers[HTTPC_HEADERS_SIZE];
+    os_timer_t update_timer;
+    uint32 segments; // Segments received completely
+    uint32 skipped; // Segments lost
+    HLS_tstPlaylist playlist;
+    HLS_tstDemux demux; // Only the current segment is demuxed
+} HTTPC_tstHls;
+
+uint32 HTTPC_u32TimeToFirstAudio = 0;
+uint32 HTTPC_u32ReceiveTime = 0; // CPU time spent processing received data in us
+bool HTTPC_bTimeToFirstAudioStandby = 0;
+uint32 HTTPC_u32TimeToFirstByte = 0;
+bool HTTPC_bTimeToFirstByteCached = 0;
+HTTPC_tstResolveCache HTTPC_astResolveCache[HTTPC_RESOLVE_CACHE_SIZE];
+uint8 HTTPC_u8ResolveCacheNext = 0;
+os_timer_t HTTPC_FlowTimerObject;
+HTTPC_tstFlowControl HTTPC_stFlow;
+HTTPC_tstReconnect HTTPC_stReconnect;
+HTTPC_tstWatchdog HTTPC_stWatchdog;
+HTTPC_tstRace HTTPC_stRace;
+HTTPC_tstHls HTTPC_stHls;
+HTTPC_tstTier HTTPC_stTier;
+HTTPC_tstMirrorCache HTTPC_astMirrorCache[HTTPC_MIRROR_CACHE_SIZE];
+uint8 HTTPC_u8MirrorCacheNext = 0;
+os_timer_t HTTPC_RaceTimerObject;
+HTTPC_tstStation HTTPC_stStation;
+HTTPC_tstContext *HTTPC_pstStream = NULL;
+HTTPC_tstContext *HTTPC_pstStandby = NULL;
+HTTPC_tstContext *HTTPC_pstFailover = NULL;
+HTTPC_tstContext HTTPC_astContext[HTTPC_CONTEXT_COUNT];
+
+static void ICACHE_FLASH_ATTR HTTPC_vResolveHostname(HTTPC_tstContext *req);
+static bool ICACHE_FLASH_ATTR HTTPC_bSetUrl(HTTPC_tstContext *req, const char *url);
+static void ICACHE_FLASH_ATTR HTTPC_vDiscontinuity(HTTPC_tstContext *req);
+static void ICACHE_FLASH_ATTR HTTPC_vCloseRequest(HTTPC_tstContext *req);
+static void ICACHE_FLASH_ATTR HTTPC_vStartWatchdog(HTTPC_tstContext *req);
+static void ICACHE_FLASH_ATTR HTTPC_vWinRace(HTTPC_tstContext *req);
+static void ICACHE_FLASH_ATTR HTTPC_vLeaveRace(HTTPC_tstContext *req);
+static void ICACHE_FLASH_ATTR HTTPC_vStopHls(void);
+static void ICACHE_FLASH_ATTR HTTPC_vStartHls(HTTPC_tstContext *req);
+static bool ICACHE_FLASH_ATTR HTTPC_bNextSegment(HTTPC_tstContext *req);
+static void ICACHE_FLASH_ATTR HTTPC_vPrefetchSegment(void);
 
 static char* ICACHE_FLASH_ATTR esp_strdup(const char *str)
 {
@@ -61,150 +276,522 @@ static char* ICACHE_FLASH_ATTR esp_strdup(const char *str)
     return new_str;
 }
 
-static int ICACHE_FLASH_ATTR HTTPC_iChunkedDecode(const char *chunked, char *decode)
+static bool ICACHE_FLASH_ATTR HTTPC_bCopyString(char *dest, const char *src, uint16 size)
+{
+    if (src == NULL)
+        src = "";
+    // URLs from server responses might be longer than expected
+    if (os_strlen(src) >= size)
+    {
+        PRINTF("HTTPC: String too long= %s\n", src);
+        return 0;
+    }
+    os_strcpy(dest, src);
+    return 1;
+}
+
+static uint32 ICACHE_FLASH_ATTR HTTPC_u32HashUrl(const char *url)
 {
-    //PRINTF("-----chunked_decode----\r\n");
+    // FNV-1a
+    uint32 hash = 2166136261;
 
-    int i = 0, j = 0;
-    int decode_size = 0;
-    char *str = (char*) chunked;
-    do
+    while (*url != '\0')
     {
-        char *endstr = NULL;
-        //[chunk-size]
-        i = Stdout_s32Strtol(str + j, endstr, 16);
-        //PRINTF("Chunk Size:%d\r\n", i);
-        if (i <= 0)
-            break;
-        //[chunk-size-end-ptr]
-        endstr = (char*) os_strstr(str + j, "\r\n");
-        //[chunk-ext]
-        j += endstr - (str + j);
-        //[CRLF]
-        j += 2;
-        //[chunk-data]
-        decode_size += i;
-        os_memcpy((char*) &decode[decode_size - i], (char*) str + j, i);
-        j += i;
-        //[CRLF]
-        j += 2;
-    } while (true);
+        hash ^= (uint8) *url++;
+        hash *= 16777619;
+    }
+    return hash;
+}
 
-    //
-    //footer CRLF
-    //
+static HTTPC_tstResolveCache* ICACHE_FLASH_ATTR HTTPC_pstFindResolvedUrl(const char *url)
+{
+    uint32 hash = HTTPC_u32HashUrl(url);
+    uint8 i;
 
-    return j;
+    for (i = 0; i < HTTPC_RESOLVE_CACHE_SIZE; i++)
+    {
+        if ((HTTPC_astResolveCache[i].url != NULL) && (HTTPC_astResolveCache[i].hash == hash))
+            return &HTTPC_astResolveCache[i];
+    }
+    return NULL;
 }
 
-static void ICACHE_FLASH_ATTR HTTPC_vSearchMetadata(char *buf, request_args *req, unsigned short header_len)
+static void ICACHE_FLASH_ATTR HTTPC_vDropResolvedUrl(const char *url)
 {
-    char *ptr;
+    HTTPC_tstResolveCache *entry = HTTPC_pstFindResolvedUrl(url);
+
+    if (entry == NULL)
+        return;
+    os_free(entry->url);
+    entry->url = NULL;
+}
+
+static bool ICACHE_FLASH_ATTR HTTPC_bFormatUrl(HTTPC_tstContext *req, char *url, uint32 size)
+{
+    char port[8];
+
+    os_sprintf(port, ":%d", req->port);
+    if (os_strlen("https://") + os_strlen(req->hostname) + os_strlen(port) + os_strlen(req->path) >= size)
+        return 0;
+    os_sprintf(url, "%s%s%s%s", req->secure ? "https://" : "http://", req->hostname, port, req->path);
+    return 1;
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vStoreResolvedUrl(HTTPC_tstContext *req)
+{
+    HTTPC_tstResolveCache *entry;
+    uint32 size;
+
+    HTTPC_vDropResolvedUrl(req->url);
+    // Replace oldest entry
+    entry = &HTTPC_astResolveCache[HTTPC_u8ResolveCacheNext];
+    HTTPC_u8ResolveCacheNext = (HTTPC_u8ResolveCacheNext + 1) % HTTPC_RESOLVE_CACHE_SIZE;
+    if (entry->url != NULL)
+        os_free(entry->url);
+
+    entry->hash = HTTPC_u32HashUrl(req->url);
+    size = os_strlen("https://") + os_strlen(req->hostname) + 8 + os_strlen(req->path);
+    entry->url = (char*) os_malloc(size);
+    if (entry->url == NULL)
+        return;
+    HTTPC_bFormatUrl(req, entry->url, size);
+    PRINTF("HTTPC: Resolved %s to %s\n", req->url, entry->url);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vStartPlayback(HTTPC_tstContext *req)
+{
+    VS1053_vEnableFeeder(1);
+    if (req->playing)
+    {
+        PRINTF("HTTPC: Playback resumed\n");
+        return;
+    }
+    req->playing = 1;
+    HTTPC_u32TimeToFirstAudio = (system_get_time() - req->start_time) / 1000;
+    PRINTF("HTTPC: Playback started after %d ms (%d kbit/s)\n", HTTPC_u32TimeToFirstAudio, req->bitrate);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vCheckPrebuffer(HTTPC_tstContext *req)
+{
+    uint32 threshold;
+
+    if (VS1053_bIsFeederEnabled())
+        return;
+
+    // Calculate amount of data needed for HTTPC_PREBUFFER_MS of audio
+    threshold = ((req->bitrate != 0) ? req->bitrate : HTTPC_DEFAULT_BITRATE) * HTTPC_PREBUFFER_MS / 8;
+    if (threshold > HTTPC_PREBUFFER_MAX_BYTES)
+        threshold = HTTPC_PREBUFFER_MAX_BYTES;
+
+    // Enough data => Start playback
+    if (VS1053_u16GetUsedBufferSize() >= threshold)
+        HTTPC_vStartPlayback(req);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vFlowTimerCallback(void *arg)
+{
+    uint32 written;
 
-    // Search for field "icy-metaint:" in data packet
-    ptr = strstr(buf, "icy-metaint:");
-    // Check if it has been found
-    if (ptr != NULL)
+    // Wait for feeder to drain ring buffer down to low watermark
+    if (VS1053_u16GetUsedBufferSize() > HTTPC_UNHOLD_USED_BYTES)
+        return;
+
+    // Parked data goes first to keep the order of the stream
+    written = VS1053_u32WriteRingBuffer(HTTPC_stFlow.park_buffer, HTTPC_stFlow.park_length);
+    os_memmove(HTTPC_stFlow.park_buffer, &HTTPC_stFlow.park_buffer[written], HTTPC_stFlow.park_length - written);
+    HTTPC_stFlow.park_length -= written;
+    if (HTTPC_stFlow.park_length != 0)
+        return;
+
+    // Everything has been written => Continue receiving
+    os_timer_disarm(&HTTPC_FlowTimerObject);
+    if (HTTPC_stFlow.hold)
+    {
+        HTTPC_stFlow.hold = 0;
+        HTTPC_stFlow.hold_time += (system_get_time() - HTTPC_stFlow.hold_start) / 1000;
+        if (HTTPC_stFlow.conn != NULL)
+            espconn_recv_unhold(HTTPC_stFlow.conn);
+    }
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vHoldReceive(HTTPC_tstContext *req)
+{
+    if (HTTPC_stFlow.hold)
+        return;
+    // Stop receiving data until ring buffer has been drained
+    HTTPC_stFlow.hold = 1;
+    HTTPC_stFlow.hold_start = system_get_time();
+    HTTPC_stFlow.hold_count++;
+    HTTPC_stFlow.conn = req->conn;
+    espconn_recv_hold(req->conn);
+    // Check ring buffer level periodically
+    os_timer_disarm(&HTTPC_FlowTimerObject);
+    os_timer_setfn(&HTTPC_FlowTimerObject, (os_timer_func_t*) HTTPC_vFlowTimerCallback, NULL);
+    os_timer_arm(&HTTPC_FlowTimerObject, HTTPC_FLOW_TIMER_MS, 1);
+}
+
+#ifdef WARM_STANDBY
+static void ICACHE_FLASH_ATTR HTTPC_vFillStandby(HTTPC_tstContext *req, char *buf, uint32 len)
+{
+    uint32 free = HTTPC_STANDBY_BUFFER_SIZE - req->standby_length;
+
+    req->audio_received = 1;
+    req->reconnect_attempts = 0;
+    if (len > free)
+    {
+        // Only happens if the server sends more than one segment after receiving has been stopped
+        len = free;
+        req->discontinuity = 1;
+    }
+    os_memcpy(&req->standby_buffer[req->standby_length], buf, len);
+    req->standby_length += len;
+
+    // Keep the rest of the stream in the TCP window until the station is selected
+    if (!req->held && (HTTPC_STANDBY_BUFFER_SIZE - req->standby_length < HTTPC_HOLD_FREE_BYTES))
+    {
+        req->held = 1;
+        espconn_recv_hold(req->conn);
+    }
+}
+#endif
+
+static void ICACHE_FLASH_ATTR HTTPC_vCompleteFailover(HTTPC_tstContext *req)
+{
+    HTTPC_tstContext *old = HTTPC_pstStream;
+
+    req->failover = 0;
+    HTTPC_pstFailover = NULL;
+    if (req->tier_switch)
     {
-        // Point to field value rather than start of "icy-metaint:"
-        ptr += strlen("icy-metaint:");
-        // Save information for later use
-        req->icycast_info_interval = strtol(ptr, NULL, 0);
-        // Field "icy-metaint:" has been found
-        PRINTF("HTTPC: icy-metaint: is %d\n", req->icycast_info_interval);
+        HTTPC_stTier.switches++;
+        // Trend of new tier is evaluated from scratch
+        HTTPC_stTier.window_time = 0;
+        HTTPC_stTier.window_buffered = HTTPC_u32GetBufferedTime();
+        HTTPC_stTier.headroom_time = 0;
+        PRINTF("HTTPC: Switched to %d kbit/s tier (%s)\n", HTTPC_stStation.bitrate[req->mirror], req->url);
     }
     else
     {
-        // No field "icy-metaint:" found in data packet
-        // Leave icycast_info_interval as it is (should be initialized with zero)
-        PRINTF("HTTPC: icy-metaint: has not been found\n");
+        HTTPC_stWatchdog.failovers++;
+        HTTPC_stWatchdog.failover_time = (system_get_time() - HTTPC_stWatchdog.detect_time) / 1000;
+        if (VS1053_u32GetUnderruns() == HTTPC_stWatchdog.underruns)
+            HTTPC_stWatchdog.avoided++;
+        PRINTF("HTTPC: Switched to %s after %d ms\n", req->url, HTTPC_stWatchdog.failover_time);
+    }
+
+    if (old != NULL)
+    {
+        // Old stream ends at a frame boundary. Data of the new one starts with a complete frame.
+        HTTPC_vDiscontinuity(old);
+        req->playing = old->playing;
+        req->user_callback = old->user_callback;
+        old->user_callback = NULL;
+    }
+    // Ring buffer might be full right now => New connection has to wait as well
+    if (HTTPC_stFlow.hold && (HTTPC_stFlow.conn != req->conn))
+    {
+        HTTPC_stFlow.conn = req->conn;
+        espconn_recv_hold(req->conn);
+    }
+    HTTPC_pstStream = req;
+    if (old != NULL)
+        HTTPC_vCloseRequest(old);
+    HTTPC_vStartWatchdog(req);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vFillBuffer(HTTPC_tstContext *req, char *buf, uint32 len)
+{
+    uint32 written = 0;
+    uint32 park;
+
+#ifdef WARM_STANDBY
+    if (req->standby)
+    {
+        HTTPC_vFillStandby(req, buf, len);
+        return;
+    }
+#endif
+    if (req->racing)
+        HTTPC_vWinRace(req);
+    if (req->failover)
+        HTTPC_vCompleteFailover(req);
+
+    if (req->reconnect_attempts != 0)
+    {
+        // Audio data is flowing again
+        HTTPC_stReconnect.count++;
+        HTTPC_stReconnect.outage_time = (system_get_time() - HTTPC_stReconnect.outage_start) / 1000;
+        if (HTTPC_stReconnect.outage_time > HTTPC_stReconnect.outage_max)
+            HTTPC_stReconnect.outage_max = HTTPC_stReconnect.outage_time;
+        HTTPC_stReconnect.buffered = VS1053_u16GetUsedBufferSize() + HTTPC_stFlow.park_length;
+        PRINTF("HTTPC: Reconnected after %d ms with %d Bytes buffered\n", HTTPC_stReconnect.outage_time, HTTPC_stReconnect.buffered);
+        req->reconnect_attempts = 0;
+        // Ring buffer ran dry during outage => Prebuffer again instead of stuttering
+        if (HTTPC_stReconnect.buffered == 0)
+            VS1053_vEnableFeeder(0);
+    }
+    if (!req->audio_received)
+    {
+        req->audio_received = 1;
+        if (!req->playing)
+        {
+            HTTPC_u32TimeToFirstByte = (system_get_time() - req->start_time) / 1000;
+            HTTPC_bTimeToFirstByteCached = req->from_cache;
+        }
+        // Next start of this station can skip the redirects (HLS segment URLs expire)
+        if ((req->redirects != 0) && !req->hls)
+            HTTPC_vStoreResolvedUrl(req);
+        // Reconnects might be redirected again
+        req->redirects = 0;
+    }
+
+    // Bitrate not given by server => Get it from frame headers
+    if (req->bitrate == 0)
+        req->bitrate = FSYNC_u16GetBitrate(&req->fsync);
+
+    // Fill audio buffer with music data (only if nothing is parked, otherwise the order would change)
+    if (HTTPC_stFlow.park_length == 0)
+        written = VS1053_u32WriteRingBuffer((uint8*) buf, len);
+
+    if (written < len)
+    {
+        // Park the rest until the feeder made some space
+        park = len - written;
+        if (park > HTTPC_PARK_BUFFER_SIZE - HTTPC_stFlow.park_length)
+        {
+            // Only happens if the server sends more than one segment after receiving has been stopped
+            HTTPC_stFlow.dropped_bytes += park - (HTTPC_PARK_BUFFER_SIZE - HTTPC_stFlow.park_length);
+            park = HTTPC_PARK_BUFFER_SIZE - HTTPC_stFlow.park_length;
+            req->discontinuity = 1;
+            PRINTF("HTTPC: VS1053 Ringbuffer full!\n");
+        }
+        os_memcpy(&HTTPC_stFlow.park_buffer[HTTPC_stFlow.park_length], buf + written, park);
+        HTTPC_stFlow.park_length += park;
+    }
+
+    // Apply backpressure to server before the ring buffer overflows
+    if ((HTTPC_stFlow.park_length != 0) || (VS1053_u16GetFreeBufferSize() < HTTPC_HOLD_FREE_BYTES))
+        HTTPC_vHoldReceive(req);
+
+    // Start playback as soon as enough data is available
+    HTTPC_vCheckPrebuffer(req);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vDiscontinuity(HTTPC_tstContext *req)
+{
+    uint32 partial = FSYNC_u32Discontinuity(&req->fsync);
+    uint32 count;
+
+    req->discontinuity = 0;
+    if (req->standby)
+    {
+        // Standby buffer is not played yet => Incomplete frame can always be removed
+        req->standby_length -= (partial < req->standby_length) ? partial : req->standby_length;
+        return;
     }
+
+    // Remove incomplete frame so the decoder does not lose sync. Newest data is in park buffer.
+    count = (partial < HTTPC_stFlow.park_length) ? partial : HTTPC_stFlow.park_length;
+    HTTPC_stFlow.park_length -= count;
+    partial -= count;
+    // Data already sent to VS1053 can't be taken back
+    VS1053_u32TruncateRingBuffer(partial);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vFrameCallback(void *arg, char *data, uint32 len)
+{
+    HTTPC_vFillBuffer((HTTPC_tstContext*) arg, data, len);
 }
 
-static void ICACHE_FLASH_ATTR HTTPC_vTimerCallback(void *arg)
+static void ICACHE_FLASH_ATTR HTTPC_vIcyAudioCallback(void *arg, char *data, uint32 len)
 {
-    // Timer has elapsed. Now we are allowed to buffer music data
-    request_args *req = (request_args*) arg;
-    req->buffer_wait_timer_elapsed = 1;
+    HTTPC_tstContext *req = (HTTPC_tstContext*) arg;
+
+    // Only complete frames are passed to ring buffer
+    if (req->discontinuity)
+        HTTPC_vDiscontinuity(req);
+    FSYNC_vProcess(&req->fsync, data, len);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vDisconnect(HTTPC_tstContext *req, struct espconn *conn)
+{
+    req->closing = 1;
+    // Handle connection differently depending if SSL is used or not
+    if (req->secure)
+        espconn_secure_disconnect(conn);
+    else
+        espconn_disconnect(conn);
+    // The disconnect callback will be called
+}
+
+static bool ICACHE_FLASH_ATTR HTTPC_bIsRedirect(uint16 status)
+{
+    return (status == 301) || (status == 302) || (status == 303) || (status == 307) || (status == 308);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vFollowUrl(HTTPC_tstContext *req, struct espconn *conn, const char *url)
+{
+    if (req->redirects >= HTTPC_REDIRECT_MAX)
+        PRINTF("HTTPC: Too many redirects\n");
+    else
+        req->follow_url = url;
+    // New request is started by disconnect callback
+    HTTPC_vDisconnect(req, conn);
 }
 
-static void ICACHE_FLASH_ATTR HTTPC_vFillBuffer(request_args *req, char *buf, unsigned short len)
+static void ICACHE_FLASH_ATTR HTTPC_vBodyCallback(void *arg, char *data, uint32 len)
 {
-    uint8 result;
+    HTTPC_tstContext *req = (HTTPC_tstContext*) arg;
+
+    // Rest of segment is not needed after disconnect has been requested
+    if (req->closing)
+        return;
 
-    if (req->buffer_wait_timer_elapsed == 0)
+    if (req->body_callbacks.on_data != NULL)
     {
-        // Buffer fill timer not jet elapsed
-        // This is to wait for stable data rate from streaming server before starting to buffer music data
+        // Caller processes body incrementally
+        req->body_callbacks.on_data(req->body_callbacks.arg, data, len);
         return;
     }
 
-    // Fill audio buffer with music data
-    result = VS1053_vFillRingBuffer(buf, len);
-    // Check for success
-    if (result == 0)
+    if (req->hls_playlist)
     {
-        // Ringbuffer has no more free space.
-        // At this point it is unavoidably to lose music data because there is no place to store it...
-        PRINTF("HTTPC: VS1053 Ringbuffer full!\n");
+        // Segment list is complete when the connection is closed
+        HLS_vProcessPlaylist(&HTTPC_stHls.playlist, data, len);
+        return;
+    }
+    if (req->hls)
+    {
+        // Audio frames are extracted from transport stream
+        HLS_vDemux(&HTTPC_stHls.demux, data, len);
+        return;
+    }
+
+    if (req->playlist)
+    {
+        // Playlist is parsed line by line until first stream URL
+        switch (PLAYLIST_enProcess(&req->playlist_parser, data, len))
+        {
+            case PLAYLIST_enResultDone:
+                HTTPC_vFollowUrl(req, req->conn, PLAYLIST_pcGetUrl(&req->playlist_parser));
+                break;
+            case PLAYLIST_enResultError:
+                PRINTF("HTTPC: No stream URL in playlist\n");
+                HTTPC_vDisconnect(req, req->conn);
+                break;
+            default:
+                break;
+        }
+        return;
     }
-    // For transfer rate calculation
-    data_count += len;
+
+    // Audio data is handed over to ring buffer, metadata is extracted
+    ICY_vProcess(&req->icy, data, len);
 }
 
-static void ICACHE_FLASH_ATTR HTTPC_vReceiveCallback(void *arg, char *buf, unsigned short len)
+static bool ICACHE_FLASH_ATTR HTTPC_bLoadHls(HTTPC_tstContext *req)
+{
+    char url[HLS_URL_SIZE];
+
+    // Only one HLS stream at a time (might be loaded by another URL of a race)
+    if ((HTTPC_stHls.owner != NULL) && (HTTPC_stHls.owner != req))
+    {
+        PRINTF("HTTPC: HLS is used by another stream\n");
+        return 0;
+    }
+    // Relative URIs in the playlist refer to its final URL
+    if (!HTTPC_bFormatUrl(req, url, HLS_URL_SIZE) || !HLS_bInit(&HTTPC_stHls.playlist, url))
+    {
+        PRINTF("HTTPC: HLS playlist URL too long\n");
+        return 0;
+    }
+    HTTPC_stHls.owner = req;
+    req->hls_playlist = 1;
+    return 1;
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vProcessReceived(void *arg, char *buf, unsigned short len)
 {
     struct espconn *conn = (struct espconn*) arg;
-    request_args *req = (request_args*) conn->reverse;
-    static uint8 first_message = 1;
+    HTTPC_tstContext *req = (HTTPC_tstContext*) conn->reverse;
+    HTTPH_tenResult result;
+    uint32 consumed;
     char *ptr;
 
     //PRINTF("HTTPC: Data has been received | Size: %d Bytes\n", len);
+    req->received += len;
 
-    if (StopStreaming == 1)
+    if (req->stop)
     {
         // Stream should be stopped. So we directly disconnect and return here.
         PRINTF("HTTPC: Stream should be stopped\n");
-        if (req->secure)
-            espconn_secure_disconnect(conn);
-        else
-            espconn_disconnect(conn);
-        // The disconnect callback will be called
+        HTTPC_vDisconnect(req, conn);
+        return;
+    }
+    if (req->closing)
+    {
+        // Waiting for disconnect callback
         return;
     }
 
     if (req->header_received == 0)
     {
-        // First data received by client
-        // Maybe not the best idea to use specific timer in multi instance application :/
-        os_timer_disarm(&HTTPC_TimerObject);
-        os_timer_setfn(&HTTPC_TimerObject, (os_timer_func_t*) HTTPC_vTimerCallback, req);
-        os_timer_arm(&HTTPC_TimerObject, 2000, 0);
-
-        // Pointer to music data
-        ptr = strstr(buf, "\r\n\r\n");
-        // Check if end of HEADER has been found
-        if (ptr != NULL)
+        // Header might be split over several segments
+        result = HTTPH_enProcess(&req->header, buf, len, &consumed);
+        if (result == HTTPH_enResultMore)
         {
-            // Point to end of header rather than start of "\r\n\r\n"
-            ptr += 4;
-            // Calculate music data length
-            len -= ptr - buf;
-            // Search for ICYCAST metadata in data packet
-            HTTPC_vSearchMetadata(buf, req, ptr - buf);
-            req->music_bytes_until_next_icycast = req->icycast_info_interval;
+            // Wait for rest of header
+            return;
         }
-        else
+        if ((result == HTTPH_enResultDone) && HTTPC_bIsRedirect(req->header.status) && (req->header.location[0] != '\0'))
         {
-            // No HEADER detected? Something went wrong
-            PRINTF("HTTPC: First received data does not contain a HEADER!\n");
-            if (req->secure)
-                espconn_secure_disconnect(conn);
-            else
-                espconn_disconnect(conn);
-            // The disconnect callback will be called
+            // Try again with new location
+            HTTPC_vFollowUrl(req, conn, req->header.location);
+            return;
+        }
+        if ((result == HTTPH_enResultDone) && (req->body_callbacks.on_headers != NULL))
+            req->body_callbacks.on_headers(req->body_callbacks.arg, req->header.status, req->header.content_type);
+        if ((result == HTTPH_enResultError) || (req->header.status != 200))
+        {
+            // Not a valid HTTP response or server did not accept request
+            PRINTF("HTTPC: Invalid response (status %d)\n", req->header.status);
+            HTTPC_vDisconnect(req, conn);
             return;
         }
+        PRINTF("HTTPC: %s %d | Content-Type: %s | icy-metaint: %d | icy-br: %d\n", req->header.icy ? "ICY" : "HTTP", req->header.status, req->header.content_type, req->header.metaint, req->header.bitrate);
+        if (req->hls)
+        {
+            // Segment starts with a new transport stream. Next one is requested while this one is received.
+            HLS_vInitDemux(&HTTPC_stHls.demux, HTTPC_vIcyAudioCallback, req);
+            HTTPC_vPrefetchSegment();
+        }
+        else
+            if ((req->body_callbacks.on_data == NULL) && HLS_bIsPlaylist(req->header.content_type, req->path))
+            {
+                // Body contains segments of stream
+                if (!HTTPC_bLoadHls(req))
+                {
+                    HTTPC_vDisconnect(req, conn);
+                    return;
+                }
+            }
+            else
+                if ((req->body_callbacks.on_data == NULL) && PLAYLIST_bIsPlaylist(req->header.content_type, req->path))
+                {
+                    // Body contains URL of stream
+                    req->playlist = 1;
+                    PLAYLIST_vInit(&req->playlist_parser);
+                }
+        // Body is decoded while it arrives, no matter how large it is
+        if (req->header.chunked)
+            CHUNKED_vInit(&req->chunked, HTTPC_vBodyCallback, req);
+        // Use bitrate given by server for prebuffer calculation
+        req->bitrate = req->header.bitrate;
+        // Separate metadata from audio data
+        ICY_vInit(&req->icy, req->header.metaint, HTTPC_vIcyAudioCallback, req);
+        // Everything behind the header is body
+        ptr = buf + consumed;
+        len -= consumed;
         // Enter only once
         req->header_received = 1;
     }
@@ -214,69 +801,41 @@ static void ICACHE_FLASH_ATTR HTTPC_vReceiveCallback(void *arg, char *buf, unsig
         ptr = buf;
     }
 
-    // Check for ICYCAST Metadata available
-    if (req->icycast_info_interval != 0)
+    if (!req->header.chunked)
     {
-        // The server injects ICYCAST metadata in music stream
-        if (len > req->music_bytes_until_next_icycast)
-        {
-            // This packet contains metadata
-            uint32 mp3_bytes_after_metadata;
-            uint32 mp3_bytes_before_metadata;
-            uint32 metadata_bytes;
-            char *metadata_ptr;
-            char *mp3_after_metadata_ptr;
-
-            // Get location of Metadata
-            metadata_ptr = ptr + (req->music_bytes_until_next_icycast);
-            mp3_bytes_before_metadata = req->music_bytes_until_next_icycast;
-            metadata_bytes = (*metadata_ptr) * 16 + 1;
-            mp3_bytes_after_metadata = len - (req->music_bytes_until_next_icycast) - metadata_bytes;
-            mp3_after_metadata_ptr = metadata_ptr + metadata_bytes;
-
-            // Check for empty Metadata
-            if (*metadata_ptr != 0)
-            {
-                char *buffer = (char*) os_malloc(metadata_bytes);
-                // Check if memory could be allocated
-                if (buffer != NULL)
-                {
-                    // First byte contains length and can be skipped for information
-                    os_memcpy(buffer, metadata_ptr + 1, metadata_bytes - 1);
-                    //Terminate string
-                    buffer[metadata_bytes - 1] = '\0';
-                    // Do something with metadata_pointer and metadata_length
-                    myprintf("HTTPC: %s\n", buffer);
-                    // Free unused buffer
-                    os_free(buffer);
-                }
-            }
-
-            // Send data before metadata to buffer
-            HTTPC_vFillBuffer(req, ptr, mp3_bytes_before_metadata);
-            // Send data after metadata to buffer
-            HTTPC_vFillBuffer(req, mp3_after_metadata_ptr, mp3_bytes_after_metadata);
-            // Calculate position of next metadata
-            req->music_bytes_until_next_icycast = (req->icycast_info_interval) - mp3_bytes_after_metadata;
-        }
-        else
-        {
-            req->music_bytes_until_next_icycast -= len;
-            // All the data is mp3 => Send to buffer
-            HTTPC_vFillBuffer(req, ptr, len);
-        }
+        HTTPC_vBodyCallback(req, ptr, len);
+        return;
     }
-    else
+    switch (CHUNKED_enProcess(&req->chunked, ptr, len))
     {
-        // All the data is mp3 => Send to buffer
-        HTTPC_vFillBuffer(req, ptr, len);
+        case CHUNKED_enResultDone:
+            // Complete body received => No need to wait for server closing the connection
+            if (!req->closing)
+                HTTPC_vDisconnect(req, conn);
+            break;
+        case CHUNKED_enResultError:
+            PRINTF("HTTPC: Invalid chunked encoding\n");
+            if (!req->closing)
+                HTTPC_vDisconnect(req, conn);
+            break;
+        default:
+            break;
     }
 }
 
+static void ICACHE_FLASH_ATTR HTTPC_vReceiveCallback(void *arg, char *buf, unsigned short len)
+{
+    uint32 timestamp = system_get_time();
+
+    // Header parsing, dechunking, demuxing, frame sync and ring buffer writes
+    HTTPC_vProcessReceived(arg, buf, len);
+    HTTPC_u32ReceiveTime += system_get_time() - timestamp;
+}
+
 static void ICACHE_FLASH_ATTR HTTPC_vSentCallback(void *arg)
 {
     struct espconn *conn = (struct espconn*) arg;
-    request_args *req = (request_args*) conn->reverse;
+    HTTPC_tstContext *req = (HTTPC_tstContext*) conn->reverse;
 
     PRINTF("HTTPC: Data has been sent\n");
 
@@ -302,21 +861,44 @@ static void ICACHE_FLASH_ATTR HTTPC_vConnectCallback(void *arg)
 {
 
     struct espconn *conn = (struct espconn*) arg;
-    request_args *req = (request_args*) conn->reverse;
+    HTTPC_tstContext *req = (HTTPC_tstContext*) conn->reverse;
     const char *method = "GET";
     char post_headers[32] = "";
 
     PRINTF("HTTPC: Connected\n");
 
+    if (req->stop)
+    {
+        // Request has been cancelled while connecting
+        HTTPC_vDisconnect(req, conn);
+        return;
+    }
+
     // Configure receive and sent callback
     espconn_regist_recvcb(conn, HTTPC_vReceiveCallback);
     espconn_regist_sentcb(conn, HTTPC_vSentCallback);
 
+    // Ring buffer is still full from before the reconnect => New connection has to wait as well
+    if ((req == HTTPC_pstStream) && HTTPC_stFlow.hold && (HTTPC_stFlow.conn == NULL))
+    {
+        HTTPC_stFlow.conn = conn;
+        espconn_recv_hold(conn);
+    }
+    // Same for standby buffer
+    if (req->standby && req->held)
+        espconn_recv_hold(conn);
+    // Next HLS segment waits in the TCP window until the current one is done
+    if (req->prefetch)
+    {
+        req->held = 1;
+        espconn_recv_hold(conn);
+    }
+
     // If there is data this is a POST request.
     if (req->post_data != NULL)
     {
         method = "POST";
-        os_sprintf(post_headers, "Content-Length: %d\r\n", strlen(req->post_data));
+        os_sprintf(post_headers, "Content-Length: %d\r\n", (int)strlen(req->post_data));
     }
 
     char buf[69 + strlen(method) + strlen(req->path) + strlen(req->hostname) + strlen(req->headers) + strlen(post_headers)];
@@ -338,99 +920,197 @@ static void ICACHE_FLASH_ATTR HTTPC_vConnectCallback(void *arg)
 
 }
 
-static void ICACHE_FLASH_ATTR HTTPC_vDisconnectCallback(void *arg)
+static void ICACHE_FLASH_ATTR HTTPC_vFreeConnection(struct espconn *conn)
 {
-    struct espconn *conn = (struct espconn*) arg;
-    request_args *req = (request_args*) conn->reverse;
-    int http_status = -1;
-    char *body = "";
+    // Disconnect from host. Connection data is part of the context and doesn't need to be freed.
+    espconn_delete(conn);
+}
 
-    PRINTF("HTTPC: Disconnected\n");
-    if (conn == NULL)
-    {
-        // No further information available. Also no data to free here. Strange...
-        return;
-    }
+static bool ICACHE_FLASH_ATTR HTTPC_bRestart(HTTPC_tstContext *req)
+{
+    bool valid;
 
-    if (req != NULL)
-    {
-        const char *version = "HTTP/1.1 ";
+    if (req->stop)
+        return 0;
 
-        // Check for hostname buffer
-        if (req->buffer == NULL)
+    if (req->follow_url != NULL)
+    {
+        // Redirect or playlist
+        PRINTF("HTTPC: Following %s\n", req->follow_url);
+        valid = HTTPC_bSetUrl(req, req->follow_url);
+        req->follow_url = NULL;
+        if (!valid)
+            return 0;
+        req->redirects++;
+    }
+    else
+        if (req->from_cache && !req->audio_received)
         {
-            // No data available
-            PRINTF("HTTPC: Hostname buffer shouldn't be NULL\n");
+            // Station might have moved => Resolve original URL again
+            PRINTF("HTTPC: Resolved URL failed, trying %s\n", req->url);
+            HTTPC_vDropResolvedUrl(req->url);
+            req->from_cache = 0;
+            req->redirects = 0;
+            if (!HTTPC_bSetUrl(req, req->url))
+                return 0;
         }
         else
-            if (req->buffer[0] != '\0')
-            {
-                // Check for HTTP Version
-                if (os_strncmp(req->buffer, version, strlen(version)) != 0)
-                {
-                    PRINTF("HTTPC: Invalid HTTP version= %s\n", req->buffer);
-                }
-                else
-                {
-                    http_status = strtol(req->buffer + strlen(version), NULL, 0);
-                    body = (char*) os_strstr(req->buffer, "\r\n\r\n") + 4;
-                    if (os_strstr(req->buffer, "Transfer-Encoding: chunked"))
-                    {
-                        int body_size = req->buffer_size - (body - req->buffer);
-                        char chunked_decode_buffer[body_size];
-                        os_memset(chunked_decode_buffer, 0, body_size);
-                        // Chunked data
-                        HTTPC_iChunkedDecode(body, chunked_decode_buffer);
-                        os_memcpy(body, chunked_decode_buffer, body_size);
-                    }
-                }
-            }
-
-        // Reset abort variable
-        StopStreaming = 0;
-        SteamStarted = 0;
+            return 0;
 
-        // Callback is optional
-        if (req->user_callback != NULL)
-        {
-            // Call user callback
-            req->user_callback(body, http_status, req->buffer);
-        }
-
-        // Data needs to be freed because it has been allocated before
-        os_free(req->buffer);
-        os_free(req->hostname);
-        os_free(req->path);
-
-        // Data needs to be freed because it has been allocated before
-        if (req->headers != NULL)
-        {
-            os_free(req->headers);
-            req->headers = NULL;
-        }
-
-        // Data needs to be freed because it has been allocated before
-        if (req->post_data != NULL)
-        {
-            os_free(req->post_data);
-            req->post_data = NULL;
-        }
+    // Response of new request is parsed from scratch
+    req->header_received = 0;
+    req->playlist = 0;
+    req->hls_playlist = 0;
+    HTTPH_vInit(&req->header);
+    HTTPC_vResolveHostname(req);
+    return 1;
+}
 
-        os_free(req);
+static void ICACHE_FLASH_ATTR HTTPC_vFinishRequest(HTTPC_tstContext *req, int http_status)
+{
+    os_timer_disarm(&req->reconnect_timer);
+    os_timer_disarm(&req->watchdog_timer);
+    if (HTTPC_pstFailover == req)
+        HTTPC_pstFailover = NULL;
+    if (req->racing)
+        HTTPC_vLeaveRace(req);
+    if (HTTPC_pstStream == req)
+    {
+        // Don't leave a partial frame behind for the next stream
+        HTTPC_vDiscontinuity(req);
+        HTTPC_pstStream = NULL;
     }
-
-    // Disconnect from host
-    espconn_delete(conn);
-
-    if (conn->proto.tcp != NULL)
+    if (HTTPC_pstStandby == req)
+        HTTPC_pstStandby = NULL;
+    if (HTTPC_stHls.prefetch == req)
     {
-        // Data needs to be freed because it has been allocated before
-        os_free(conn->proto.tcp);
-        conn->proto.tcp = NULL;
+        HTTPC_stHls.prefetch = NULL;
+        HTTPC_stHls.skipped++;
     }
+    if (HTTPC_stHls.owner == req)
+        HTTPC_vStopHls();
+
+    // Callback is optional
+    if (req->body_callbacks.on_complete != NULL)
+        req->body_callbacks.on_complete(req->body_callbacks.arg, http_status);
+    if (req->user_callback != NULL)
+    {
+        // Call user callback
+        req->user_callback(http_status);
+    }
+
+    // Data needs to be freed because it has been allocated before
+    if (req->standby_buffer != NULL)
+        os_free(req->standby_buffer);
 
     // Data needs to be freed because it has been allocated before
-    os_free(conn);
+    if (req->post_data != NULL)
+    {
+        os_free(req->post_data);
+        req->post_data = NULL;
+    }
+
+    // Context can be used by next request
+    req->used = 0;
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vReconnectTimerCallback(void *arg)
+{
+    HTTPC_tstContext *req = (HTTPC_tstContext*) arg;
+
+    req->reconnect_pending = 0;
+    PRINTF("HTTPC: Reconnect attempt %d\n", req->reconnect_attempts);
+    HTTPC_vResolveHostname(req);
+}
+
+static bool ICACHE_FLASH_ATTR HTTPC_bScheduleReconnect(HTTPC_tstContext *req)
+{
+    uint32 delay;
+
+    // Only a running stream (or the standby) that has not been stopped by the user is reconnected
+    // HLS segments are not resumed, the next segment continues the stream
+    if (((req != HTTPC_pstStream) && (req != HTTPC_pstStandby)) || req->stop || (req->audio_received == 0) || req->hls)
+        return 0;
+    if (req->reconnect_attempts >= HTTPC_RECONNECT_MAX_ATTEMPTS)
+    {
+        PRINTF("HTTPC: Giving up after %d reconnect attempts\n", req->reconnect_attempts);
+        return 0;
+    }
+    if ((req->reconnect_attempts == 0) && (req == HTTPC_pstStream))
+        HTTPC_stReconnect.outage_start = system_get_time();
+
+    // Exponential backoff. Random part keeps clients that lost their connection at the same time apart.
+    delay = HTTPC_RECONNECT_BASE_MS << req->reconnect_attempts;
+    if (delay > HTTPC_RECONNECT_MAX_MS)
+        delay = HTTPC_RECONNECT_MAX_MS;
+    delay = delay / 2 + os_random() % (delay / 2 + 1);
+    req->reconnect_attempts++;
+    PRINTF("HTTPC: Connection lost, reconnect in %d ms (%d Bytes buffered)\n", delay, VS1053_u16GetUsedBufferSize());
+
+    // Response of new connection is parsed from scratch. Feeder keeps playing the ring buffer meanwhile.
+    req->header_received = 0;
+    HTTPH_vInit(&req->header);
+    HTTPC_vDiscontinuity(req);
+    req->reconnect_pending = 1;
+    os_timer_disarm(&req->reconnect_timer);
+    os_timer_setfn(&req->reconnect_timer, (os_timer_func_t*) HTTPC_vReconnectTimerCallback, req);
+    os_timer_arm(&req->reconnect_timer, delay, 0);
+    return 1;
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vDisconnectCallback(void *arg)
+{
+    struct espconn *conn = (struct espconn*) arg;
+    HTTPC_tstContext *req = (HTTPC_tstContext*) conn->reverse;
+    int http_status = -1;
+
+    PRINTF("HTTPC: Disconnected\n");
+    if (conn == NULL)
+    {
+        // No further information available. Also no data to free here. Strange...
+        return;
+    }
+
+    // Connection is gone. Parked data will still be written to the ring buffer by flow timer.
+    if (HTTPC_stFlow.conn == conn)
+        HTTPC_stFlow.conn = NULL;
+    // Connection data is reused by the next attempt of this request => Release it first
+    HTTPC_vFreeConnection(conn);
+
+    if (req != NULL)
+    {
+        req->conn = NULL;
+
+        // Last line of playlist might not be terminated
+        if (req->playlist && !req->closing && (PLAYLIST_enFinish(&req->playlist_parser) == PLAYLIST_enResultDone))
+        {
+            if (req->redirects >= HTTPC_REDIRECT_MAX)
+                PRINTF("HTTPC: Too many redirects\n");
+            else
+                req->follow_url = PLAYLIST_pcGetUrl(&req->playlist_parser);
+        }
+        // HLS playlist => Continue with variant or first segment
+        // HLS segment is done => Prefetched segment takes over or next one is fetched
+        if (req->hls_playlist && !req->stop)
+            HTTPC_vStartHls(req);
+        else
+            if (req->hls && (req == HTTPC_stHls.owner) && !req->stop && HTTPC_bNextSegment(req))
+                return;
+
+        // Unexpected connection loss of a running stream => Try again later
+        // Redirect, playlist or outdated cache entry => Continue with other URL
+        if (HTTPC_bScheduleReconnect(req) || HTTPC_bRestart(req))
+            return;
+
+        // Status of response (if header has been received)
+        if (req->header.status_received)
+            http_status = req->header.status;
+        // Body has been cut off
+        if (req->header_received && req->header.chunked && !CHUNKED_bIsDone(&req->chunked))
+            http_status = -1;
+
+        HTTPC_vFinishRequest(req, http_status);
+    }
 }
 
 static void ICACHE_FLASH_ATTR HTTPC_vErrorCallback(void *arg, sint8 errType)
@@ -442,7 +1122,7 @@ static void ICACHE_FLASH_ATTR HTTPC_vErrorCallback(void *arg, sint8 errType)
 
 static void ICACHE_FLASH_ATTR HTTPC_vDnsCallback(const char *hostname, ip_addr_t *addr, void *arg)
 {
-    request_args *req = (request_args*) arg;
+    HTTPC_tstContext *req = (HTTPC_tstContext*) arg;
 
     // Check for valid address data
     if (addr == NULL)
@@ -450,30 +1130,37 @@ static void ICACHE_FLASH_ATTR HTTPC_vDnsCallback(const char *hostname, ip_addr_t
         // Invalid hostname or something went wrong
         PRINTF("HTTPC: DNS failed for= %s\n", hostname);
 
-        // Call user callback with invalid arguments
-        if (req->user_callback != NULL)
-        {
-            req->user_callback("", -1, "");
-        }
+        // Lookup might fail as well while network is down => Keep trying
+        if (HTTPC_bScheduleReconnect(req) || HTTPC_bRestart(req))
+            return;
 
-        // Data needs to be freed because it has been allocated before
-        os_free(req);
+        // Call user callback with invalid arguments
+        HTTPC_vFinishRequest(req, -1);
     }
     else
     {
         // Hostname has been resolved
         PRINTF("HTTPC: Hostname (%s) resolved to " IPSTR "\n", hostname, IP2STR(addr));
 
-        // Allocate memory for client connection
-        struct espconn *conn = (struct espconn*) os_malloc(sizeof(struct espconn));
+        if (req->stop)
+        {
+            // Request has been cancelled while waiting for DNS
+            HTTPC_vFinishRequest(req, -1);
+            return;
+        }
+
+        // Client connection is part of the context
+        struct espconn *conn = &req->espconn;
 
         // Prepare client connection (use req for hostname information)
         conn->type = ESPCONN_TCP;
         conn->state = ESPCONN_NONE;
-        conn->proto.tcp = (esp_tcp*) os_malloc(sizeof(esp_tcp));
+        conn->proto.tcp = &req->tcp;
         conn->proto.tcp->local_port = espconn_port();
         conn->proto.tcp->remote_port = req->port;
         conn->reverse = req;
+        req->conn = conn;
+        req->closing = 0;
 
         os_memcpy(conn->proto.tcp->remote_ip, addr, 4);
 
@@ -496,30 +1183,77 @@ static void ICACHE_FLASH_ATTR HTTPC_vDnsCallback(const char *hostname, ip_addr_t
     }
 }
 
-static void ICACHE_FLASH_ATTR HTTPC_vPrepareRequest(const char *hostname, int port, bool secure, const char *path, const char *post_data, const char *headers, http_callback user_callback)
+static HTTPC_tstContext* ICACHE_FLASH_ATTR HTTPC_pstPrepareRequest(const char *hostname, int port, bool secure, const char *path, const char *post_data, const char *headers, http_callback user_callback)
 {
-    request_args *req = (request_args*) os_malloc(sizeof(request_args));
-    req->hostname = esp_strdup(hostname);
-    req->path = esp_strdup(path);
+    HTTPC_tstContext *req = NULL;
+    uint8 i;
+
+    // Number of concurrent requests is limited by the preallocated contexts
+    for (i = 0; i < HTTPC_CONTEXT_COUNT; i++)
+    {
+        if (!HTTPC_astContext[i].used)
+        {
+            req = &HTTPC_astContext[i];
+            break;
+        }
+    }
+    if (req == NULL)
+    {
+        PRINTF("HTTPC: No free context for %s\n", hostname);
+        return NULL;
+    }
+    if (!HTTPC_bCopyString(req->hostname, hostname, HTTPC_HOSTNAME_SIZE) || !HTTPC_bCopyString(req->path, path, HTTPC_PATH_SIZE) || !HTTPC_bCopyString(req->headers, headers, HTTPC_HEADERS_SIZE))
+        return NULL;
+    req->used = 1;
     req->port = port;
     req->secure = secure;
-    req->headers = esp_strdup(headers);
     req->post_data = esp_strdup(post_data);
-    req->buffer_size = 1;
-    req->buffer = (char*) os_malloc(1);
-    req->buffer[0] = '\0'; // Empty string.
     req->user_callback = user_callback;
+    os_memset(&req->body_callbacks, 0, sizeof(req->body_callbacks));
     req->header_received = 0;
-    req->music_bytes_until_next_icycast = 0;
-    req->icycast_info_interval = 0;
-    req->buffer_wait_timer_elapsed = 0;
+    req->closing = 0;
+    HTTPH_vInit(&req->header);
+    req->bitrate = 0;
+    req->start_time = system_get_time();
+    req->conn = NULL;
+    req->playing = 0;
+    req->audio_received = 0;
+    req->discontinuity = 0;
+    FSYNC_vInit(&req->fsync, HTTPC_vFrameCallback, req);
+    req->url[0] = '\0';
+    req->from_cache = 0;
+    req->playlist = 0;
+    req->redirects = 0;
+    req->follow_url = NULL;
+    req->stop = 0;
+    req->standby = 0;
+    req->held = 0;
+    req->standby_length = 0;
+    req->standby_buffer = NULL;
+    req->reconnect_pending = 0;
+    req->reconnect_attempts = 0;
+    req->received = 0;
+    req->mirror = 0;
+    req->failover = 0;
+    req->tier_switch = 0;
+    req->racing = 0;
+    req->hls_playlist = 0;
+    req->hls = 0;
+    req->prefetch = 0;
+    os_timer_disarm(&req->reconnect_timer);
+    os_timer_disarm(&req->watchdog_timer);
+    return req;
+}
 
+static void ICACHE_FLASH_ATTR HTTPC_vResolveHostname(HTTPC_tstContext *req)
+{
+    const char *hostname = req->hostname;
     ip_addr_t addr;
 
     PRINTF("HTTPC: Resolve hostname using DNS\n");
 
     // It seems we don't need a real espconn pointer here.
-    err_t error = espconn_gethostbyname((struct espconn*) req, hostname, &addr, HTTPC_vDnsCallback);
+    err_t error = DNS_s8GetHostByName((struct espconn*) req, hostname, &addr, HTTPC_vDnsCallback);
 
     switch (error)
     {
@@ -544,92 +1278,1120 @@ static void ICACHE_FLASH_ATTR HTTPC_vPrepareRequest(const char *hostname, int po
     }
 }
 
-static void ICACHE_FLASH_ATTR HTTPC_vSendPost(const char *url, const char *post_data, const char *headers, http_callback user_callback)
+static bool ICACHE_FLASH_ATTR HTTPC_bParseUrl(const char *url, char *hostname, int *port, bool *secure, const char **path)
 {
-    char hostname[128] = "";
-    int port;
-    bool secure;
-
     if (os_strncmp(url, "http://", strlen("http://")) == 0)
     {
-        port = 80;
-        secure = false;
+        *port = 80;
+        *secure = false;
         // Get rid of the protocol.
         url += strlen("http://");
     }
     else
         if (os_strncmp(url, "https://", strlen("https://")) == 0)
         {
-            port = 443;
-            secure = true;
+            *port = 443;
+            *secure = true;
             // Get rid of the protocol.
             url += strlen("https://");
         }
         else
         {
             PRINTF("HTTPC: URL is not HTTP or HTTPS= %s\n", url);
-            return;
+            return 0;
         }
 
     // find first occurrence of '/' and returns a pointer on it
-    char *path = os_strchr(url, '/');
+    *path = os_strchr(url, '/');
     // No path character found?
-    if (path == NULL)
+    if (*path == NULL)
     {
         // Set pointer to end of string
-        path = os_strchr(url, '\0');
+        *path = os_strchr(url, '\0');
     }
 
     // find first occurrence of ':' and returns a pointer on it
     char *colon = os_strchr(url, ':');
+    // Colon behind first '/' is part of the path
+    if ((colon != NULL) && (colon > *path))
+        colon = NULL;
     // No colon character found?
     if (colon == NULL)
-    {
-        // The port is not present. URL is contains hostname + path
-        os_memcpy(hostname, url, path - url);
-        // Terminate string
-        hostname[path - url] = '\0';
-    }
-    // Colon character found
+        colon = (char*) *path;
     else
     {
         // colon points on port number
-        port = strtol(colon + 1, NULL, 0);
+        *port = strtol(colon + 1, NULL, 0);
         // Check if port was correctly specified
-        if (port == 0)
+        if (*port == 0)
         {
             PRINTF("HTTPC: Port error= %s\n", url);
-            return;
+            return 0;
         }
+    }
 
-        // The port is present. URL contains hostname + colon
-        os_memcpy(hostname, url, colon - url);
-        // Terminate string
-        hostname[colon - url] = '\0';
+    // URLs from server responses might be longer than expected
+    if (colon - url >= HTTPC_HOSTNAME_SIZE)
+    {
+        PRINTF("HTTPC: Hostname too long= %s\n", url);
+        return 0;
     }
+    // Hostname ends at colon or path
+    os_memcpy(hostname, url, colon - url);
+    // Terminate string
+    hostname[colon - url] = '\0';
 
     // Empty 'path' is not allowed
-    if (path[0] == '\0')
-        path = "/";
+    if ((*path)[0] == '\0')
+        *path = "/";
 
     // Some debug output
-    PRINTF("HTTPC: hostname=%s | port=%d | path=%s\n", hostname, port, path);
+    PRINTF("HTTPC: hostname=%s | port=%d | path=%s\n", hostname, *port, *path);
+    return 1;
+}
+
+static bool ICACHE_FLASH_ATTR HTTPC_bSetUrl(HTTPC_tstContext *req, const char *url)
+{
+    char hostname[HTTPC_HOSTNAME_SIZE];
+    const char *path;
+    int port;
+    bool secure;
+
+    if (url[0] == '/')
+    {
+        // Relative location => Same server
+        return HTTPC_bCopyString(req->path, url, HTTPC_PATH_SIZE);
+    }
+    if (!HTTPC_bParseUrl(url, hostname, &port, &secure, &path) || !HTTPC_bCopyString(req->path, path, HTTPC_PATH_SIZE))
+        return 0;
+    os_strcpy(req->hostname, hostname);
+    req->port = port;
+    req->secure = secure;
+    return 1;
+}
+
+static HTTPC_tstContext* ICACHE_FLASH_ATTR HTTPC_pstPrepareUrl(const char *url, const char *post_data, const char *headers, http_callback user_callback)
+{
+    char hostname[HTTPC_HOSTNAME_SIZE];
+    const char *path;
+    int port;
+    bool secure;
+
+    if (!HTTPC_bParseUrl(url, hostname, &port, &secure, &path))
+        return NULL;
 
     // Create request based on url data
-    HTTPC_vPrepareRequest(hostname, port, secure, path, post_data, headers, user_callback);
+    return HTTPC_pstPrepareRequest(hostname, port, secure, path, post_data, headers, user_callback);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vResetFlow(void)
+{
+    // Forget about flow control state of previous stream
+    os_timer_disarm(&HTTPC_FlowTimerObject);
+    if (HTTPC_stFlow.hold)
+        HTTPC_stFlow.hold_time += (system_get_time() - HTTPC_stFlow.hold_start) / 1000;
+    HTTPC_stFlow.hold = 0;
+    HTTPC_stFlow.conn = NULL;
+    HTTPC_stFlow.park_length = 0;
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vCloseRequest(HTTPC_tstContext *req)
+{
+    req->stop = 1;
+    if (HTTPC_pstStream == req)
+        HTTPC_pstStream = NULL;
+    if (HTTPC_pstStandby == req)
+        HTTPC_pstStandby = NULL;
+    if (HTTPC_pstFailover == req)
+        HTTPC_pstFailover = NULL;
+
+    if (req->conn != NULL)
+    {
+        // Disconnect callback frees request
+        HTTPC_vDisconnect(req, req->conn);
+    }
+    else
+        if (req->reconnect_pending || (HTTPC_stHls.idle && (req == HTTPC_stHls.owner)))
+        {
+            // No connection while waiting for reconnect or next HLS segment => End request right away
+            HTTPC_vFinishRequest(req, -1);
+        }
+    // Otherwise DNS lookup is running. Request is ended by DNS callback.
+}
+
+static HTTPC_tstContext* ICACHE_FLASH_ATTR HTTPC_pstPrepareStream(uint8 mirror, const char *headers, http_callback user_callback)
+{
+    const char *url = HTTPC_stStation.url[mirror];
+    HTTPC_tstResolveCache *entry;
+    HTTPC_tstContext *req;
+
+    // Station has been played before => Skip redirects and playlist
+    entry = HTTPC_pstFindResolvedUrl(url);
+    // Open stream by sending GET
+    if (entry != NULL)
+        req = HTTPC_pstPrepareUrl(entry->url, NULL, headers, user_callback);
+    else
+        req = HTTPC_pstPrepareUrl(url, NULL, headers, user_callback);
+    if (req == NULL)
+        return NULL;
+    if (!HTTPC_bCopyString(req->url, url, HTTPC_URL_SIZE))
+    {
+        HTTPC_vFinishRequest(req, -1);
+        return NULL;
+    }
+    req->from_cache = (entry != NULL);
+    req->mirror = mirror;
+    return req;
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vStopHls(void)
+{
+    HTTPC_tstContext *req;
+
+    os_timer_disarm(&HTTPC_stHls.update_timer);
+    HTTPC_stHls.active = 0;
+    HTTPC_stHls.idle = 0;
+    HTTPC_stHls.owner = NULL;
+    req = HTTPC_stHls.prefetch;
+    HTTPC_stHls.prefetch = NULL;
+    if (req != NULL)
+        HTTPC_vCloseRequest(req);
+    req = HTTPC_stHls.update;
+    HTTPC_stHls.update = NULL;
+    if (req != NULL)
+        HTTPC_vCloseRequest(req);
+}
+
+static bool ICACHE_FLASH_ATTR HTTPC_bRestartSegment(HTTPC_tstContext *req)
+{
+    const char *url;
+
+    while ((url = HLS_pcGetSegment(&HTTPC_stHls.playlist)) != NULL)
+    {
+        // URL is copied by restart before the queue changes again
+        req->follow_url = url;
+        req->redirects = 0;
+        HLS_vDropSegment(&HTTPC_stHls.playlist);
+        if (HTTPC_bRestart(req))
+            return 1;
+        HTTPC_stHls.skipped++;
+    }
+    return 0;
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vPrefetchSegment(void)
+{
+    HTTPC_tstContext *req;
+    const char *url;
+
+    if (!HTTPC_stHls.active || HTTPC_stHls.idle || (HTTPC_stHls.prefetch != NULL))
+        return;
+    url = HLS_pcGetSegment(&HTTPC_stHls.playlist);
+    if (url == NULL)
+        return;
+    // No free context => Segment stays queued and is tried again later
+    req = HTTPC_pstPrepareUrl(url, NULL, HTTPC_stHls.headers, NULL);
+    if (req == NULL)
+        return;
+    HLS_vDropSegment(&HTTPC_stHls.playlist);
+    req->hls = 1;
+    req->prefetch = 1;
+    HTTPC_stHls.prefetch = req;
+    HTTPC_vResolveHostname(req);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vTakeOverSegment(HTTPC_tstContext *next, HTTPC_tstContext *old)
+{
+    next->prefetch = 0;
+    next->playing = old->playing;
+    next->mirror = old->mirror;
+    os_strcpy(next->url, old->url);
+    next->user_callback = old->user_callback;
+    old->user_callback = NULL;
+    HTTPC_stHls.owner = next;
+    if (HTTPC_pstStream == old)
+    {
+        HTTPC_pstStream = next;
+        HTTPC_vStartWatchdog(next);
+    }
+    if (next->held)
+    {
+        // Ring buffer might be full right now => Connection stays on hold until it has been drained
+        next->held = 0;
+        if (HTTPC_stFlow.hold)
+            HTTPC_stFlow.conn = next->conn;
+        else
+            espconn_recv_unhold(next->conn);
+    }
+    // Otherwise still connecting => Connect callback applies flow control of the stream
+    HTTPC_vPrefetchSegment();
+}
+
+static bool ICACHE_FLASH_ATTR HTTPC_bNextSegment(HTTPC_tstContext *req)
+{
+    HTTPC_tstContext *next = HTTPC_stHls.prefetch;
+
+    if (req->header.status == 200)
+        HTTPC_stHls.segments++;
+    else
+        HTTPC_stHls.skipped++;
+    // Next segment starts with a complete frame
+    HTTPC_vDiscontinuity(req);
+
+    if (next != NULL)
+    {
+        // Request of finished segment ends now
+        HTTPC_stHls.prefetch = NULL;
+        HTTPC_vTakeOverSegment(next, req);
+        return 0;
+    }
+    if (HTTPC_stHls.playlist.endlist && (HLS_pcGetSegment(&HTTPC_stHls.playlist) == NULL))
+    {
+        // Request ends with status of last segment
+        PRINTF("HTTPC: End of HLS stream\n");
+        HTTPC_vStopHls();
+        return 0;
+    }
+    // No prefetch (queue was empty or prefetch failed) => Same context fetches next segment
+    if (HTTPC_bRestartSegment(req))
+        return 1;
+    // Live edge reached => Playlist update continues
+    PRINTF("HTTPC: Waiting for next HLS segment\n");
+    HTTPC_stHls.idle = 1;
+    return 1;
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vUpdateDataCallback(void *arg, char *data, uint32 len)
+{
+    // Update might end after a station switch
+    if (arg == HTTPC_stHls.update)
+        HLS_vProcessPlaylist(&HTTPC_stHls.playlist, data, len);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vUpdateCompleteCallback(void *arg, int http_status)
+{
+    HTTPC_tstContext *req = HTTPC_stHls.owner;
+
+    if (arg != HTTPC_stHls.update)
+        return;
+    HTTPC_stHls.update = NULL;
+    if (http_status != 200)
+        PRINTF("HTTPC: HLS playlist update failed (status %d)\n", http_status);
+    // New segments are queued
+    HLS_vFinishPlaylist(&HTTPC_stHls.playlist);
+    if (HTTPC_stHls.playlist.endlist)
+        os_timer_disarm(&HTTPC_stHls.update_timer);
+
+    if (!HTTPC_stHls.idle)
+    {
+        HTTPC_vPrefetchSegment();
+        return;
+    }
+    HTTPC_stHls.idle = 0;
+    if (HTTPC_bRestartSegment(req))
+        return;
+    if (!HTTPC_stHls.playlist.endlist)
+    {
+        HTTPC_stHls.idle = 1;
+        return;
+    }
+    PRINTF("HTTPC: End of HLS stream\n");
+    HTTPC_vStopHls();
+    HTTPC_vFinishRequest(req, req->header.status);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vUpdateTimerCallback(void *arg)
+{
+    HTTPC_tstContext *req;
+
+    // Previous update is still running
+    if (HTTPC_stHls.update != NULL)
+        return;
+    req = HTTPC_pstPrepareUrl(HTTPC_stHls.playlist.base, NULL, HTTPC_stHls.headers, NULL);
+    if (req == NULL)
+        return;
+    req->body_callbacks.on_data = HTTPC_vUpdateDataCallback;
+    req->body_callbacks.on_complete = HTTPC_vUpdateCompleteCallback;
+    req->body_callbacks.arg = req;
+    HTTPC_stHls.update = req;
+    HLS_vBeginPlaylist(&HTTPC_stHls.playlist);
+    HTTPC_vResolveHostname(req);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vStartHls(HTTPC_tstContext *req)
+{
+    const char *url;
+
+    req->hls_playlist = 0;
+    HLS_vFinishPlaylist(&HTTPC_stHls.playlist);
+    if (req->redirects >= HTTPC_REDIRECT_MAX)
+    {
+        PRINTF("HTTPC: Too many redirects\n");
+        return;
+    }
+    if (HTTPC_stHls.playlist.master)
+    {
+        // Master playlist => Media playlist of first variant is loaded next
+        req->follow_url = HTTPC_stHls.playlist.variant;
+        return;
+    }
+    url = HLS_pcGetSegment(&HTTPC_stHls.playlist);
+    if (url == NULL)
+    {
+        PRINTF("HTTPC: No segments in HLS playlist\n");
+        return;
+    }
+
+    // Same context fetches the first segment (URL is copied by restart before the queue changes again)
+    PRINTF("HTTPC: HLS stream with %d s segments\n", HTTPC_stHls.playlist.target_duration);
+    req->follow_url = url;
+    HLS_vDropSegment(&HTTPC_stHls.playlist);
+    req->hls = 1;
+    req->from_cache = 0;
+    HTTPC_stHls.active = 1;
+    HTTPC_stHls.idle = 0;
+    HTTPC_stHls.segments = 0;
+    HTTPC_stHls.skipped = 0;
+    HTTPC_stHls.demux.discarded = 0;
+    os_strcpy(HTTPC_stHls.headers, req->headers);
+
+    // Live playlist gets new segments all the time
+    os_timer_disarm(&HTTPC_stHls.update_timer);
+    if (!HTTPC_stHls.playlist.endlist)
+    {
+        os_timer_setfn(&HTTPC_stHls.update_timer, (os_timer_func_t*) HTTPC_vUpdateTimerCallback, NULL);
+        os_timer_arm(&HTTPC_stHls.update_timer, HLS_u32GetUpdateInterval(&HTTPC_stHls.playlist), 1);
+    }
+}
+
+static uint8 ICACHE_FLASH_ATTR HTTPC_u8NextUrl(uint8 mirror)
+{
+    uint8 next;
+    uint8 i;
+
+    // Next URL of same tier (same one again if there is no alternate)
+    for (i = 1; i < HTTPC_stStation.count; i++)
+    {
+        next = (mirror + i) % HTTPC_stStation.count;
+        if (HTTPC_stStation.bitrate[next] == HTTPC_stStation.bitrate[mirror])
+            return next;
+    }
+    return mirror;
+}
+
+static uint8 ICACHE_FLASH_ATTR HTTPC_u8TierUrlCount(uint8 mirror)
+{
+    uint8 count = 0;
+    uint8 i;
+
+    for (i = 0; i < HTTPC_stStation.count; i++)
+    {
+        if (HTTPC_stStation.bitrate[i] == HTTPC_stStation.bitrate[mirror])
+            count++;
+    }
+    return count;
+}
+
+static sint8 ICACHE_FLASH_ATTR HTTPC_s8TierUrl(uint16 bitrate, bool up)
+{
+    sint8 found = -1;
+    uint16 tier;
+    uint8 i;
+
+    // First URL of next lower or higher tier (-1 if there is none)
+    for (i = 0; i < HTTPC_stStation.count; i++)
+    {
+        tier = HTTPC_stStation.bitrate[i];
+        if ((tier == 0) || (up ? (tier <= bitrate) : (tier >= bitrate)))
+            continue;
+        if ((found < 0) || (up ? (tier < HTTPC_stStation.bitrate[found]) : (tier > HTTPC_stStation.bitrate[found])))
+            found = i;
+    }
+    return found;
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vStartFailover(HTTPC_tstContext *stream, uint8 mirror, bool tier_switch)
+{
+    HTTPC_tstContext *req;
+
+    // User callback is taken over together with the stream
+    req = HTTPC_pstPrepareStream(mirror, stream->headers, NULL);
+    if (req == NULL)
+        return;
+    req->failover = 1;
+    req->tier_switch = tier_switch;
+    HTTPC_pstFailover = req;
+    HTTPC_vResolveHostname(req);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vResetTier(void)
+{
+    HTTPC_stTier.goodput = 0;
+    HTTPC_stTier.window_time = 0;
+    HTTPC_stTier.window_buffered = 0;
+    HTTPC_stTier.headroom_time = 0;
+    HTTPC_stTier.hold_count = HTTPC_stFlow.hold_count;
+    HTTPC_stTier.hold_age = 0;
+    HTTPC_stTier.up_delay = HTTPC_TIER_UP_MS;
+}
+
+static bool ICACHE_FLASH_ATTR HTTPC_bCheckTier(HTTPC_tstContext *req, uint32 received)
+{
+    uint16 bitrate = HTTPC_stStation.bitrate[req->mirror];
+    uint32 buffered = HTTPC_u32GetBufferedTime();
+    bool falling;
+    sint8 mirror;
+
+    // Station without tiers
+    if (bitrate == 0)
+        return 0;
+
+    // Inbound rate says nothing about the link while receiving is on hold
+    if (!HTTPC_stFlow.hold)
+        HTTPC_stTier.goodput = (7 * HTTPC_stTier.goodput + received * (1000 / HTTPC_WATCHDOG_MS)) / 8;
+
+    // Link fills the ring buffer up to flow control level again and again => Room for a higher tier
+    if (HTTPC_stFlow.hold_count != HTTPC_stTier.hold_count)
+    {
+        HTTPC_stTier.hold_count = HTTPC_stFlow.hold_count;
+        HTTPC_stTier.hold_age = 0;
+    }
+    else
+        HTTPC_stTier.hold_age += HTTPC_WATCHDOG_MS;
+    if ((HTTPC_stTier.hold_age <= HTTPC_TIER_WINDOW_MS) && (VS1053_u16GetUsedBufferSize() + HTTPC_stFlow.park_length >= HTTPC_UNHOLD_USED_BYTES))
+        HTTPC_stTier.headroom_time += HTTPC_WATCHDOG_MS;
+    else
+        HTTPC_stTier.headroom_time = 0;
+
+    if (HTTPC_pstFailover != NULL)
+        return 0;
+
+    HTTPC_stTier.window_time += HTTPC_WATCHDOG_MS;
+    if (HTTPC_stTier.window_time >= HTTPC_TIER_WINDOW_MS)
+    {
+        // Buffer is shrinking and link is slower than the stream (kbit/s * 125 = Byte/s)
+        falling = (buffered + HTTPC_TIER_TREND_MS < HTTPC_stTier.window_buffered) && (HTTPC_stTier.goodput < bitrate * 125);
+        HTTPC_stTier.window_time = 0;
+        HTTPC_stTier.window_buffered = buffered;
+        mirror = HTTPC_s8TierUrl(bitrate, 0);
+        if (falling && (mirror >= 0))
+        {
+            PRINTF("HTTPC: Goodput %d Byte/s too low for %d kbit/s, switching to %d kbit/s\n", HTTPC_stTier.goodput, bitrate, HTTPC_stStation.bitrate[mirror]);
+            // Higher tier is tried less often after each drop
+            if (HTTPC_stTier.up_delay < HTTPC_TIER_UP_MAX_MS)
+                HTTPC_stTier.up_delay *= 2;
+            HTTPC_vStartFailover(req, mirror, 1);
+            return 1;
+        }
+    }
+
+    if (HTTPC_stTier.headroom_time >= HTTPC_stTier.up_delay)
+    {
+        HTTPC_stTier.headroom_time = 0;
+        mirror = HTTPC_s8TierUrl(bitrate, 1);
+        if (mirror >= 0)
+        {
+            PRINTF("HTTPC: Buffer kept filled for %d s, switching to %d kbit/s\n", HTTPC_stTier.up_delay / 1000, HTTPC_stStation.bitrate[mirror]);
+            HTTPC_vStartFailover(req, mirror, 1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static uint32 ICACHE_FLASH_ATTR HTTPC_u32GetFailoverMargin(uint32 expected)
+{
+    // Playing time of a full ring buffer (expected: Bytes per watchdog interval)
+    uint32 margin = VS1053_BUFFER_SIZE * HTTPC_WATCHDOG_MS / expected * HTTPC_FAILOVER_MARGIN_PERCENT / 100;
+
+    // Low bitrates: Connection setup time is enough
+    if (margin > HTTPC_FAILOVER_MARGIN_MS)
+        margin = HTTPC_FAILOVER_MARGIN_MS;
+    return margin;
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vWatchdogTimerCallback(void *arg)
+{
+    HTTPC_tstContext *req = (HTTPC_tstContext*) arg;
+    uint32 received = req->received - req->watchdog_received;
+    uint32 expected;
+    uint32 left;
+    uint8 mirror;
+
+    req->watchdog_received = req->received;
+
+    // Only a playing stream can stall. HLS has gaps between segments by design. Reconnect is on the way already.
+    if ((req != HTTPC_pstStream) || !req->playing || (HTTPC_stStation.count == 0) || req->hls || req->reconnect_pending)
+    {
+        req->stall_time = 0;
+        return;
+    }
+    // Link can't sustain the bitrate or has room for more
+    if (HTTPC_bCheckTier(req, received))
+        return;
+    // Receiving might be on hold because the ring buffer is full
+    if (HTTPC_stFlow.hold)
+    {
+        req->stall_time = 0;
+        return;
+    }
+
+    // Bytes needed per interval to keep up with playback
+    expected = ((req->bitrate != 0) ? req->bitrate : HTTPC_DEFAULT_BITRATE) * HTTPC_WATCHDOG_MS / 8;
+    if (received >= expected)
+    {
+        req->stall_time = 0;
+        return;
+    }
+    req->stall_time += HTTPC_WATCHDOG_MS;
+
+    // Short dips are normal. Alternate might be connecting already.
+    if ((req->stall_time < HTTPC_WATCHDOG_STALL_MS) || (HTTPC_pstFailover != NULL))
+        return;
+
+    // Ring buffer shrinks by the missing bytes every interval => Time until it runs dry
+    left = HTTPC_u32GetBufferedTime() * expected / (expected - received);
+    if (left > HTTPC_u32GetFailoverMargin(expected))
+        return;
+
+    HTTPC_stWatchdog.stalls++;
+    HTTPC_stWatchdog.detect_time = system_get_time();
+    HTTPC_stWatchdog.underruns = VS1053_u32GetUnderruns();
+    req->stall_time = 0;
+    mirror = HTTPC_u8NextUrl(req->mirror);
+    PRINTF("HTTPC: Stream stalled (%d ms buffered), trying %s\n", HTTPC_u32GetBufferedTime(), HTTPC_stStation.url[mirror]);
+    HTTPC_vStartFailover(req, mirror, 0);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vStartWatchdog(HTTPC_tstContext *req)
+{
+    req->watchdog_received = req->received;
+    req->stall_time = 0;
+    os_timer_disarm(&req->watchdog_timer);
+    os_timer_setfn(&req->watchdog_timer, (os_timer_func_t*) HTTPC_vWatchdogTimerCallback, req);
+    os_timer_arm(&req->watchdog_timer, HTTPC_WATCHDOG_MS, 1);
+}
+
+#ifdef WARM_STANDBY
+static void ICACHE_FLASH_ATTR HTTPC_vMakeStandby(HTTPC_tstContext *req)
+{
+    // Only one standby connection
+    if (HTTPC_pstStandby != NULL)
+        HTTPC_vCloseRequest(HTTPC_pstStandby);
+
+    req->standby_buffer = (uint8*) os_malloc(HTTPC_STANDBY_BUFFER_SIZE);
+    if (req->standby_buffer == NULL)
+    {
+        HTTPC_vCloseRequest(req);
+        return;
+    }
+    PRINTF("HTTPC: Keeping %s as standby\n", req->url);
+    // Receiving might be on hold because ring buffer was full
+    req->held = HTTPC_stFlow.hold && (req->conn != NULL) && (HTTPC_stFlow.conn == req->conn);
+    HTTPC_vResetFlow();
+    // Standby buffer has to start with a complete frame
+    FSYNC_u32Discontinuity(&req->fsync);
+    req->discontinuity = 0;
+    req->standby = 1;
+    req->standby_length = 0;
+    HTTPC_pstStream = NULL;
+    HTTPC_pstStandby = req;
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vPromoteStandby(HTTPC_tstContext *req, uint32 start_time)
+{
+    PRINTF("HTTPC: Switching to standby %s (%d Bytes buffered)\n", req->url, req->standby_length);
+    HTTPC_pstStream = req;
+    req->standby = 0;
+    req->start_time = start_time;
+    req->playing = 0;
+    HTTPC_bTimeToFirstAudioStandby = 1;
+
+    // Buffered data goes to ring buffer. It always fits because the ring buffer has been flushed.
+    VS1053_u32WriteRingBuffer(req->standby_buffer, req->standby_length);
+    if (req->standby_length >= HTTPC_STANDBY_START_BYTES)
+        HTTPC_vStartPlayback(req);
+    else
+        HTTPC_vCheckPrebuffer(req);
+    os_free(req->standby_buffer);
+    req->standby_buffer = NULL;
+    req->standby_length = 0;
+
+    // Continue receiving
+    if (req->held)
+    {
+        req->held = 0;
+        if (req->conn != NULL)
+            espconn_recv_unhold(req->conn);
+    }
+}
+#endif
+
+static HTTPC_tstMirrorCache* ICACHE_FLASH_ATTR HTTPC_pstFindMirror(uint32 hash)
+{
+    uint8 i;
+
+    for (i = 0; i < HTTPC_MIRROR_CACHE_SIZE; i++)
+    {
+        if ((HTTPC_astMirrorCache[i].hash == hash) && (HTTPC_astMirrorCache[i].startup_time != 0))
+            return &HTTPC_astMirrorCache[i];
+    }
+    return NULL;
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vStartRacer(void)
+{
+    HTTPC_tstContext *req;
+    uint8 mirror;
+    uint8 i;
+    uint8 k;
+
+    for (i = 0; i < HTTPC_RACE_COUNT; i++)
+    {
+        if (HTTPC_stRace.racer[i] == NULL)
+            break;
+    }
+    if ((i == HTTPC_RACE_COUNT) || (HTTPC_stRace.started >= HTTPC_stRace.count))
+        return;
+
+    // URLs of the tier are started in order, beginning with the winner of the last race
+    mirror = HTTPC_stRace.first;
+    for (k = 0; k < HTTPC_stRace.started; k++)
+        mirror = HTTPC_u8NextUrl(mirror);
+    req = HTTPC_pstPrepareStream(mirror, HTTPC_stRace.headers, NULL);
+    HTTPC_stRace.started++;
+    if (req == NULL)
+        return;
+    PRINTF("HTTPC: Racing %s\n", req->url);
+    req->racing = 1;
+    req->start_time = HTTPC_stRace.start_time;
+    HTTPC_stRace.racer[i] = req;
+    HTTPC_vResolveHostname(req);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vRaceTimerCallback(void *arg)
+{
+    uint8 running = 0;
+    uint8 i;
+
+    if (!HTTPC_stRace.active)
+        return;
+    HTTPC_vStartRacer();
+
+    for (i = 0; i < HTTPC_RACE_COUNT; i++)
+    {
+        if (HTTPC_stRace.racer[i] != NULL)
+            running++;
+    }
+    if ((running == 0) && (HTTPC_stRace.started >= HTTPC_stRace.count))
+    {
+        // Every URL failed
+        PRINTF("HTTPC: No URL of station delivered audio\n");
+        HTTPC_stRace.active = 0;
+        if (HTTPC_stRace.user_callback != NULL)
+            HTTPC_stRace.user_callback(-1);
+        return;
+    }
+    // Next URL joins later (right away if nothing is running)
+    if (HTTPC_stRace.started < HTTPC_stRace.count)
+    {
+        os_timer_disarm(&HTTPC_RaceTimerObject);
+        os_timer_arm(&HTTPC_RaceTimerObject, (running == 0) ? 0 : HTTPC_RACE_STAGGER_MS, 0);
+    }
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vStartRace(const char *headers, http_callback user_callback, uint32 start_time)
+{
+    HTTPC_tstMirrorCache *entry = HTTPC_pstFindMirror(HTTPC_u32HashUrl(HTTPC_stStation.url[0]));
+    sint8 top = HTTPC_s8TierUrl(0xFFFF, 0);
+
+    if (!HTTPC_bCopyString(HTTPC_stRace.headers, headers, HTTPC_HEADERS_SIZE))
+        return;
+    // Winner of last race, otherwise highest tier
+    if ((entry != NULL) && (entry->mirror < HTTPC_stStation.count))
+        HTTPC_stRace.first = entry->mirror;
+    else
+        HTTPC_stRace.first = (top >= 0) ? top : 0;
+    HTTPC_stRace.count = HTTPC_u8TierUrlCount(HTTPC_stRace.first);
+    HTTPC_stRace.started = 0;
+    HTTPC_stRace.start_time = start_time;
+    HTTPC_stRace.user_callback = user_callback;
+    HTTPC_stRace.active = 1;
+    os_timer_disarm(&HTTPC_RaceTimerObject);
+    os_timer_setfn(&HTTPC_RaceTimerObject, (os_timer_func_t*) HTTPC_vRaceTimerCallback, NULL);
+    // Start first URL, others follow staggered
+    HTTPC_vRaceTimerCallback(NULL);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vWinRace(HTTPC_tstContext *req)
+{
+    uint32 hash = HTTPC_u32HashUrl(HTTPC_stStation.url[0]);
+    HTTPC_tstMirrorCache *entry = HTTPC_pstFindMirror(hash);
+    HTTPC_tstContext *racer;
+    uint8 i;
+
+    HTTPC_stRace.active = 0;
+    os_timer_disarm(&HTTPC_RaceTimerObject);
+    req->racing = 0;
+    // Losers are cancelled
+    for (i = 0; i < HTTPC_RACE_COUNT; i++)
+    {
+        racer = HTTPC_stRace.racer[i];
+        HTTPC_stRace.racer[i] = NULL;
+        if ((racer != NULL) && (racer != req))
+        {
+            racer->racing = 0;
+            HTTPC_vCloseRequest(racer);
+        }
+    }
+
+    // Remember winner for next start of this station
+    HTTPC_stRace.time = (system_get_time() - HTTPC_stRace.start_time) / 1000;
+    if (entry == NULL)
+    {
+        entry = &HTTPC_astMirrorCache[HTTPC_u8MirrorCacheNext];
+        HTTPC_u8MirrorCacheNext = (HTTPC_u8MirrorCacheNext + 1) % HTTPC_MIRROR_CACHE_SIZE;
+        entry->hash = hash;
+    }
+    entry->mirror = req->mirror;
+    entry->startup_time = HTTPC_stRace.time;
+    PRINTF("HTTPC: URL %d (%s) won after %d ms\n", req->mirror, req->url, HTTPC_stRace.time);
+
+    req->user_callback = HTTPC_stRace.user_callback;
+    HTTPC_pstStream = req;
+    HTTPC_vStartWatchdog(req);
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vLeaveRace(HTTPC_tstContext *req)
+{
+    uint8 i;
+
+    req->racing = 0;
+    for (i = 0; i < HTTPC_RACE_COUNT; i++)
+    {
+        if (HTTPC_stRace.racer[i] == req)
+            HTTPC_stRace.racer[i] = NULL;
+    }
+    // Next URL takes over the slot as soon as this request has been freed
+    if (HTTPC_stRace.active)
+    {
+        os_timer_disarm(&HTTPC_RaceTimerObject);
+        os_timer_arm(&HTTPC_RaceTimerObject, 0, 0);
+    }
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vCancelRace(void)
+{
+    HTTPC_tstContext *racer;
+    uint8 i;
+
+    HTTPC_stRace.active = 0;
+    os_timer_disarm(&HTTPC_RaceTimerObject);
+    for (i = 0; i < HTTPC_RACE_COUNT; i++)
+    {
+        racer = HTTPC_stRace.racer[i];
+        HTTPC_stRace.racer[i] = NULL;
+        if (racer != NULL)
+        {
+            racer->racing = 0;
+            HTTPC_vCloseRequest(racer);
+        }
+    }
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vReleaseStream(void)
+{
+#ifdef WARM_STANDBY
+    // Connection is kept open for switching back (HLS segment ends anyway)
+    if (!HTTPC_pstStream->hls)
+        HTTPC_vMakeStandby(HTTPC_pstStream);
+    else
+        HTTPC_vCloseRequest(HTTPC_pstStream);
+#else
+    HTTPC_vCloseRequest(HTTPC_pstStream);
+#endif
+    HTTPC_vResetFlow();
+}
+
+static void ICACHE_FLASH_ATTR HTTPC_vOpenStation(const char *headers, http_callback user_callback)
+{
+    uint32 start_time = system_get_time();
+    HTTPC_tstContext *req;
+#ifdef WARM_STANDBY
+    HTTPC_tstContext *standby = NULL;
+    uint8 i;
+#endif
+
+    HTTPC_vCancelRace();
+    if (HTTPC_pstFailover != NULL)
+        HTTPC_vCloseRequest(HTTPC_pstFailover);
+#ifdef WARM_STANDBY
+    for (i = 0; (HTTPC_pstStandby != NULL) && (i < HTTPC_stStation.count); i++)
+    {
+        if (os_strcmp(HTTPC_pstStandby->url, HTTPC_stStation.url[i]) == 0)
+        {
+            // Connection to this station is open already. Taken over before the current stream becomes the standby
+            // (there is only one), so switching back and forth keeps both connections.
+            standby = HTTPC_pstStandby;
+            standby->mirror = i;
+            HTTPC_pstStandby = NULL;
+            break;
+        }
+    }
+#endif
+    if ((HTTPC_pstStream != NULL) && HTTPC_pstStream->playing)
+    {
+        // Station switch => Decoder drops data of old stream immediately
+        HTTPC_vReleaseStream();
+        VS1053_vCancelPlayback();
+    }
+    else
+    {
+        // Nothing is decoded at the moment => Only remaining data needs to be dropped
+        if (HTTPC_pstStream != NULL)
+            HTTPC_vReleaseStream();
+        VS1053_vFlushRingBuffer();
+    }
+    HTTPC_vResetFlow();
+    // Segment prefetch and playlist updates of old stream
+    HTTPC_vStopHls();
+
+#ifdef WARM_STANDBY
+    if (standby != NULL)
+    {
+        HTTPC_vPromoteStandby(standby, start_time);
+        return;
+    }
+#endif
+
+    HTTPC_bTimeToFirstAudioStandby = 0;
+    HTTPC_vResetTier();
+    if (HTTPC_stStation.count > 1)
+    {
+        // Several URLs => Fastest one becomes the stream
+        HTTPC_vStartRace(headers, user_callback, start_time);
+        return;
+    }
+    req = HTTPC_pstPrepareStream(0, headers, user_callback);
+    if (req == NULL)
+        return;
+    req->start_time = start_time;
+    HTTPC_pstStream = req;
+    HTTPC_vStartWatchdog(req);
+    HTTPC_vResolveHostname(req);
+}
+
+static bool ICACHE_FLASH_ATTR HTTPC_bIsPlaying(const char *url)
+{
+    // Same station => Nothing to do
+    return ((HTTPC_pstStream != NULL) || HTTPC_stRace.active) && (HTTPC_stStation.count != 0) && (os_strcmp(HTTPC_stStation.url[0], url) == 0);
 }
 
 void ICACHE_FLASH_ATTR HTTPC_vStartStreaming(const char *url, const char *headers, http_callback user_callback)
 {
-    if (SteamStarted == 1)
+    if (HTTPC_bIsPlaying(url))
+        return;
+    // Single URL => Stall failover reconnects to the same one
+    HTTPC_stStation.count = 0;
+    if (!HTTPC_bCopyString(HTTPC_stStation.url[0], url, HTTPC_STATION_URL_SIZE))
         return;
-    SteamStarted = 1;
-    // Open stream by sending POST
-    HTTPC_vSendPost(url, NULL, headers, user_callback);
+    HTTPC_stStation.count = 1;
+    HTTPC_vOpenStation(headers, user_callback);
+}
+
+void ICACHE_FLASH_ATTR HTTPC_vStartStreamingStation(const HTTPC_tstStation *station, const char *headers, http_callback user_callback)
+{
+    if ((station->count == 0) || HTTPC_bIsPlaying(station->url[0]))
+        return;
+    os_memcpy(&HTTPC_stStation, station, sizeof(HTTPC_tstStation));
+    HTTPC_vOpenStation(headers, user_callback);
 }
 
 void ICACHE_FLASH_ATTR HTTPC_vStopStreaming(void)
 {
-    // End Stream after next received data packet
-    StopStreaming = 1;
+    // Connection is closed right away. Data in ring buffer is still played.
+    HTTPC_vCancelRace();
+    if (HTTPC_pstFailover != NULL)
+        HTTPC_vCloseRequest(HTTPC_pstFailover);
+    if (HTTPC_pstStream != NULL)
+        HTTPC_vReleaseStream();
+    HTTPC_vStopHls();
+}
+
+bool ICACHE_FLASH_ATTR HTTPC_bGet(const char *url, const char *headers, const HTTPC_tstBodyCallbacks *callbacks)
+{
+    HTTPC_tstContext *req = HTTPC_pstPrepareUrl(url, NULL, headers, NULL);
+
+    // No callback is called if request could not be started
+    if (req == NULL)
+        return 0;
+    req->body_callbacks = *callbacks;
+    HTTPC_vResolveHostname(req);
+    return 1;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetDroppedBytes(void)
+{
+    return HTTPC_stFlow.dropped_bytes;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetHoldTime(void)
+{
+    // Include current hold period
+    if (HTTPC_stFlow.hold)
+        return HTTPC_stFlow.hold_time + (system_get_time() - HTTPC_stFlow.hold_start) / 1000;
+    return HTTPC_stFlow.hold_time;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetHoldCount(void)
+{
+    return HTTPC_stFlow.hold_count;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetTimeToFirstAudio(void)
+{
+    return HTTPC_u32TimeToFirstAudio;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetReconnectCount(void)
+{
+    return HTTPC_stReconnect.count;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetOutageTime(void)
+{
+    return HTTPC_stReconnect.outage_time;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetMaxOutageTime(void)
+{
+    return HTTPC_stReconnect.outage_max;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetReconnectBuffered(void)
+{
+    return HTTPC_stReconnect.buffered;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetBufferedTime(void)
+{
+    if (HTTPC_pstStream == NULL)
+        return 0;
+    // Playing time of data in ring and park buffer in ms
+    return FSYNC_u32GetDuration(&HTTPC_pstStream->fsync, VS1053_u16GetUsedBufferSize() + HTTPC_stFlow.park_length);
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetSyncLost(void)
+{
+    if (HTTPC_pstStream == NULL)
+        return 0;
+    return HTTPC_pstStream->fsync.sync_lost;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetDiscardedBytes(void)
+{
+    if (HTTPC_pstStream == NULL)
+        return 0;
+    return HTTPC_pstStream->fsync.discarded;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetStalls(void)
+{
+    return HTTPC_stWatchdog.stalls;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetFailoverTime(void)
+{
+    return HTTPC_stWatchdog.failover_time;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetUnderrunsAvoided(void)
+{
+    return HTTPC_stWatchdog.avoided;
+}
+
+uint8 ICACHE_FLASH_ATTR HTTPC_u8GetMirror(void)
+{
+    if (HTTPC_pstStream == NULL)
+        return 0;
+    return HTTPC_pstStream->mirror;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetMirrorStartupTime(void)
+{
+    return HTTPC_stRace.time;
+}
+
+uint16 ICACHE_FLASH_ATTR HTTPC_u16GetTier(void)
+{
+    if (HTTPC_pstStream == NULL)
+        return 0;
+    return HTTPC_stStation.bitrate[HTTPC_pstStream->mirror];
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetTierSwitches(void)
+{
+    return HTTPC_stTier.switches;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetGoodput(void)
+{
+    return HTTPC_stTier.goodput;
+}
+
+bool ICACHE_FLASH_ATTR HTTPC_bIsHls(void)
+{
+    return HTTPC_stHls.active;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetHlsSegments(void)
+{
+    return HTTPC_stHls.segments;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetHlsSkipped(void)
+{
+    return HTTPC_stHls.skipped;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetReceiveTime(void)
+{
+    return HTTPC_u32ReceiveTime;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetReceivedBytes(void)
+{
+    if (HTTPC_pstStream == NULL)
+        return 0;
+    return HTTPC_pstStream->received;
+}
+
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetTimeToFirstByte(void)
+{
+    return HTTPC_u32TimeToFirstByte;
+}
+
+bool ICACHE_FLASH_ATTR HTTPC_bIsTimeToFirstByteCached(void)
+{
+    return HTTPC_bTimeToFirstByteCached;
+}
+
+bool ICACHE_FLASH_ATTR HTTPC_bIsTimeToFirstAudioStandby(void)
+{
+    return HTTPC_bTimeToFirstAudioStandby;
+}
+
+void ICACHE_FLASH_ATTR HTTPC_vPrefetchUrl(const char *url)
+{
+    HTTPC_tstResolveCache *entry = HTTPC_pstFindResolvedUrl(url);
+    char hostname[HTTPC_HOSTNAME_SIZE];
+    const char *path;
+    int port;
+    bool secure;
+
+    // Resolve hostname of station in background (the one audio came from last time if known)
+    if (entry != NULL)
+        url = entry->url;
+    if (HTTPC_bParseUrl(url, hostname, &port, &secure, &path))
+        DNS_vPrefetch(hostname);
 }
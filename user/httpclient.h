@@ -10,9 +10,65 @@
 #ifndef HTTPCLIENT_H
 #define HTTPCLIENT_H
 
-typedef void (*http_callback)(char *response_body, int http_status, char *full_response);
+// Called when a stream has ended (http_status = -1 if no valid response has been received)
+typedef void (*http_callback)(int http_status);
+
+typedef void (*HTTPC_tpfHeadersCallback)(void *arg, int http_status, const char *content_type);
+typedef void (*HTTPC_tpfDataCallback)(void *arg, char *data, uint32 len);
+typedef void (*HTTPC_tpfCompleteCallback)(void *arg, int http_status);
+
+// URLs of a station. Alternates (mirrors) of the same tier are used if the stream stalls,
+// other tiers if the link can't sustain the bitrate or has room for more.
+#define HTTPC_STATION_URL_COUNT     4
+#define HTTPC_STATION_URL_SIZE      128
+
+typedef struct
+{
+    uint8 count;
+    uint16 bitrate[HTTPC_STATION_URL_COUNT]; // Tier in kbit/s (0 = not given)
+    char url[HTTPC_STATION_URL_COUNT][HTTPC_STATION_URL_SIZE];
+} HTTPC_tstStation;
+
+// Body of a request is handed over while it arrives (already dechunked). Memory use does not depend on response size.
+typedef struct
+{
+    HTTPC_tpfHeadersCallback on_headers; // Optional: Header of final response (after redirects) is complete
+    HTTPC_tpfDataCallback on_data; // Body data of a 200 response
+    HTTPC_tpfCompleteCallback on_complete; // Optional: Request has ended (http_status = -1 on error or incomplete body)
+    void *arg;
+} HTTPC_tstBodyCallbacks;
 
 void ICACHE_FLASH_ATTR HTTPC_vStartStreaming(const char * url, const char * headers, http_callback user_callback);
+void ICACHE_FLASH_ATTR HTTPC_vStartStreamingStation(const HTTPC_tstStation *station, const char *headers, http_callback user_callback);
 void ICACHE_FLASH_ATTR HTTPC_vStopStreaming(void);
+bool ICACHE_FLASH_ATTR HTTPC_bGet(const char *url, const char *headers, const HTTPC_tstBodyCallbacks *callbacks);
+void ICACHE_FLASH_ATTR HTTPC_vPrefetchUrl(const char *url);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetDroppedBytes(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetHoldTime(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetHoldCount(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetTimeToFirstAudio(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetReceivedBytes(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetReceiveTime(void);
+uint16 ICACHE_FLASH_ATTR HTTPC_u16GetTier(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetTierSwitches(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetGoodput(void);
+uint8 ICACHE_FLASH_ATTR HTTPC_u8GetMirror(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetMirrorStartupTime(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetStalls(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetFailoverTime(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetUnderrunsAvoided(void);
+bool ICACHE_FLASH_ATTR HTTPC_bIsHls(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetHlsSegments(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetHlsSkipped(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetTimeToFirstByte(void);
+bool ICACHE_FLASH_ATTR HTTPC_bIsTimeToFirstByteCached(void);
+bool ICACHE_FLASH_ATTR HTTPC_bIsTimeToFirstAudioStandby(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetReconnectCount(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetOutageTime(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetMaxOutageTime(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetReconnectBuffered(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetBufferedTime(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetSyncLost(void);
+uint32 ICACHE_FLASH_ATTR HTTPC_u32GetDiscardedBytes(void);
 
 #endif
@@ -0,0 +1,144 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <esp8266.h>
+#include "httpheader.h"
+
+// Compare header field name (case insensitive) and return pointer to its value
+static const char* ICACHE_FLASH_ATTR HTTPH_pcGetFieldValue(const char *line, const char *name)
+{
+    while (*name != '\0')
+    {
+        if (tolower((uint8) *line) != *name)
+            return NULL;
+        line++;
+        name++;
+    }
+    if (*line != ':')
+        return NULL;
+    line++;
+    // Skip leading whitespace
+    while ((*line == ' ') || (*line == '\t'))
+        line++;
+    return line;
+}
+
+static void ICACHE_FLASH_ATTR HTTPH_vCopyValue(char *dest, const char *value, uint32 size)
+{
+    uint32 length = os_strlen(value);
+
+    if (length >= size)
+        length = size - 1;
+    os_memcpy(dest, value, length);
+    dest[length] = '\0';
+}
+
+static HTTPH_tenResult ICACHE_FLASH_ATTR HTTPH_enParseLine(HTTPH_tstParser *parser)
+{
+    const char *value;
+
+    if (!parser->status_received)
+    {
+        // Status line: "HTTP/1.x 200 OK" or SHOUTcast "ICY 200 OK"
+        if (os_strncmp(parser->line, "HTTP/1.", 7) == 0)
+            value = parser->line + 7;
+        else if (os_strncmp(parser->line, "ICY", 3) == 0)
+        {
+            parser->icy = 1;
+            value = parser->line + 3;
+        }
+        else
+            return HTTPH_enResultError;
+        value = os_strchr(value, ' ');
+        if (value == NULL)
+            return HTTPH_enResultError;
+        parser->status = strtol(value, NULL, 10);
+        if (parser->status == 0)
+            return HTTPH_enResultError;
+        parser->status_received = 1;
+        return HTTPH_enResultMore;
+    }
+
+    if ((value = HTTPH_pcGetFieldValue(parser->line, "icy-metaint")) != NULL)
+        parser->metaint = strtol(value, NULL, 10);
+    else if ((value = HTTPH_pcGetFieldValue(parser->line, "icy-br")) != NULL)
+        parser->bitrate = strtol(value, NULL, 10); // Might be a list like "128,128" => First value is used
+    else if ((value = HTTPH_pcGetFieldValue(parser->line, "content-type")) != NULL)
+        HTTPH_vCopyValue(parser->content_type, value, sizeof(parser->content_type));
+    else if ((value = HTTPH_pcGetFieldValue(parser->line, "location")) != NULL)
+    {
+        // A truncated location is useless
+        if (!parser->reader.truncated)
+            HTTPH_vCopyValue(parser->location, value, sizeof(parser->location));
+    }
+    else if ((value = HTTPH_pcGetFieldValue(parser->line, "transfer-encoding")) != NULL)
+        parser->chunked = (os_strncmp(value, "chunked", 7) == 0);
+
+    return HTTPH_enResultMore;
+}
+
+void ICACHE_FLASH_ATTR HTTPH_vInit(HTTPH_tstParser *parser)
+{
+    os_memset(parser, 0, sizeof(HTTPH_tstParser));
+}
+
+HTTPH_tenResult ICACHE_FLASH_ATTR HTTPH_enProcess(HTTPH_tstParser *parser, const char *data, uint32 length, uint32 *consumed)
+{
+    HTTPH_tenResult result;
+    uint32 pos = 0;
+    uint32 count;
+    uint32 used;
+    bool complete;
+
+    while (pos < length)
+    {
+        // Whole header is limited, not only its lines
+        if (parser->header_size >= HTTPH_HEADER_SIZE_MAX)
+        {
+            *consumed = pos;
+            return HTTPH_enResultError;
+        }
+        count = HTTPH_HEADER_SIZE_MAX - parser->header_size;
+        if (count > length - pos)
+            count = length - pos;
+        complete = TEXT_bReadLine(&parser->reader, parser->line, sizeof(parser->line), data + pos, count, &used);
+        parser->header_size += used;
+        pos += used;
+        if (!complete)
+            continue;
+        if (parser->reader.length == 0)
+        {
+            // Empty line => End of header. Everything after it is body.
+            *consumed = pos;
+            return parser->status_received ? HTTPH_enResultDone : HTTPH_enResultError;
+        }
+        result = HTTPH_enParseLine(parser);
+        if (result != HTTPH_enResultMore)
+        {
+            *consumed = pos;
+            return result;
+        }
+    }
+    *consumed = length;
+    return HTTPH_enResultMore;
+}
@@ -0,0 +1,61 @@
+#ifndef USER_HTTPHEADER_H_
+#define USER_HTTPHEADER_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "text.h"
+
+// Maximum length of a single header line (longer lines are truncated)
+#define HTTPH_LINE_SIZE             256
+// Maximum size of the complete header
+#define HTTPH_HEADER_SIZE_MAX       8192
+#define HTTPH_CONTENT_TYPE_SIZE     48
+#define HTTPH_LOCATION_SIZE         HTTPH_LINE_SIZE
+
+typedef enum
+{
+    HTTPH_enResultMore, // Header not complete yet => Feed next segment
+    HTTPH_enResultDone, // Header complete => Remaining data is body
+    HTTPH_enResultError // Not a valid HTTP/ICY response
+} HTTPH_tenResult;
+
+typedef struct
+{
+    uint32 header_size; // Bytes of header consumed so far
+    TEXT_tstLine reader;
+    bool status_received;
+    bool icy; // SHOUTcast "ICY 200 OK" response
+    bool chunked; // Transfer-Encoding: chunked
+    uint16 status; // HTTP status code
+    uint16 bitrate; // icy-br in kbit/s (0 = not given)
+    uint32 metaint; // icy-metaint (0 = no metadata)
+    char content_type[HTTPH_CONTENT_TYPE_SIZE];
+    char location[HTTPH_LOCATION_SIZE];
+    char line[HTTPH_LINE_SIZE];
+} HTTPH_tstParser;
+
+void ICACHE_FLASH_ATTR HTTPH_vInit(HTTPH_tstParser *parser);
+HTTPH_tenResult ICACHE_FLASH_ATTR HTTPH_enProcess(HTTPH_tstParser *parser, const char *data, uint32 length, uint32 *consumed);
+
+#endif /* USER_HTTPHEADER_H_ */
@@ -0,0 +1,140 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <esp8266.h>
+#include "icy.h"
+
+static void ICACHE_FLASH_ATTR ICY_vParseMetadata(ICY_tstParser *parser)
+{
+    char *start;
+    char *end;
+    uint32 length;
+
+    // Terminate string (metadata is padded with zeros, but it might have been truncated)
+    parser->metadata[parser->metadata_length] = '\0';
+    // Search for StreamTitle='...';
+    start = os_strstr(parser->metadata, "StreamTitle='");
+    if (start == NULL)
+        return;
+    start += os_strlen("StreamTitle='");
+    // Title ends with "';" (a single quote may be part of the title)
+    end = os_strstr(start, "';");
+    if (end == NULL)
+        end = start + os_strlen(start);
+    length = end - start;
+    if (length >= ICY_TITLE_SIZE)
+        length = ICY_TITLE_SIZE - 1;
+    // Only report changes
+    if ((os_strncmp(parser->title, start, length) == 0) && (parser->title[length] == '\0'))
+        return;
+    os_memcpy(parser->title, start, length);
+    parser->title[length] = '\0';
+    myprintf("ICY: %s\n", parser->title);
+}
+
+void ICACHE_FLASH_ATTR ICY_vInit(ICY_tstParser *parser, uint32 interval, ICY_tpfAudioCallback audio_callback, void *arg)
+{
+    parser->state = ICY_enStateAudio;
+    parser->interval = interval;
+    parser->remaining = interval;
+    parser->metadata_length = 0;
+    parser->title[0] = '\0';
+    parser->audio_callback = audio_callback;
+    parser->arg = arg;
+}
+
+void ICACHE_FLASH_ATTR ICY_vProcess(ICY_tstParser *parser, char *data, uint32 length)
+{
+    uint32 count;
+
+    // Data can be split at any position. Parser state is kept between calls.
+    while (length != 0)
+    {
+        switch (parser->state)
+        {
+            case ICY_enStateAudio:
+                // Hand over contiguous audio data without copying
+                count = length;
+                if ((parser->interval != 0) && (count > parser->remaining))
+                    count = parser->remaining;
+                parser->audio_callback(parser->arg, data, count);
+                data += count;
+                length -= count;
+                if (parser->interval != 0)
+                {
+                    parser->remaining -= count;
+                    if (parser->remaining == 0)
+                        parser->state = ICY_enStateLength;
+                }
+                break;
+
+            case ICY_enStateLength:
+                // Length byte is given in 16 byte units
+                parser->remaining = ((uint8) *data) * 16;
+                data++;
+                length--;
+                parser->metadata_length = 0;
+                if (parser->remaining == 0)
+                {
+                    // Empty metadata block
+                    parser->state = ICY_enStateAudio;
+                    parser->remaining = parser->interval;
+                }
+                else
+                {
+                    parser->state = ICY_enStateMetadata;
+                }
+                break;
+
+            case ICY_enStateMetadata:
+                count = length;
+                if (count > parser->remaining)
+                    count = parser->remaining;
+                // Store as much as fits into metadata buffer (keep one byte for termination)
+                if (parser->metadata_length < ICY_METADATA_SIZE - 1)
+                {
+                    uint32 copy = ICY_METADATA_SIZE - 1 - parser->metadata_length;
+                    if (copy > count)
+                        copy = count;
+                    os_memcpy(&parser->metadata[parser->metadata_length], data, copy);
+                    parser->metadata_length += copy;
+                }
+                data += count;
+                length -= count;
+                parser->remaining -= count;
+                if (parser->remaining == 0)
+                {
+                    // Metadata block complete
+                    ICY_vParseMetadata(parser);
+                    parser->state = ICY_enStateAudio;
+                    parser->remaining = parser->interval;
+                }
+                break;
+        }
+    }
+}
+
+const char* ICACHE_FLASH_ATTR ICY_pcGetTitle(ICY_tstParser *parser)
+{
+    return parser->title;
+}
@@ -0,0 +1,57 @@
+#ifndef USER_ICY_H_
+#define USER_ICY_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Size of metadata block copy (longer blocks are truncated)
+#define ICY_METADATA_SIZE   256
+// Size of StreamTitle buffer (longer titles are truncated)
+#define ICY_TITLE_SIZE      128
+
+typedef void (*ICY_tpfAudioCallback)(void *arg, char *data, uint32 len);
+
+typedef enum
+{
+    ICY_enStateAudio, // Audio data until next metadata block
+    ICY_enStateLength, // Length byte of metadata block
+    ICY_enStateMetadata // Metadata block content
+} ICY_tenState;
+
+typedef struct
+{
+    ICY_tenState state;
+    uint32 interval; // Number of audio bytes between metadata blocks (icy-metaint, 0 = no metadata)
+    uint32 remaining; // Bytes left in current audio run or metadata block
+    uint16 metadata_length; // Bytes of current metadata block stored in metadata buffer
+    char metadata[ICY_METADATA_SIZE];
+    char title[ICY_TITLE_SIZE]; // Last StreamTitle received
+    ICY_tpfAudioCallback audio_callback;
+    void *arg;
+} ICY_tstParser;
+
+void ICACHE_FLASH_ATTR ICY_vInit(ICY_tstParser *parser, uint32 interval, ICY_tpfAudioCallback audio_callback, void *arg);
+void ICACHE_FLASH_ATTR ICY_vProcess(ICY_tstParser *parser, char *data, uint32 length);
+const char* ICACHE_FLASH_ATTR ICY_pcGetTitle(ICY_tstParser *parser);
+
+#endif /* USER_ICY_H_ */
@@ -0,0 +1,115 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <esp8266.h>
+#include "playlist.h"
+
+static PLAYLIST_tenResult ICACHE_FLASH_ATTR PLAYLIST_enParseLine(PLAYLIST_tstParser *parser)
+{
+    char *value = parser->line;
+    char *end;
+
+    // Skip leading whitespace
+    while ((*value == ' ') || (*value == '\t'))
+        value++;
+
+    // .pls: "File1=http://..." (.m3u: URL without prefix, comments start with '#')
+    if ((tolower((uint8) value[0]) == 'f') && (os_strncmp(value + 1, "ile", 3) == 0))
+    {
+        value = os_strchr(value, '=');
+        if (value == NULL)
+            return PLAYLIST_enResultMore;
+        value++;
+    }
+    if ((os_strncmp(value, "http://", 7) != 0) && (os_strncmp(value, "https://", 8) != 0))
+        return PLAYLIST_enResultMore;
+
+    // Remove trailing whitespace
+    end = value + os_strlen(value);
+    while ((end > value) && ((end[-1] == ' ') || (end[-1] == '\t')))
+        end--;
+    *end = '\0';
+    // URL is returned in line buffer
+    os_memmove(parser->line, value, end - value + 1);
+    return PLAYLIST_enResultDone;
+}
+
+bool ICACHE_FLASH_ATTR PLAYLIST_bIsPlaylist(const char *content_type, const char *path)
+{
+    // audio/x-mpegurl, audio/mpegurl, application/x-mpegurl, audio/x-scpls, application/pls+xml
+    if ((os_strstr(content_type, "mpegurl") != NULL) || (os_strstr(content_type, "scpls") != NULL) || (os_strstr(content_type, "pls+xml") != NULL))
+        return 1;
+    // Some servers send playlists as text/plain or application/octet-stream
+    return TEXT_bHasExtension(path, ".m3u") || TEXT_bHasExtension(path, ".pls");
+}
+
+void ICACHE_FLASH_ATTR PLAYLIST_vInit(PLAYLIST_tstParser *parser)
+{
+    parser->size = 0;
+    TEXT_vInitLine(&parser->reader);
+}
+
+PLAYLIST_tenResult ICACHE_FLASH_ATTR PLAYLIST_enProcess(PLAYLIST_tstParser *parser, const char *data, uint32 length)
+{
+    PLAYLIST_tenResult result;
+    uint32 count;
+    uint32 consumed;
+    bool complete;
+
+    while (length != 0)
+    {
+        // Whole playlist is limited, not only its lines
+        if (parser->size >= PLAYLIST_SIZE_MAX)
+            return PLAYLIST_enResultError;
+        count = PLAYLIST_SIZE_MAX - parser->size;
+        if (count > length)
+            count = length;
+        complete = TEXT_bReadLine(&parser->reader, parser->line, sizeof(parser->line), data, count, &consumed);
+        parser->size += consumed;
+        data += consumed;
+        length -= consumed;
+        // A truncated URL is useless
+        if (complete && !parser->reader.truncated)
+        {
+            result = PLAYLIST_enParseLine(parser);
+            if (result != PLAYLIST_enResultMore)
+                return result;
+        }
+    }
+    return PLAYLIST_enResultMore;
+}
+
+PLAYLIST_tenResult ICACHE_FLASH_ATTR PLAYLIST_enFinish(PLAYLIST_tstParser *parser)
+{
+    if (TEXT_bFinishLine(&parser->reader, parser->line) && !parser->reader.truncated)
+    {
+        if (PLAYLIST_enParseLine(parser) == PLAYLIST_enResultDone)
+            return PLAYLIST_enResultDone;
+    }
+    return PLAYLIST_enResultError;
+}
+
+const char* ICACHE_FLASH_ATTR PLAYLIST_pcGetUrl(PLAYLIST_tstParser *parser)
+{
+    return parser->line;
+}
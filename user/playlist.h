@@ -0,0 +1,54 @@
+#ifndef USER_PLAYLIST_H_
+#define USER_PLAYLIST_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "text.h"
+
+// Maximum length of a playlist line (longer lines are ignored)
+#define PLAYLIST_LINE_SIZE          256
+// Give up if there is no URL within this amount of data
+#define PLAYLIST_SIZE_MAX           16384
+
+typedef enum
+{
+    PLAYLIST_enResultMore, // No URL yet => Feed next segment
+    PLAYLIST_enResultDone, // URL found
+    PLAYLIST_enResultError // No URL in playlist
+} PLAYLIST_tenResult;
+
+typedef struct
+{
+    uint32 size; // Bytes of playlist processed so far
+    TEXT_tstLine reader;
+    char line[PLAYLIST_LINE_SIZE]; // Contains URL when done
+} PLAYLIST_tstParser;
+
+bool ICACHE_FLASH_ATTR PLAYLIST_bIsPlaylist(const char *content_type, const char *path);
+void ICACHE_FLASH_ATTR PLAYLIST_vInit(PLAYLIST_tstParser *parser);
+PLAYLIST_tenResult ICACHE_FLASH_ATTR PLAYLIST_enProcess(PLAYLIST_tstParser *parser, const char *data, uint32 length);
+PLAYLIST_tenResult ICACHE_FLASH_ATTR PLAYLIST_enFinish(PLAYLIST_tstParser *parser);
+const char* ICACHE_FLASH_ATTR PLAYLIST_pcGetUrl(PLAYLIST_tstParser *parser);
+
+#endif /* USER_PLAYLIST_H_ */
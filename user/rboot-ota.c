@@ -13,6 +13,8 @@
 #include <osapi.h>
 
 #include "rboot-ota.h"
+#include "dnscache.h"
+#include "control.h"
 
 #define UPGRADE_FLAG_IDLE		0x00
 #define UPGRADE_FLAG_START		0x01
@@ -365,7 +367,7 @@ bool ICACHE_FLASH_ATTR rboot_ota_start(ota_callback callback)
     system_upgrade_flag_set(UPGRADE_FLAG_START);
 
     // dns lookup
-    result = espconn_gethostbyname(upgrade->conn, OTA_HOST, &upgrade->ip, upgrade_resolved);
+    result = DNS_s8GetHostByName(upgrade->conn, OTA_HOST, &upgrade->ip, upgrade_resolved);
     if (result == ESPCONN_OK)
     {
         // hostname is already cached or is actually a dotted decimal ip address
@@ -402,6 +404,8 @@ static void ICACHE_FLASH_ATTR OtaUpdate_CallBack(bool result, uint8 rom_slot)
             // set to boot new rom and then reboot
             myprintf("Firmware updated, rebooting to rom %d...\n", rom_slot);
             rboot_set_current_rom(rom_slot);
+            // Pending settings would be lost otherwise
+            Control_vFlushSettings();
             system_restart();
         }
     }
@@ -0,0 +1,212 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <esp8266.h>
+#include "settings.h"
+
+// Sector header: Magic and sequence number (higher = newer). Written after the snapshot.
+#define SETTINGS_MAGIC              0x4C475453
+#define SETTINGS_HEADER_SIZE        8
+// Record: Key, value, CRC-8 of both, zero byte (a record is never 0xFFFFFFFF)
+#define SETTINGS_RECORD_SIZE        4
+#define SETTINGS_RECORD_COUNT       ((ESP_SPI_FLASH_PAGE_SIZE - SETTINGS_HEADER_SIZE) / SETTINGS_RECORD_SIZE)
+#define SETTINGS_FREE_RECORD        0xFFFFFFFF
+// Records read from flash at once
+#define SETTINGS_READ_RECORDS       32
+
+typedef struct
+{
+    bool valid; // Active sector exists
+    uint8 sector; // Active sector within ring
+    uint32 sequence; // Sequence number of active sector
+    uint16 next; // Next free record in active sector
+    uint16 present; // Bit mask of keys with stored value
+    uint8 value[SETTINGS_KEY_COUNT];
+    uint32 writes; // Records written
+    uint32 erases; // Sectors erased
+} SETTINGS_tstStore;
+
+static SETTINGS_tstStore SETTINGS_stStore;
+
+static uint8 ICACHE_FLASH_ATTR SETTINGS_u8Crc(uint8 key, uint8 value)
+{
+    uint8 data[2] = { key, value };
+    uint8 crc = 0;
+    uint8 i;
+    uint8 j;
+
+    // CRC-8, polynomial x^8 + x^2 + x + 1
+    for (i = 0; i < sizeof(data); i++)
+    {
+        crc ^= data[i];
+        for (j = 0; j < 8; j++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+    return crc;
+}
+
+static uint32 ICACHE_FLASH_ATTR SETTINGS_u32Address(uint8 sector, uint16 record)
+{
+    return (SETTINGS_FIRST_SECTOR + sector) * ESP_SPI_FLASH_PAGE_SIZE + SETTINGS_HEADER_SIZE + record * SETTINGS_RECORD_SIZE;
+}
+
+static bool ICACHE_FLASH_ATTR SETTINGS_bWriteRecord(uint8 sector, uint16 record, uint8 key, uint8 value)
+{
+    uint32 data = key | (value << 8) | (SETTINGS_u8Crc(key, value) << 16);
+
+    SETTINGS_stStore.writes++;
+    return spi_flash_write(SETTINGS_u32Address(sector, record), &data, SETTINGS_RECORD_SIZE) == SPI_FLASH_RESULT_OK;
+}
+
+static void ICACHE_FLASH_ATTR SETTINGS_vReplay(uint8 sector)
+{
+    uint32 data[SETTINGS_READ_RECORDS];
+    uint16 record;
+    uint16 count;
+    uint8 i;
+    uint8 key;
+    uint8 value;
+
+    // Newer records overwrite older ones. Free space starts behind the last written record.
+    SETTINGS_stStore.next = 0;
+    for (record = 0; record < SETTINGS_RECORD_COUNT; record += SETTINGS_READ_RECORDS)
+    {
+        count = SETTINGS_RECORD_COUNT - record;
+        if (count > SETTINGS_READ_RECORDS)
+            count = SETTINGS_READ_RECORDS;
+        if (spi_flash_read(SETTINGS_u32Address(sector, record), data, count * SETTINGS_RECORD_SIZE) != SPI_FLASH_RESULT_OK)
+            return;
+        for (i = 0; i < count; i++)
+        {
+            if (data[i] == SETTINGS_FREE_RECORD)
+                continue;
+            SETTINGS_stStore.next = record + i + 1;
+            key = data[i] & 0xFF;
+            value = (data[i] >> 8) & 0xFF;
+            // Record might be incomplete because of a power loss while writing
+            if ((key >= SETTINGS_KEY_COUNT) || (((data[i] >> 16) & 0xFF) != SETTINGS_u8Crc(key, value)) || ((data[i] >> 24) != 0))
+                continue;
+            SETTINGS_stStore.value[key] = value;
+            SETTINGS_stStore.present |= 1 << key;
+        }
+    }
+}
+
+static bool ICACHE_FLASH_ATTR SETTINGS_bStartSector(void)
+{
+    uint8 sector = SETTINGS_stStore.valid ? (SETTINGS_stStore.sector + 1) % SETTINGS_SECTOR_COUNT : 0;
+    uint32 header[2] = { SETTINGS_MAGIC, SETTINGS_stStore.sequence + 1 };
+    uint16 record = 0;
+    uint8 key;
+
+    // Oldest sector of the ring is reused
+    SETTINGS_stStore.erases++;
+    if (spi_flash_erase_sector(SETTINGS_FIRST_SECTOR + sector) != SPI_FLASH_RESULT_OK)
+        return 0;
+    // Snapshot of all values. Header comes last, so an incomplete sector is never used.
+    for (key = 0; key < SETTINGS_KEY_COUNT; key++)
+    {
+        if (!(SETTINGS_stStore.present & (1 << key)))
+            continue;
+        if (!SETTINGS_bWriteRecord(sector, record, key, SETTINGS_stStore.value[key]))
+            return 0;
+        record++;
+    }
+    if (spi_flash_write((SETTINGS_FIRST_SECTOR + sector) * ESP_SPI_FLASH_PAGE_SIZE, header, sizeof(header)) != SPI_FLASH_RESULT_OK)
+        return 0;
+    SETTINGS_stStore.valid = 1;
+    SETTINGS_stStore.sector = sector;
+    SETTINGS_stStore.sequence = header[1];
+    SETTINGS_stStore.next = record;
+    return 1;
+}
+
+bool ICACHE_FLASH_ATTR SETTINGS_bInit(void)
+{
+    uint32 header[2];
+    uint8 sector;
+
+    SETTINGS_stStore.valid = 0;
+    SETTINGS_stStore.sequence = 0;
+    SETTINGS_stStore.present = 0;
+    // Newest complete sector is the active one
+    for (sector = 0; sector < SETTINGS_SECTOR_COUNT; sector++)
+    {
+        if (spi_flash_read((SETTINGS_FIRST_SECTOR + sector) * ESP_SPI_FLASH_PAGE_SIZE, header, sizeof(header)) != SPI_FLASH_RESULT_OK)
+            continue;
+        if ((header[0] != SETTINGS_MAGIC) || (SETTINGS_stStore.valid && (header[1] <= SETTINGS_stStore.sequence)))
+            continue;
+        SETTINGS_stStore.valid = 1;
+        SETTINGS_stStore.sector = sector;
+        SETTINGS_stStore.sequence = header[1];
+    }
+    // Nothing stored yet => First write creates the log
+    if (!SETTINGS_stStore.valid)
+        return 0;
+    SETTINGS_vReplay(SETTINGS_stStore.sector);
+    return 1;
+}
+
+bool ICACHE_FLASH_ATTR SETTINGS_bGet(uint8 key, uint8 *value)
+{
+    if ((key >= SETTINGS_KEY_COUNT) || !(SETTINGS_stStore.present & (1 << key)))
+        return 0;
+    *value = SETTINGS_stStore.value[key];
+    return 1;
+}
+
+void ICACHE_FLASH_ATTR SETTINGS_vSet(uint8 key, uint8 value)
+{
+    if (key >= SETTINGS_KEY_COUNT)
+        return;
+    // Unchanged value doesn't cost a write
+    if ((SETTINGS_stStore.present & (1 << key)) && (SETTINGS_stStore.value[key] == value))
+        return;
+    SETTINGS_stStore.value[key] = value;
+    SETTINGS_stStore.present |= 1 << key;
+
+    // Active sector is full => Snapshot in next sector contains the new value already
+    if (!SETTINGS_stStore.valid || (SETTINGS_stStore.next >= SETTINGS_RECORD_COUNT))
+    {
+        SETTINGS_bStartSector();
+        return;
+    }
+    // Single program operation, no erase
+    if (SETTINGS_bWriteRecord(SETTINGS_stStore.sector, SETTINGS_stStore.next, key, value))
+        SETTINGS_stStore.next++;
+    else
+    {
+        // Flash error => Next change starts over in a fresh sector
+        SETTINGS_stStore.next = SETTINGS_RECORD_COUNT;
+    }
+}
+
+uint32 ICACHE_FLASH_ATTR SETTINGS_u32GetWrites(void)
+{
+    return SETTINGS_stStore.writes;
+}
+
+uint32 ICACHE_FLASH_ATTR SETTINGS_u32GetErases(void)
+{
+    return SETTINGS_stStore.erases;
+}
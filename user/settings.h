@@ -0,0 +1,40 @@
+#ifndef USER_SETTINGS_H_
+#define USER_SETTINGS_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Settings are stored as a log of small records in a ring of flash sectors below the old settings page.
+// A sector is only erased when the active one is full. Its first records are a snapshot of all values.
+#define SETTINGS_SECTOR_COUNT       4
+#define SETTINGS_FIRST_SECTOR       (ESP_SPI_FLASH_LAST_PAGE - SETTINGS_SECTOR_COUNT)
+// Number of different settings (keys 0..SETTINGS_KEY_COUNT-1)
+#define SETTINGS_KEY_COUNT          16
+
+bool ICACHE_FLASH_ATTR SETTINGS_bInit(void);
+bool ICACHE_FLASH_ATTR SETTINGS_bGet(uint8 key, uint8 *value);
+void ICACHE_FLASH_ATTR SETTINGS_vSet(uint8 key, uint8 value);
+uint32 ICACHE_FLASH_ATTR SETTINGS_u32GetWrites(void);
+uint32 ICACHE_FLASH_ATTR SETTINGS_u32GetErases(void);
+
+#endif /* USER_SETTINGS_H_ */
@@ -0,0 +1,430 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <esp8266.h>
+#include "stationdb.h"
+
+// Header: Magic, sequence number (higher = newer), number of stations, bytes used.
+// Written last, so an incomplete list is never used.
+#define STATIONDB_MAGIC             0x32445453
+#define STATIONDB_HEADER_SIZE       16
+// Offset table fills the rest of the table sectors
+#define STATIONDB_MAX_STATIONS      ((STATIONDB_TABLE_SECTORS * ESP_SPI_FLASH_PAGE_SIZE - STATIONDB_HEADER_SIZE) / 4)
+// Search index: 128 bit Bloom filter of the name trigrams per station
+#define STATIONDB_INDEX_OFFSET      (STATIONDB_TABLE_SECTORS * ESP_SPI_FLASH_PAGE_SIZE)
+#define STATIONDB_SIGNATURE_SIZE    16
+#define STATIONDB_SIGNATURE_WORDS   (STATIONDB_SIGNATURE_SIZE / 4)
+#define STATIONDB_DATA_OFFSET       ((STATIONDB_TABLE_SECTORS + STATIONDB_INDEX_SECTORS) * ESP_SPI_FLASH_PAGE_SIZE)
+// Signatures read from flash at once
+#define STATIONDB_FIND_BLOCK        16
+#define STATIONDB_SIZE              (STATIONDB_SECTOR_COUNT * ESP_SPI_FLASH_PAGE_SIZE)
+#define STATIONDB_ADDRESS(bank, offset) ((STATIONDB_FIRST_SECTOR + (bank) * STATIONDB_SECTOR_COUNT) * ESP_SPI_FLASH_PAGE_SIZE + (offset))
+// Words read from flash at once
+#define STATIONDB_READ_WORDS        16
+
+// Entry (4 byte aligned): This header followed by name and URLs (each terminated)
+typedef struct
+{
+    uint8 count; // Number of URLs
+    uint8 name_size; // Including termination
+    uint16 size; // Size of whole entry
+    uint16 bitrate[HTTPC_STATION_URL_COUNT];
+    uint8 url_size[HTTPC_STATION_URL_COUNT]; // Including termination
+} STATIONDB_tstEntry;
+
+#define STATIONDB_ENTRY_SIZE        (sizeof(STATIONDB_tstEntry) + STATIONDB_NAME_SIZE + HTTPC_STATION_URL_COUNT * HTTPC_STATION_URL_SIZE)
+
+typedef struct
+{
+    bool valid; // Active bank exists
+    uint8 bank; // Active bank
+    uint32 sequence; // Sequence number of active bank
+    uint32 count; // Stations in active list
+    uint32 size; // Bytes used by active list
+    // Writing (always to the bank that is not active)
+    uint32 *entry; // Buffer for a single entry (only allocated while writing)
+    uint8 next_bank;
+    uint32 next_count;
+    uint32 next_size;
+    uint16 erased; // Sectors erased for list being written
+    uint16 table_erased; // Table sectors erased for list being written
+    uint16 index_erased; // Index sectors erased for list being written
+} STATIONDB_tstStore;
+
+static STATIONDB_tstStore STATIONDB_stStore;
+
+static bool ICACHE_FLASH_ATTR STATIONDB_bRead(uint32 offset, void *data, uint32 size)
+{
+    uint32 buffer[STATIONDB_READ_WORDS];
+    uint8 *dst = data;
+    uint32 start;
+    uint32 length;
+    uint32 copy;
+
+    // Flash is read word wise => Unaligned parts are cut out of a local buffer
+    while (size > 0)
+    {
+        start = offset & ~3;
+        length = (offset - start + size + 3) & ~3;
+        if (length > sizeof(buffer))
+            length = sizeof(buffer);
+        if (spi_flash_read(STATIONDB_ADDRESS(STATIONDB_stStore.bank, start), buffer, length) != SPI_FLASH_RESULT_OK)
+            return 0;
+        copy = length - (offset - start);
+        if (copy > size)
+            copy = size;
+        os_memcpy(dst, (uint8*) buffer + (offset - start), copy);
+        dst += copy;
+        offset += copy;
+        size -= copy;
+    }
+    return 1;
+}
+
+static char ICACHE_FLASH_ATTR STATIONDB_cLower(char c)
+{
+    return ((c >= 'A') && (c <= 'Z')) ? c - 'A' + 'a' : c;
+}
+
+static void ICACHE_FLASH_ATTR STATIONDB_vSignature(const char *text, uint32 *signature)
+{
+    uint32 hash;
+
+    // One bit per trigram. A station can only contain the search text if it has all bits of it.
+    os_memset(signature, 0, STATIONDB_SIGNATURE_SIZE);
+    for (; (text[0] != '\0') && (text[1] != '\0') && (text[2] != '\0'); text++)
+    {
+        hash = ((uint8) STATIONDB_cLower(text[0]) << 16) | ((uint8) STATIONDB_cLower(text[1]) << 8) | (uint8) STATIONDB_cLower(text[2]);
+        // Multiplicative hashing, upper 7 bits select the bit
+        hash = (hash * 2654435761u) >> 25;
+        signature[hash >> 5] |= 1u << (hash & 31);
+    }
+}
+
+static bool ICACHE_FLASH_ATTR STATIONDB_bContains(const char *name, const char *text)
+{
+    uint32 i;
+
+    // Text is lower case already
+    for (; *name != '\0'; name++)
+    {
+        for (i = 0; (text[i] != '\0') && (STATIONDB_cLower(name[i]) == text[i]); i++)
+            ;
+        if (text[i] == '\0')
+            return 1;
+    }
+    return text[0] == '\0';
+}
+
+static bool ICACHE_FLASH_ATTR STATIONDB_bReadEntry(uint32 index, STATIONDB_tstEntry *entry, uint32 *offset)
+{
+    uint8 i;
+
+    if (index >= STATIONDB_stStore.count)
+        return 0;
+    // Offset table => Every station is found without walking the list
+    if (spi_flash_read(STATIONDB_ADDRESS(STATIONDB_stStore.bank, STATIONDB_HEADER_SIZE + index * 4), offset, 4) != SPI_FLASH_RESULT_OK)
+        return 0;
+    if ((*offset < STATIONDB_DATA_OFFSET) || (*offset & 3) || (*offset + sizeof(STATIONDB_tstEntry) > STATIONDB_stStore.size))
+        return 0;
+    if (spi_flash_read(STATIONDB_ADDRESS(STATIONDB_stStore.bank, *offset), (uint32*) entry, sizeof(STATIONDB_tstEntry)) != SPI_FLASH_RESULT_OK)
+        return 0;
+    // Corrupt entries must not overflow the buffers of the caller
+    if ((entry->name_size == 0) || (entry->name_size > STATIONDB_NAME_SIZE) || (entry->count > HTTPC_STATION_URL_COUNT)
+            || (*offset + entry->size > STATIONDB_stStore.size))
+        return 0;
+    for (i = 0; i < entry->count; i++)
+    {
+        if ((entry->url_size[i] == 0) || (entry->url_size[i] > HTTPC_STATION_URL_SIZE))
+            return 0;
+    }
+    return 1;
+}
+
+bool ICACHE_FLASH_ATTR STATIONDB_bInit(void)
+{
+    uint32 header[STATIONDB_HEADER_SIZE / 4];
+    uint8 bank;
+
+    STATIONDB_stStore.valid = 0;
+    STATIONDB_stStore.bank = 0;
+    STATIONDB_stStore.sequence = 0;
+    STATIONDB_stStore.count = 0;
+    STATIONDB_stStore.size = 0;
+    // Newest complete bank is the active one
+    for (bank = 0; bank < STATIONDB_BANK_COUNT; bank++)
+    {
+        if (spi_flash_read(STATIONDB_ADDRESS(bank, 0), header, sizeof(header)) != SPI_FLASH_RESULT_OK)
+            continue;
+        if ((header[0] != STATIONDB_MAGIC) || (header[2] > STATIONDB_MAX_STATIONS) || (header[3] > STATIONDB_SIZE))
+            continue;
+        if (STATIONDB_stStore.valid && (header[1] <= STATIONDB_stStore.sequence))
+            continue;
+        STATIONDB_stStore.valid = 1;
+        STATIONDB_stStore.bank = bank;
+        STATIONDB_stStore.sequence = header[1];
+        STATIONDB_stStore.count = header[2];
+        STATIONDB_stStore.size = header[3];
+    }
+    // Nothing stored yet (or first write was interrupted)
+    return STATIONDB_stStore.valid;
+}
+
+uint32 ICACHE_FLASH_ATTR STATIONDB_u32GetCount(void)
+{
+    return STATIONDB_stStore.count;
+}
+
+bool ICACHE_FLASH_ATTR STATIONDB_bGetName(uint32 index, char *name)
+{
+    STATIONDB_tstEntry entry;
+    uint32 offset;
+
+    // Name has STATIONDB_NAME_SIZE bytes at most
+    if (!STATIONDB_bReadEntry(index, &entry, &offset))
+        return 0;
+    if (!STATIONDB_bRead(offset + sizeof(entry), name, entry.name_size))
+        return 0;
+    name[entry.name_size - 1] = '\0';
+    return 1;
+}
+
+bool ICACHE_FLASH_ATTR STATIONDB_bGetStation(uint32 index, HTTPC_tstStation *station)
+{
+    STATIONDB_tstEntry entry;
+    uint32 offset;
+    uint8 i;
+
+    if (!STATIONDB_bReadEntry(index, &entry, &offset))
+        return 0;
+    os_memset(station, 0, sizeof(HTTPC_tstStation));
+    offset += sizeof(entry) + entry.name_size;
+    for (i = 0; i < entry.count; i++)
+    {
+        if (!STATIONDB_bRead(offset, station->url[i], entry.url_size[i]))
+            return 0;
+        station->url[i][entry.url_size[i] - 1] = '\0';
+        station->bitrate[i] = entry.bitrate[i];
+        offset += entry.url_size[i];
+    }
+    station->count = entry.count;
+    return 1;
+}
+
+static bool ICACHE_FLASH_ATTR STATIONDB_bErase(uint16 sector)
+{
+    return spi_flash_erase_sector(STATIONDB_FIRST_SECTOR + STATIONDB_stStore.next_bank * STATIONDB_SECTOR_COUNT + sector) == SPI_FLASH_RESULT_OK;
+}
+
+static bool ICACHE_FLASH_ATTR STATIONDB_bEraseUpTo(uint16 *erased, uint32 end)
+{
+    // Sectors are erased when the list grows into them
+    while (end > *erased * ESP_SPI_FLASH_PAGE_SIZE)
+    {
+        if (!STATIONDB_bErase(*erased))
+            return 0;
+        (*erased)++;
+    }
+    return 1;
+}
+
+bool ICACHE_FLASH_ATTR STATIONDB_bBeginWrite(void)
+{
+    // Only one list can be written at a time
+    if (STATIONDB_stStore.entry != NULL)
+        return 0;
+    STATIONDB_stStore.entry = (uint32*) os_malloc((STATIONDB_ENTRY_SIZE + 3) & ~3);
+    if (STATIONDB_stStore.entry == NULL)
+    {
+        myprintf("os_malloc() returned NULL\n");
+        return 0;
+    }
+    // Active list stays readable. Erasing the header of the other bank invalidates its old list.
+    STATIONDB_stStore.next_bank = STATIONDB_stStore.valid ? (STATIONDB_stStore.bank + 1) % STATIONDB_BANK_COUNT : 0;
+    STATIONDB_stStore.next_count = 0;
+    STATIONDB_stStore.next_size = STATIONDB_DATA_OFFSET;
+    STATIONDB_stStore.erased = STATIONDB_TABLE_SECTORS + STATIONDB_INDEX_SECTORS;
+    STATIONDB_stStore.table_erased = 0;
+    STATIONDB_stStore.index_erased = STATIONDB_TABLE_SECTORS;
+    if (!STATIONDB_bErase(0))
+    {
+        STATIONDB_vAbort();
+        return 0;
+    }
+    STATIONDB_stStore.table_erased = 1;
+    return 1;
+}
+
+bool ICACHE_FLASH_ATTR STATIONDB_bAdd(const char *name, const HTTPC_tstStation *station)
+{
+    STATIONDB_tstEntry *entry = (STATIONDB_tstEntry*) STATIONDB_stStore.entry;
+    char *data;
+    uint32 size;
+    uint32 length;
+    uint8 i;
+
+    uint32 table = STATIONDB_HEADER_SIZE + STATIONDB_stStore.next_count * 4;
+    uint32 index = STATIONDB_INDEX_OFFSET + STATIONDB_stStore.next_count * STATIONDB_SIGNATURE_SIZE;
+    uint32 signature[STATIONDB_SIGNATURE_WORDS];
+
+    if ((entry == NULL) || (STATIONDB_stStore.table_erased == 0) || (STATIONDB_stStore.next_count >= STATIONDB_MAX_STATIONS))
+        return 0;
+    // Build entry in RAM. Name is truncated if too long, URLs of HTTPC_tstStation always fit.
+    os_memset(entry, 0, sizeof(STATIONDB_tstEntry));
+    data = (char*) entry + sizeof(STATIONDB_tstEntry);
+    length = os_strlen(name);
+    if (length > STATIONDB_NAME_SIZE - 1)
+        length = STATIONDB_NAME_SIZE - 1;
+    os_memcpy(data, name, length);
+    data[length] = '\0';
+    STATIONDB_vSignature(data, signature);
+    entry->name_size = length + 1;
+    data += entry->name_size;
+    for (i = 0; (i < station->count) && (i < HTTPC_STATION_URL_COUNT); i++)
+    {
+        length = os_strlen(station->url[i]) + 1;
+        if (length > HTTPC_STATION_URL_SIZE)
+            return 0;
+        os_memcpy(data, station->url[i], length);
+        data += length;
+        entry->url_size[i] = length;
+        entry->bitrate[i] = station->bitrate[i];
+    }
+    entry->count = i;
+    // Pad to full words (flash is written word wise)
+    size = data - (char*) entry;
+    while (size & 3)
+        ((char*) entry)[size++] = '\0';
+    entry->size = size;
+    if (STATIONDB_stStore.next_size + size > STATIONDB_SIZE)
+        return 0;
+    if (!STATIONDB_bEraseUpTo(&STATIONDB_stStore.erased, STATIONDB_stStore.next_size + size)
+            || !STATIONDB_bEraseUpTo(&STATIONDB_stStore.table_erased, table + 4)
+            || !STATIONDB_bEraseUpTo(&STATIONDB_stStore.index_erased, index + STATIONDB_SIGNATURE_SIZE))
+        return 0;
+    if (spi_flash_write(STATIONDB_ADDRESS(STATIONDB_stStore.next_bank, STATIONDB_stStore.next_size), STATIONDB_stStore.entry, size) != SPI_FLASH_RESULT_OK)
+        return 0;
+    if (spi_flash_write(STATIONDB_ADDRESS(STATIONDB_stStore.next_bank, index), signature, sizeof(signature)) != SPI_FLASH_RESULT_OK)
+        return 0;
+    if (spi_flash_write(STATIONDB_ADDRESS(STATIONDB_stStore.next_bank, table), &STATIONDB_stStore.next_size, 4) != SPI_FLASH_RESULT_OK)
+        return 0;
+    STATIONDB_stStore.next_count++;
+    STATIONDB_stStore.next_size += size;
+    return 1;
+}
+
+bool ICACHE_FLASH_ATTR STATIONDB_bCommit(void)
+{
+    uint32 header[STATIONDB_HEADER_SIZE / 4] = { STATIONDB_MAGIC, STATIONDB_stStore.sequence + 1, STATIONDB_stStore.next_count, STATIONDB_stStore.next_size };
+
+    if ((STATIONDB_stStore.entry == NULL) || (STATIONDB_stStore.table_erased == 0))
+    {
+        STATIONDB_vAbort();
+        return 0;
+    }
+    // Header switches to the new list. Until then the old one is used (also after a reset).
+    if (spi_flash_write(STATIONDB_ADDRESS(STATIONDB_stStore.next_bank, 0), header, sizeof(header)) != SPI_FLASH_RESULT_OK)
+    {
+        STATIONDB_vAbort();
+        return 0;
+    }
+    STATIONDB_vAbort();
+    STATIONDB_stStore.valid = 1;
+    STATIONDB_stStore.bank = STATIONDB_stStore.next_bank;
+    STATIONDB_stStore.sequence = header[1];
+    STATIONDB_stStore.count = header[2];
+    STATIONDB_stStore.size = header[3];
+    return 1;
+}
+
+void ICACHE_FLASH_ATTR STATIONDB_vAbort(void)
+{
+    // Active list is not touched, the other bank is overwritten by the next write anyway
+    if (STATIONDB_stStore.entry != NULL)
+        os_free(STATIONDB_stStore.entry);
+    STATIONDB_stStore.entry = NULL;
+    STATIONDB_stStore.table_erased = 0;
+}
+
+void ICACHE_FLASH_ATTR STATIONDB_vInitQuery(STATIONDB_tstQuery *query, const char *text)
+{
+    uint32 i;
+
+    // Longer search texts are cut (the result contains more stations then)
+    for (i = 0; (text[i] != '\0') && (i < STATIONDB_QUERY_SIZE - 1); i++)
+        query->text[i] = STATIONDB_cLower(text[i]);
+    query->text[i] = '\0';
+    STATIONDB_vSignature(query->text, query->signature);
+    query->next = 0;
+}
+
+STATIONDB_tenFind ICACHE_FLASH_ATTR STATIONDB_enFind(STATIONDB_tstQuery *query, uint32 *index, char *name)
+{
+    uint32 signature[STATIONDB_FIND_BLOCK * STATIONDB_SIGNATURE_WORDS];
+    uint32 checked = 0;
+    uint32 names = 0;
+    uint32 count;
+    uint32 i;
+    uint32 j;
+
+    // Index is scanned in blocks. Only stations whose signature fits are read from flash.
+    while (query->next < STATIONDB_stStore.count)
+    {
+        // Limit reached at the end of a block => Don't read the next one
+        if ((checked >= STATIONDB_FIND_SIGNATURES) || (names >= STATIONDB_FIND_NAMES))
+            return STATIONDB_enFindMore;
+        count = STATIONDB_stStore.count - query->next;
+        if (count > sizeof(signature) / STATIONDB_SIGNATURE_SIZE)
+            count = sizeof(signature) / STATIONDB_SIGNATURE_SIZE;
+        if (spi_flash_read(STATIONDB_ADDRESS(STATIONDB_stStore.bank, STATIONDB_INDEX_OFFSET + query->next * STATIONDB_SIGNATURE_SIZE), signature,
+                count * STATIONDB_SIGNATURE_SIZE) != SPI_FLASH_RESULT_OK)
+            return STATIONDB_enFindDone;
+        for (i = 0; i < count; i++)
+        {
+            // Limits are checked per station, so the next call continues right here
+            if ((checked >= STATIONDB_FIND_SIGNATURES) || (names >= STATIONDB_FIND_NAMES))
+            {
+                query->next += i;
+                return STATIONDB_enFindMore;
+            }
+            checked++;
+            for (j = 0; j < STATIONDB_SIGNATURE_WORDS; j++)
+            {
+                if ((signature[i * STATIONDB_SIGNATURE_WORDS + j] & query->signature[j]) != query->signature[j])
+                    break;
+            }
+            if (j != STATIONDB_SIGNATURE_WORDS)
+                continue;
+            // Signature can match by chance => Check name
+            names++;
+            if (STATIONDB_bGetName(query->next + i, name) && STATIONDB_bContains(name, query->text))
+            {
+                *index = query->next + i;
+                query->next += i + 1;
+                return STATIONDB_enFindMatch;
+            }
+        }
+        query->next += count;
+    }
+    return STATIONDB_enFindDone;
+}
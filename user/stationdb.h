@@ -0,0 +1,72 @@
+#ifndef USER_STATIONDB_H_
+#define USER_STATIONDB_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "httpclient.h"
+#include "settings.h"
+
+// Station list is stored in flash below the settings log: Header and offset table in the first sectors,
+// search index and packed entries behind it. Entries are read on demand, so the list size does not depend on RAM.
+// A new list is written to the other bank while the active one stays in use.
+#define STATIONDB_BANK_COUNT        2
+#define STATIONDB_SECTOR_COUNT      256
+#define STATIONDB_TABLE_SECTORS     10
+// 16 byte name signature per station
+#define STATIONDB_INDEX_SECTORS     40
+#define STATIONDB_FIRST_SECTOR      (SETTINGS_FIRST_SECTOR - STATIONDB_BANK_COUNT * STATIONDB_SECTOR_COUNT)
+// Size of a station name (including termination)
+#define STATIONDB_NAME_SIZE         64
+// Size of a search text (including termination)
+#define STATIONDB_QUERY_SIZE        32
+// Work per search call: Signatures compared and names checked
+#define STATIONDB_FIND_SIGNATURES   256
+#define STATIONDB_FIND_NAMES        8
+
+typedef enum
+{
+    STATIONDB_enFindMatch, // Station found => Call again for next one
+    STATIONDB_enFindMore, // Work of this call is done => Call again to continue
+    STATIONDB_enFindDone // All stations checked
+} STATIONDB_tenFind;
+
+typedef struct
+{
+    char text[STATIONDB_QUERY_SIZE]; // Lower case
+    uint32 signature[4];
+    uint32 next; // Next station to check
+} STATIONDB_tstQuery;
+
+bool ICACHE_FLASH_ATTR STATIONDB_bInit(void);
+uint32 ICACHE_FLASH_ATTR STATIONDB_u32GetCount(void);
+bool ICACHE_FLASH_ATTR STATIONDB_bGetName(uint32 index, char *name);
+bool ICACHE_FLASH_ATTR STATIONDB_bGetStation(uint32 index, HTTPC_tstStation *station);
+bool ICACHE_FLASH_ATTR STATIONDB_bBeginWrite(void);
+bool ICACHE_FLASH_ATTR STATIONDB_bAdd(const char *name, const HTTPC_tstStation *station);
+bool ICACHE_FLASH_ATTR STATIONDB_bCommit(void);
+void ICACHE_FLASH_ATTR STATIONDB_vAbort(void);
+void ICACHE_FLASH_ATTR STATIONDB_vInitQuery(STATIONDB_tstQuery *query, const char *text);
+STATIONDB_tenFind ICACHE_FLASH_ATTR STATIONDB_enFind(STATIONDB_tstQuery *query, uint32 *index, char *name);
+
+#endif /* USER_STATIONDB_H_ */
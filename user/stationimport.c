@@ -0,0 +1,302 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <esp8266.h>
+#include "stationimport.h"
+
+static bool ICACHE_FLASH_ATTR STATIONIMPORT_bIsUrl(const char *value)
+{
+    return (os_strncmp(value, "http://", 7) == 0) || (os_strncmp(value, "https://", 8) == 0);
+}
+
+static char* ICACHE_FLASH_ATTR STATIONIMPORT_pcTrim(char *value)
+{
+    char *end;
+
+    while ((*value == ' ') || (*value == '\t'))
+        value++;
+    end = value + os_strlen(value);
+    while ((end > value) && ((end[-1] == ' ') || (end[-1] == '\t')))
+        end--;
+    *end = '\0';
+    return value;
+}
+
+static void ICACHE_FLASH_ATTR STATIONIMPORT_vCopyName(char *name, const char *value)
+{
+    // Truncated if too long
+    os_strncpy(name, value, STATIONDB_NAME_SIZE - 1);
+    name[STATIONDB_NAME_SIZE - 1] = '\0';
+}
+
+static bool ICACHE_FLASH_ATTR STATIONIMPORT_bAddUrl(STATIONIMPORT_tstParser *parser, const char *url, uint16 bitrate)
+{
+    HTTPC_tstStation *station = &parser->station;
+
+    // URLs that don't fit are skipped (a truncated URL would be wrong)
+    if ((station->count >= HTTPC_STATION_URL_COUNT) || !STATIONIMPORT_bIsUrl(url) || (os_strlen(url) >= HTTPC_STATION_URL_SIZE))
+        return 0;
+    station->bitrate[station->count] = bitrate;
+    os_strcpy(station->url[station->count++], url);
+    return 1;
+}
+
+static void ICACHE_FLASH_ATTR STATIONIMPORT_vFlush(STATIONIMPORT_tstParser *parser)
+{
+    // Entry without name is named after its URL
+    if (parser->station.count != 0)
+    {
+        if (parser->name[0] == '\0')
+            STATIONIMPORT_vCopyName(parser->name, parser->station.url[0]);
+        if (STATIONDB_bAdd(parser->name, &parser->station))
+            parser->entries++;
+        else
+            parser->skipped++;
+    }
+    else if (parser->name[0] != '\0')
+        parser->skipped++;
+    parser->number = 0;
+    parser->name[0] = '\0';
+    os_memset(&parser->station, 0, sizeof(HTTPC_tstStation));
+}
+
+static void ICACHE_FLASH_ATTR STATIONIMPORT_vSelectEntry(STATIONIMPORT_tstParser *parser, uint32 number)
+{
+    if (number == parser->number)
+        return;
+    STATIONIMPORT_vFlush(parser);
+    parser->number = number;
+}
+
+static bool ICACHE_FLASH_ATTR STATIONIMPORT_bIsKey(char **value, const char *key, uint32 *number)
+{
+    char *pos = *value;
+    uint32 length = os_strlen(key);
+    uint32 i;
+
+    // .pls keys are case insensitive and followed by the entry number
+    for (i = 0; i < length; i++)
+    {
+        if (tolower((uint8) pos[i]) != key[i])
+            return 0;
+    }
+    pos += length;
+    *number = TEXT_u32ParseNumber(pos, &pos);
+    if (*pos != '=')
+        return 0;
+    *value = STATIONIMPORT_pcTrim(pos + 1);
+    return 1;
+}
+
+static bool ICACHE_FLASH_ATTR STATIONIMPORT_bIsPlsLine(const char *value)
+{
+    // Any "KeyN=Value" line (Length1, NumberOfEntries, Version are ignored)
+    while (((*value >= 'a') && (*value <= 'z')) || ((*value >= 'A') && (*value <= 'Z')))
+        value++;
+    while ((*value >= '0') && (*value <= '9'))
+        value++;
+    return *value == '=';
+}
+
+static char* ICACHE_FLASH_ATTR STATIONIMPORT_pcNextField(char **line, char separator)
+{
+    char *field = *line;
+    char *src;
+    char *dst;
+
+    if (field == NULL)
+        return "";
+    field = STATIONIMPORT_pcTrim(field);
+    if (*field != '"')
+    {
+        // Plain field
+        src = os_strchr(field, separator);
+        if (src != NULL)
+            *src++ = '\0';
+        *line = src;
+        return STATIONIMPORT_pcTrim(field);
+    }
+    // Quoted field: Separator is part of the value, "" is a quote
+    for (src = dst = ++field; *src != '\0'; src++)
+    {
+        if (*src == '"')
+        {
+            if (src[1] != '"')
+                break;
+            src++;
+        }
+        *dst++ = *src;
+    }
+    if (*src == '"')
+        src++;
+    src = os_strchr(src, separator);
+    *line = (src != NULL) ? src + 1 : NULL;
+    *dst = '\0';
+    return field;
+}
+
+static void ICACHE_FLASH_ATTR STATIONIMPORT_vParseStationLine(STATIONIMPORT_tstParser *parser, char *line)
+{
+    char *field;
+    char *url;
+    char *digits;
+    uint32 bitrate;
+
+    // "Name;URL[;Alternate URL...]". URLs can be prefixed by their bitrate in kbit/s ("128@http://...").
+    field = os_strchr(line, ';');
+    *field++ = '\0';
+    STATIONIMPORT_vCopyName(parser->name, STATIONIMPORT_pcTrim(line));
+    while (field != NULL)
+    {
+        url = field;
+        field = os_strchr(field, ';');
+        if (field != NULL)
+            *field++ = '\0';
+        url = STATIONIMPORT_pcTrim(url);
+        bitrate = TEXT_u32ParseNumber(url, &digits);
+        if ((digits != url) && (*digits == '@'))
+            url = digits + 1;
+        else
+            bitrate = 0;
+        if (*url != '\0')
+            STATIONIMPORT_bAddUrl(parser, url, bitrate);
+    }
+    STATIONIMPORT_vFlush(parser);
+}
+
+static void ICACHE_FLASH_ATTR STATIONIMPORT_vParseCsvLine(STATIONIMPORT_tstParser *parser, char *line)
+{
+    char *name = STATIONIMPORT_pcNextField(&line, ',');
+    char *url = STATIONIMPORT_pcNextField(&line, ',');
+    char *bitrate = STATIONIMPORT_pcNextField(&line, ',');
+
+    // "Name,URL[,Bitrate]". Header row has no URL and is skipped.
+    STATIONIMPORT_vCopyName(parser->name, name);
+    STATIONIMPORT_bAddUrl(parser, url, TEXT_u32ParseNumber(bitrate, NULL));
+    STATIONIMPORT_vFlush(parser);
+}
+
+static void ICACHE_FLASH_ATTR STATIONIMPORT_vParseLine(STATIONIMPORT_tstParser *parser)
+{
+    char *value = STATIONIMPORT_pcTrim(parser->line);
+    uint32 number;
+
+    if (*value == '\0')
+        return;
+    // .m3u: Name of the next URL
+    if (os_strncmp(value, "#EXTINF:", 8) == 0)
+    {
+        STATIONIMPORT_vFlush(parser);
+        value = os_strchr(value, ',');
+        if (value != NULL)
+            STATIONIMPORT_vCopyName(parser->name, STATIONIMPORT_pcTrim(value + 1));
+        return;
+    }
+    // Comments, .m3u header and .pls section
+    if ((*value == '#') || (*value == '['))
+        return;
+    // .m3u: URL completes the entry
+    if (STATIONIMPORT_bIsUrl(value))
+    {
+        if (!STATIONIMPORT_bAddUrl(parser, value, 0) && (parser->name[0] == '\0'))
+            parser->skipped++;
+        STATIONIMPORT_vFlush(parser);
+        return;
+    }
+    // .pls: Lines of an entry can come in any order. Next entry number completes the entry.
+    if (STATIONIMPORT_bIsPlsLine(value))
+    {
+        if (STATIONIMPORT_bIsKey(&value, "file", &number))
+        {
+            STATIONIMPORT_vSelectEntry(parser, number);
+            STATIONIMPORT_bAddUrl(parser, value, 0);
+        }
+        else if (STATIONIMPORT_bIsKey(&value, "title", &number))
+        {
+            STATIONIMPORT_vSelectEntry(parser, number);
+            STATIONIMPORT_vCopyName(parser->name, value);
+        }
+        return;
+    }
+    STATIONIMPORT_vFlush(parser);
+    if (os_strchr(value, ';') != NULL)
+        STATIONIMPORT_vParseStationLine(parser, value);
+    else if (os_strchr(value, ',') != NULL)
+        STATIONIMPORT_vParseCsvLine(parser, value);
+    else
+        parser->skipped++;
+}
+
+bool ICACHE_FLASH_ATTR STATIONIMPORT_bBegin(STATIONIMPORT_tstParser *parser)
+{
+    parser->entries = 0;
+    parser->skipped = 0;
+    TEXT_vInitLine(&parser->reader);
+    parser->number = 0;
+    parser->name[0] = '\0';
+    os_memset(&parser->station, 0, sizeof(HTTPC_tstStation));
+    // New list is written to flash while parsing
+    return STATIONDB_bBeginWrite();
+}
+
+static void ICACHE_FLASH_ATTR STATIONIMPORT_vHandleLine(STATIONIMPORT_tstParser *parser)
+{
+    // A truncated line would give a wrong URL
+    if (parser->reader.truncated)
+        parser->skipped++;
+    else
+        STATIONIMPORT_vParseLine(parser);
+}
+
+void ICACHE_FLASH_ATTR STATIONIMPORT_vProcess(STATIONIMPORT_tstParser *parser, const char *data, uint32 length)
+{
+    uint32 consumed;
+
+    while (length != 0)
+    {
+        if (TEXT_bReadLine(&parser->reader, parser->line, sizeof(parser->line), data, length, &consumed))
+            STATIONIMPORT_vHandleLine(parser);
+        data += consumed;
+        length -= consumed;
+    }
+}
+
+bool ICACHE_FLASH_ATTR STATIONIMPORT_bFinish(STATIONIMPORT_tstParser *parser)
+{
+    if (TEXT_bFinishLine(&parser->reader, parser->line))
+        STATIONIMPORT_vHandleLine(parser);
+    STATIONIMPORT_vFlush(parser);
+    // List without a single station would only replace the active one by nothing
+    if (parser->entries == 0)
+    {
+        STATIONDB_vAbort();
+        return 0;
+    }
+    return STATIONDB_bCommit();
+}
+
+void ICACHE_FLASH_ATTR STATIONIMPORT_vAbort(STATIONIMPORT_tstParser *parser)
+{
+    // Active list stays in use
+    STATIONDB_vAbort();
+}
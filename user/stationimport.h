@@ -0,0 +1,55 @@
+#ifndef USER_STATIONIMPORT_H_
+#define USER_STATIONIMPORT_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "stationdb.h"
+#include "text.h"
+
+// Longest line of a station list (name and all URLs). Longer lines are skipped.
+#define STATIONIMPORT_LINE_SIZE     (STATIONDB_NAME_SIZE + HTTPC_STATION_URL_COUNT * (HTTPC_STATION_URL_SIZE + 8))
+
+// Accepted formats (detected per line, so they can be mixed):
+//   streamlist.txt: "Name;[Bitrate@]URL[;[Bitrate@]Alternate URL...]"
+//   .m3u:           "#EXTINF:-1,Name" followed by URL
+//   .pls:           "FileN=URL", "TitleN=Name"
+//   CSV:            "Name,URL[,Bitrate]" (fields may be quoted)
+typedef struct
+{
+    uint32 entries; // Stations written to list
+    uint32 skipped; // Lines or entries that could not be used
+    TEXT_tstLine reader;
+    char line[STATIONIMPORT_LINE_SIZE];
+    // Entry of .m3u/.pls whose name and URL are on different lines
+    uint32 number; // Entry number of .pls
+    char name[STATIONDB_NAME_SIZE];
+    HTTPC_tstStation station;
+} STATIONIMPORT_tstParser;
+
+bool ICACHE_FLASH_ATTR STATIONIMPORT_bBegin(STATIONIMPORT_tstParser *parser);
+void ICACHE_FLASH_ATTR STATIONIMPORT_vProcess(STATIONIMPORT_tstParser *parser, const char *data, uint32 length);
+bool ICACHE_FLASH_ATTR STATIONIMPORT_bFinish(STATIONIMPORT_tstParser *parser);
+void ICACHE_FLASH_ATTR STATIONIMPORT_vAbort(STATIONIMPORT_tstParser *parser);
+
+#endif /* USER_STATIONIMPORT_H_ */
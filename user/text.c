@@ -0,0 +1,107 @@
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <esp8266.h>
+#include "text.h"
+
+void ICACHE_FLASH_ATTR TEXT_vInitLine(TEXT_tstLine *line)
+{
+    line->length = 0;
+    line->truncated = 0;
+    line->complete = 0;
+}
+
+// Lines can be split at any position. Only the current line is kept between calls, so the
+// caller parses it before reading on. Returns 1 if the line is complete (data up to and
+// including its end has been consumed).
+bool ICACHE_FLASH_ATTR TEXT_bReadLine(TEXT_tstLine *line, char *buffer, uint16 size, const char *data, uint32 length, uint32 *consumed)
+{
+    uint32 i;
+    char c;
+
+    // Previous line has been parsed
+    if (line->complete)
+        TEXT_vInitLine(line);
+    for (i = 0; i < length; i++)
+    {
+        c = data[i];
+        if (c == '\r')
+            continue;
+        if (c == '\n')
+        {
+            buffer[line->length] = '\0';
+            line->complete = 1;
+            *consumed = i + 1;
+            return 1;
+        }
+        // Store character (keep one byte for termination)
+        if (line->length < size - 1)
+            buffer[line->length++] = c;
+        else
+            line->truncated = 1;
+    }
+    *consumed = length;
+    return 0;
+}
+
+// Last line might not be terminated. Returns 1 if there is one left to parse.
+bool ICACHE_FLASH_ATTR TEXT_bFinishLine(TEXT_tstLine *line, char *buffer)
+{
+    if (line->complete || (line->length == 0))
+        return 0;
+    buffer[line->length] = '\0';
+    line->complete = 1;
+    return 1;
+}
+
+bool ICACHE_FLASH_ATTR TEXT_bHasExtension(const char *path, const char *extension)
+{
+    const char *end = os_strchr(path, '?');
+    uint32 length = os_strlen(extension);
+    uint32 i;
+
+    // Ignore query string
+    if (end == NULL)
+        end = path + os_strlen(path);
+    if (end - path < length)
+        return 0;
+    end -= length;
+    for (i = 0; i < length; i++)
+    {
+        if (tolower((uint8) end[i]) != extension[i])
+            return 0;
+    }
+    return 1;
+}
+
+// Decimal digits until the first other character (given back in end unless NULL)
+uint32 ICACHE_FLASH_ATTR TEXT_u32ParseNumber(const char *value, char **end)
+{
+    uint32 number = 0;
+
+    while ((*value >= '0') && (*value <= '9'))
+        number = number * 10 + (*value++ - '0');
+    if (end != NULL)
+        *end = (char*) value;
+    return number;
+}
@@ -0,0 +1,41 @@
+#ifndef USER_TEXT_H_
+#define USER_TEXT_H_
+
+/* MIT License
+ *
+ * Copyright (c) 2019, wolllis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Line of a text body (playlist, HTTP header, station list) that is received in segments
+typedef struct
+{
+    uint16 length; // Characters stored so far
+    bool truncated; // Line didn't fit into the buffer => Rest of it has been dropped
+    bool complete; // Line end received => Line can be parsed
+} TEXT_tstLine;
+
+void ICACHE_FLASH_ATTR TEXT_vInitLine(TEXT_tstLine *line);
+bool ICACHE_FLASH_ATTR TEXT_bReadLine(TEXT_tstLine *line, char *buffer, uint16 size, const char *data, uint32 length, uint32 *consumed);
+bool ICACHE_FLASH_ATTR TEXT_bFinishLine(TEXT_tstLine *line, char *buffer);
+bool ICACHE_FLASH_ATTR TEXT_bHasExtension(const char *path, const char *extension);
+uint32 ICACHE_FLASH_ATTR TEXT_u32ParseNumber(const char *value, char **end);
+
+#endif /* USER_TEXT_H_ */
@@ -27,21 +27,62 @@
 #include "vs1053.h"
 #include "stdout.h"
 #include "httpclient.h"
+#include "dnscache.h"
 
-extern uint32 data_count;
-
-os_timer_t TimerObject_1;
+os_timer_t TimerObject_10;
 os_timer_t TimerObject_1000;
+uint32 Time_u32Uptime = 0;
+uint32 Time_u32LastReceived = 0;
+#ifdef STREAM_STATISTICS
+uint32 Time_u32LastCpuTime = 0;
+#endif
+
+void ICACHE_FLASH_ATTR TimerFunc_10(void *arg)
+{
+    // Fallback in case a DREQ edge has been missed. Feeding itself is triggered by DREQ edge.
+    VS1053_vKickFeeder();
+}
 
-void ICACHE_FLASH_ATTR TimerFunc_1(void *arg)
+#ifdef STREAM_STATISTICS
+static void ICACHE_FLASH_ATTR Time_vPrintStreamStatistics(void)
 {
-    VS1053_vPoll();
+    uint32 cpu_time = HTTPC_u32GetReceiveTime() + VS1053_u32GetFeederBusyTime();
+
+    myprintf("Buffered: %d ms (peak %d Bytes) | ", HTTPC_u32GetBufferedTime(), VS1053_u16GetPeakBufferSize());
+    // Receive path and feeder. While playing, one second of wall clock equals one second of audio.
+    myprintf("CPU: %d us/s | ", cpu_time - Time_u32LastCpuTime);
+    Time_u32LastCpuTime = cpu_time;
+    myprintf("Sync lost: %d (%d Bytes discarded) | ", HTTPC_u32GetSyncLost(), HTTPC_u32GetDiscardedBytes());
+    myprintf("TTFB: %d ms%s | ", HTTPC_u32GetTimeToFirstByte(), HTTPC_bIsTimeToFirstByteCached() ? " (cached URL)" : "");
+    myprintf("TTFA: %d ms%s | ", HTTPC_u32GetTimeToFirstAudio(), HTTPC_bIsTimeToFirstAudioStandby() ? " (warm standby)" : "");
+    myprintf("DNS: %d hits %d misses (last lookup %d ms) | ", DNS_u32GetHits(), DNS_u32GetMisses(), DNS_u32GetLookupTime());
+    myprintf("Hold: %d (%d ms) | Dropped: %d Bytes | ", HTTPC_u32GetHoldCount(), HTTPC_u32GetHoldTime(), HTTPC_u32GetDroppedBytes());
+    myprintf("DREQ latency: %d us (max %d us) | ", VS1053_u32GetFeederLatency(), VS1053_u32GetFeederMaxLatency());
+    myprintf("Underruns: %d (%d/h) | ", VS1053_u32GetUnderruns(), VS1053_u32GetUnderruns() * 3600 / Time_u32Uptime);
+    myprintf("URL: %d (startup %d ms) | ", HTTPC_u8GetMirror(), HTTPC_u32GetMirrorStartupTime());
+    myprintf("Tier: %d kbit/s (%d switches, goodput %d Byte/s) | ", HTTPC_u16GetTier(), HTTPC_u32GetTierSwitches(), HTTPC_u32GetGoodput());
+    if (HTTPC_bIsHls())
+        myprintf("HLS: %d segments (%d skipped) | ", HTTPC_u32GetHlsSegments(), HTTPC_u32GetHlsSkipped());
+    myprintf("Stalls: %d (failover %d ms, %d underruns avoided) | ", HTTPC_u32GetStalls(), HTTPC_u32GetFailoverTime(), HTTPC_u32GetUnderrunsAvoided());
+    myprintf("Reconnects: %d (outage %d ms, max %d ms, %d Bytes left) | ", HTTPC_u32GetReconnectCount(), HTTPC_u32GetOutageTime(), HTTPC_u32GetMaxOutageTime(), HTTPC_u32GetReconnectBuffered());
+    myprintf("SDI burst: %d us | ", VS1053_u32GetFeederBurstTime());
 }
+#endif
 
 void ICACHE_FLASH_ATTR TimerFunc_1000(void *arg)
 {
-    myprintf("%d Byte/s | ", data_count);
-    myprintf("%d Bytes avail | ", 20000 - VS1053_u16GetFreeBufferSize());
+    uint32 received = HTTPC_u32GetReceivedBytes();
+
+    Time_u32Uptime++;
+    // Counter starts from zero for every new stream
+    if (received < Time_u32LastReceived)
+        Time_u32LastReceived = 0;
+    myprintf("%d Byte/s | ", received - Time_u32LastReceived);
+    Time_u32LastReceived = received;
+    myprintf("%d Bytes avail | ", VS1053_u16GetUsedBufferSize());
+#ifdef STREAM_STATISTICS
+    Time_vPrintStreamStatistics();
+#endif
     myprintf("Decoded Time: %d | ", VS1053_u16ReadDecodedTime());
     if (VS1053_u8ReadChannelCount() == 0)
         myprintf("Channel: Mono | ");
@@ -83,28 +124,27 @@ void ICACHE_FLASH_ATTR TimerFunc_1000(void *arg)
     // Print out heap size (just for debugging purposes)
     myprintf("Free HEAP: %d | ", system_get_free_heap_size());
     myprintf("\n");
-
-    data_count = 0;
 }
 
-void ICACHE_FLASH_ATTR Timer_StreamingCallback(char *response, int http_status, char *full_response)
+void ICACHE_FLASH_ATTR Timer_StreamingCallback(int http_status)
 {
     myprintf("Streaming: Stopped with Code %d\n", http_status);
-    if (http_status != -1)
-    {
-        myprintf("Streaming: response=%s\n", full_response);
-    }
 }
 
 void ICACHE_FLASH_ATTR Time_vTimerInit(void)
 {
-    // 500us timer
-    // Faster is not possible. Otherwise callback will be called multiple times without delay
-    os_timer_disarm(&TimerObject_1);
-    os_timer_setfn(&TimerObject_1, (os_timer_func_t*) TimerFunc_1, NULL);
-    os_timer_arm_us(&TimerObject_1, 500, 1);
+    // 10ms timer
+    os_timer_disarm(&TimerObject_10);
+    os_timer_setfn(&TimerObject_10, (os_timer_func_t*) TimerFunc_10, NULL);
+    os_timer_arm(&TimerObject_10, 10, 1);
     // 1000ms timer
     os_timer_disarm(&TimerObject_1000);
     os_timer_setfn(&TimerObject_1000, (os_timer_func_t*) TimerFunc_1000, NULL);
     os_timer_arm(&TimerObject_1000, 1000, 1);
 }
+
+uint32 ICACHE_FLASH_ATTR Time_u32GetUptime(void)
+{
+    // Seconds since timers have been started
+    return Time_u32Uptime;
+}
@@ -25,6 +25,7 @@
  */
 
 void ICACHE_FLASH_ATTR Time_vTimerInit(void);
-void ICACHE_FLASH_ATTR Timer_StreamingCallback(char * response, int http_status, char * full_response);
+void ICACHE_FLASH_ATTR Timer_StreamingCallback(int http_status);
+uint32 ICACHE_FLASH_ATTR Time_u32GetUptime(void);
 
 #endif /* USER_TIMER_H_ */
@@ -36,6 +36,7 @@
 #include "sha256.h"
 #include "vs1053.h"
 #include "httpclient.h"
+#include "control.h"
 
 unsigned char hash[32];
 
@@ -113,6 +114,9 @@ HttpdBuiltInUrl builtInUrls[] = {
         { "/", cgiRedirect, "/index.html" },
         { "/index.html", cgiEspFsTemplate, IndexTemplate },
         { "/stream.cgi", IndexStreamCgi, NULL },
+        { "/stations.cgi", IndexStationsCgi, NULL },
+        { "/import.cgi", IndexImportCgi, NULL },
+        { "/api/stations", ApiStationsCgi, NULL },
         { "/playback.cgi", IndexPlaybackCgi, NULL },
         { "/volume.cgi", IndexVolumeCgi, NULL },
         { "/enhancer.cgi", IndexEnhancerCgi, NULL },
@@ -171,6 +175,8 @@ void wifi_handle_event_cb(System_Event_t *evt)
             Time_vTimerInit();
             if(Control_u8GetAutoStart())
                 HTTPC_vStartStreaming("http://hd.stream.frequence3.net/frequence3-256-z2backup.mp3", "Icy-MetaData:1\r\n", Timer_StreamingCallback);
+            // Station hostnames are resolved in background
+            Control_vPrefetchStreams();
             break;
 
         case EVENT_SOFTAPMODE_STACONNECTED:
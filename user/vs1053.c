@@ -123,6 +123,14 @@
 #define SCI_DECODE_TIME    	0x0004
 /********************************/
 
+/******* WRAM REGISTERS *******/
+// Register Address
+#define SCI_WRAM            0x0006
+#define SCI_WRAMADDR        0x0007
+// Parameter address of byte to be sent after end of stream
+#define PARA_END_FILL_BYTE  0x1E06
+/********************************/
+
 /***** AUDATA REGISTER *****/
 // Register Address
 #define SCI_AUDATA    		0x0005
@@ -179,80 +187,286 @@
 
 #define BUFFER_FAIL     0
 #define BUFFER_SUCCESS  1
-#define BUFFER_SIZE 20000
+// Needs to be a power of two (index calculation is done by masking)
+#define BUFFER_SIZE VS1053_BUFFER_SIZE
+#define BUFFER_MASK (BUFFER_SIZE - 1)
+
+// Compiler barrier: Make sure data is copied before the index is published
+#define BUFFER_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+/******* HARDWARE ACCESS ********/
+// All accesses to the chip are done by these macros. This allows to replace the hardware by a model of the chip.
+#ifdef VS1053_MODEL
+// Host build: Macros are defined by the model (test/host/vs1053_model.h)
+#include "vs1053_model.h"
+#else
+// DREQ signal of VS1053 (high as long as the chip is able to take at least 32 bytes of data)
+#define VS1053_DREQ()               GPIO_INPUT_GET(4)
+#define VS1053_XRESET(value)        GPIO_OUTPUT_SET(0, value)
+#define VS1053_XDCS(value)          GPIO_OUTPUT_SET(5, value)
+#define VS1053_XCS(value)           GPIO_OUTPUT_SET(15, value)
+#define VS1053_SPI_WRITE16(value)   spiwrite_16(value)
+#define VS1053_SPI_WRITE32(value)   spiwrite_32(value)
+#define VS1053_SPI_WRITE_BLOCK(data, length) spi_write_block(HSPI, data, length)
+#endif
+/********************************/
+
+// Feeder is executed as system task which is posted on DREQ rising edge
+#define VS1053_FEEDER_TASK_PRIO     USER_TASK_PRIO_2
+#define VS1053_FEEDER_QUEUE_LEN     2
+// Maximum number of 32 byte bursts sent per task execution (2048 bytes = complete SDI FIFO)
+#define VS1053_FEEDER_MAX_BURSTS    64
 
 #define MUTE        1
 #define UNMUTE      2
 #define UNMUTE_TIME 200000
 
+// Single producer (espconn receive callback) / single consumer (VS1053 feeder) ring buffer.
+// Both indices are free running. Only the producer modifies "write" and only the consumer modifies "read".
 struct Buffer
 {
     uint8_t data[BUFFER_SIZE];
-    uint16_t read; // zeigt auf das Feld mit dem aeltesten Inhalt
-    uint16_t write; // zeigt immer auf leeres Feld
+    volatile uint32_t read; // Total number of bytes taken out of the buffer
+    volatile uint32_t write; // Total number of bytes put into the buffer
 } buffer = { { }, 0, 0 };
 
+typedef struct
+{
+    bool enabled; // Data is only sent to VS1053 if feeder is enabled (used for prebuffering)
+    volatile bool posted; // Feeder task has been posted and not executed yet
+    volatile uint32 dreq_timestamp; // Time of last DREQ rising edge in us (0 = no edge pending)
+    uint32 latency; // Time from last DREQ rising edge until first SDI byte in us
+    uint32 latency_max;
+    uint32 bursts; // Number of 32 byte bursts sent to VS1053
+    uint32 burst_time; // Total CPU time spent for sending bursts in us
+} VS1053_tstFeeder;
+
+static VS1053_tstFeeder VS1053_stFeeder;
+
+typedef struct
+{
+    uint32 sci_reads;
+    uint32 sci_writes;
+    uint32 underruns; // Number of times the chip requested data while the ring buffer was empty
+    bool underrun; // Ring buffer is currently empty (underrun already counted)
+    uint16 peak_used; // Highest ring buffer fill level since last flush in bytes
+} VS1053_tstStatistics;
+
+static VS1053_tstStatistics VS1053_stStatistics;
+static os_event_t VS1053_astFeederQueue[VS1053_FEEDER_QUEUE_LEN];
+
 static void ICACHE_FLASH_ATTR VS1053_vHardwareReset(void)
 {
     // Set Pin D3 (GPIO_0) low
-    GPIO_OUTPUT_SET(0, 0);
+    VS1053_XRESET(0);
     // Wait for reset to be processed
-    while (GPIO_INPUT_GET(4));
+    while (VS1053_DREQ());
     // Set Pin D3 (GPIO_0) high
-    GPIO_OUTPUT_SET(0, 1);
+    VS1053_XRESET(1);
     // Check for init complete on DREQ pin (rises when done)
-    while (!GPIO_INPUT_GET(4));
+    while (!VS1053_DREQ());
 }
 
 static void ICACHE_FLASH_ATTR VS1053_vChipSelectData(bool value)
 {
     // Invert value
-    GPIO_OUTPUT_SET(5, !value);
+    VS1053_XDCS(!value);
 }
 
 static void ICACHE_FLASH_ATTR VS1053_vChipSelectCommand(bool value)
 {
     // Invert value
-    GPIO_OUTPUT_SET(15, !value);
+    VS1053_XCS(!value);
 }
 
 static void ICACHE_FLASH_ATTR VS1053_vWriteRegister(uint16 address, uint16 value)
 {
     // Check if slave is ready to receive data
-    while (!GPIO_INPUT_GET(4));
+    while (!VS1053_DREQ());
+    VS1053_stStatistics.sci_writes++;
     // Chip select for command instruction
     VS1053_vChipSelectCommand(1);
-    spiwrite_32(((VS_WRITE_COMMAND | address) << 16) | value);
+    VS1053_SPI_WRITE32(((VS_WRITE_COMMAND | address) << 16) | value);
     VS1053_vChipSelectCommand(0);
     // Wait for command to be processed
-    while (!GPIO_INPUT_GET(4));
+    while (!VS1053_DREQ());
 }
 
 static uint16 ICACHE_FLASH_ATTR VS1053_u16ReadRegister(uint16 address)
 {
     uint32 result;
     // Check if slave is ready to receive data
-    while (!GPIO_INPUT_GET(4));
+    while (!VS1053_DREQ());
+    VS1053_stStatistics.sci_reads++;
     // Chip select for command instruction
     VS1053_vChipSelectCommand(1);
-    spiwrite_16(VS_READ_COMMAND | address);
-    result = spiwrite_16(0x0000);
+    VS1053_SPI_WRITE16(VS_READ_COMMAND | address);
+    result = VS1053_SPI_WRITE16(0x0000);
     VS1053_vChipSelectCommand(0);
     // Wait for command to be processed
-    while (!GPIO_INPUT_GET(4));
+    while (!VS1053_DREQ());
     return result;
 }
 
 static void ICACHE_FLASH_ATTR VS1053_vWriteData(uint32 value)
 {
     // Check if slave is ready to receive data
-    while (!GPIO_INPUT_GET(4));
+    while (!VS1053_DREQ());
     // Chip select for data
     VS1053_vChipSelectData(1);
-    spiwrite_32(value);
+    VS1053_SPI_WRITE32(value);
     VS1053_vChipSelectData(0);
     // Wait for command to be processed
-    while (!GPIO_INPUT_GET(4));
+    while (!VS1053_DREQ());
+}
+
+// Executed in interrupt context => Needs to be located in IRAM
+void VS1053_vKickFeeder(void)
+{
+    // Only one feeder task at a time
+    if (VS1053_stFeeder.posted)
+        return;
+    VS1053_stFeeder.posted = 1;
+    system_os_post(VS1053_FEEDER_TASK_PRIO, 0, 0);
+}
+
+// Executed in interrupt context => Needs to be located in IRAM
+static void VS1053_vDreqInterrupt(void *arg)
+{
+    uint32 status = GPIO_REG_READ(GPIO_STATUS_ADDRESS);
+
+    // Clear interrupt status
+    GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, status);
+    if (status & BIT(4))
+    {
+        // DREQ rising edge: VS1053 is able to take more data
+        if (VS1053_stFeeder.dreq_timestamp == 0)
+            VS1053_stFeeder.dreq_timestamp = system_get_time() | 1;
+        VS1053_vKickFeeder();
+    }
+}
+
+static void ICACHE_FLASH_ATTR VS1053_vFeederTask(os_event_t *event)
+{
+    uint32 bursts = 0;
+    uint32 timestamp;
+
+    VS1053_stFeeder.posted = 0;
+
+    // Keep data in ring buffer until feeder is enabled
+    if (!VS1053_stFeeder.enabled)
+        return;
+
+    // Send data as long as the chip accepts it and there is data available
+    while ((bursts < VS1053_FEEDER_MAX_BURSTS) && VS1053_DREQ() && (VS1053_u16GetUsedBufferSize() >= 32))
+    {
+        if (bursts == 0)
+        {
+            // Measure time between DREQ edge and first data sent
+            timestamp = VS1053_stFeeder.dreq_timestamp;
+            if (timestamp != 0)
+            {
+                // Lowest bit only marks the timestamp as valid (feeder might run within the same microsecond)
+                VS1053_stFeeder.latency = system_get_time() - (timestamp & ~1);
+                if (VS1053_stFeeder.latency > VS1053_stFeeder.latency_max)
+                    VS1053_stFeeder.latency_max = VS1053_stFeeder.latency;
+            }
+        }
+        timestamp = system_get_time();
+        VS1053_vPoll();
+        VS1053_stFeeder.burst_time += system_get_time() - timestamp;
+        bursts++;
+    }
+    VS1053_stFeeder.dreq_timestamp = 0;
+    VS1053_stFeeder.bursts += bursts;
+
+    // Chip is hungry but there is no data => Count every underrun only once (playback has to be started before)
+    if ((bursts != 0) || (VS1053_u16GetUsedBufferSize() >= 32))
+        VS1053_stStatistics.underrun = 0;
+    else if (!VS1053_stStatistics.underrun && (VS1053_stFeeder.bursts != 0) && VS1053_DREQ())
+    {
+        VS1053_stStatistics.underrun = 1;
+        VS1053_stStatistics.underruns++;
+    }
+
+    // Give other tasks a chance to run, then continue where we stopped
+    if (bursts == VS1053_FEEDER_MAX_BURSTS)
+        VS1053_vKickFeeder();
+    // Otherwise the feeder is idle until next DREQ rising edge or until new data has been written to ring buffer
+}
+
+void ICACHE_FLASH_ATTR VS1053_vEnableFeeder(bool enable)
+{
+    VS1053_stFeeder.enabled = enable;
+    VS1053_stStatistics.underrun = 0;
+    if (enable)
+        VS1053_vKickFeeder();
+}
+
+bool ICACHE_FLASH_ATTR VS1053_bIsFeederEnabled(void)
+{
+    return VS1053_stFeeder.enabled;
+}
+
+static void ICACHE_FLASH_ATTR VS1053_vFeederInit(void)
+{
+    // Register feeder task
+    system_os_task(VS1053_vFeederTask, VS1053_FEEDER_TASK_PRIO, VS1053_astFeederQueue, VS1053_FEEDER_QUEUE_LEN);
+    // Trigger feeder on rising edge of DREQ
+    ETS_GPIO_INTR_DISABLE();
+    ETS_GPIO_INTR_ATTACH(VS1053_vDreqInterrupt, NULL);
+    gpio_pin_intr_state_set(GPIO_ID_PIN(4), GPIO_PIN_INTR_POSEDGE);
+    GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, BIT(4));
+    ETS_GPIO_INTR_ENABLE();
+}
+
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetFeederLatency(void)
+{
+    return VS1053_stFeeder.latency;
+}
+
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetFeederMaxLatency(void)
+{
+    return VS1053_stFeeder.latency_max;
+}
+
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetFeederBursts(void)
+{
+    return VS1053_stFeeder.bursts;
+}
+
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetFeederBurstTime(void)
+{
+    // Average CPU time per 32 byte burst in us
+    if (VS1053_stFeeder.bursts == 0)
+        return 0;
+    return VS1053_stFeeder.burst_time / VS1053_stFeeder.bursts;
+}
+
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetFeederBusyTime(void)
+{
+    // Total CPU time spent for sending bursts in us
+    return VS1053_stFeeder.burst_time;
+}
+
+uint16 ICACHE_FLASH_ATTR VS1053_u16GetPeakBufferSize(void)
+{
+    return VS1053_stStatistics.peak_used;
+}
+
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetUnderruns(void)
+{
+    return VS1053_stStatistics.underruns;
+}
+
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetSciReads(void)
+{
+    return VS1053_stStatistics.sci_reads;
+}
+
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetSciWrites(void)
+{
+    return VS1053_stStatistics.sci_writes;
 }
 
 void ICACHE_FLASH_ATTR VS1053_vInit(void)
@@ -269,8 +483,8 @@ void ICACHE_FLASH_ATTR VS1053_vInit(void)
     PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO5_U, FUNC_GPIO5);
     PIN_FUNC_SELECT(PERIPHS_IO_MUX_MTDO_U, FUNC_GPIO15);
     // Set CS Signals high
-    GPIO_OUTPUT_SET(5, 1);
-    GPIO_OUTPUT_SET(15, 1);
+    VS1053_XDCS(1);
+    VS1053_XCS(1);
     // Init SPI interface with 1MHz clock
     spi_init(HSPI);
     // Reset VS1053
@@ -295,6 +509,8 @@ void ICACHE_FLASH_ATTR VS1053_vInit(void)
         data_pointer.BassAmp,
         data_pointer.BassLim);
     VS1053_vSetSpartialProcessing(Control_u8GetSpartialProcessingLevel());
+    // Start event driven data feeding
+    VS1053_vFeederInit();
 }
 
 void ICACHE_FLASH_ATTR VS1053_vTest(void)
@@ -312,7 +528,7 @@ void ICACHE_FLASH_ATTR VS1053_vTest(void)
 
 uint32 ICACHE_FLASH_ATTR VS1053_u32SendMusicData(uint8 *data)
 {
-    if (!GPIO_INPUT_GET(4))
+    if (!VS1053_DREQ())
     {
         // Chip is not ready jet
         return 0;
@@ -321,109 +537,156 @@ uint32 ICACHE_FLASH_ATTR VS1053_u32SendMusicData(uint8 *data)
     {
         // Chip select for data
         VS1053_vChipSelectData(1);
-        // We are allowed to send at least 32Bytes of Data
-        for (int i = 0; i < 8; i++)
-        {
-            spiwrite_32((data[i * 4] << 24) | (data[(i * 4) + 1] << 16) | (data[(i * 4) + 2] << 8) | (data[(i * 4) + 3]));
-        }
+        // We are allowed to send at least 32Bytes of Data => Send them in one SPI transaction
+        VS1053_SPI_WRITE_BLOCK(data, 32);
         // Chip select for data
         VS1053_vChipSelectData(0);
         return 1;
     }
 }
 
-static ICACHE_FLASH_ATTR uint8_t BufferIn(uint8_t byte)
+void ICACHE_FLASH_ATTR VS1053_vFlushRingBuffer(void)
 {
-    if ((buffer.write + 1 == buffer.read) || (buffer.read == 0 && buffer.write + 1 == BUFFER_SIZE))
-        return BUFFER_FAIL; // voll
-
-    buffer.data[buffer.write] = byte;
-
-    buffer.write++;
-    if (buffer.write >= BUFFER_SIZE)
-        buffer.write = 0;
-
-    return BUFFER_SUCCESS;
+    // Feeder is stopped, so the read index can be touched here
+    VS1053_vEnableFeeder(0);
+    buffer.read = buffer.write;
+    VS1053_stStatistics.peak_used = 0;
 }
 
-static ICACHE_FLASH_ATTR uint8_t BufferOut(uint8_t *pByte)
+void ICACHE_FLASH_ATTR VS1053_vCancelPlayback(void)
 {
-    if (buffer.read == buffer.write)
-        return BUFFER_FAIL;
+    uint8 fill[32];
+    uint16 mode;
+    uint8 i;
+
+    // Data of old stream is not needed anymore
+    VS1053_vFlushRingBuffer();
+
+    // Cancel procedure from data sheet: Feed endFillByte until SM_CANCEL is cleared by the chip
+    VS1053_vWriteRegister(SCI_WRAMADDR, PARA_END_FILL_BYTE);
+    os_memset(fill, VS1053_u16ReadRegister(SCI_WRAM) & 0xFF, sizeof(fill));
+    mode = VS1053_u16ReadRegister(SCI_MODE);
+    VS1053_vWriteRegister(SCI_MODE, mode | SM_CANCEL);
+    // Chip has to react within 2048 bytes
+    for (i = 0; i < 64; i++)
+    {
+        while (!VS1053_u32SendMusicData(fill));
+        if (!(VS1053_u16ReadRegister(SCI_MODE) & SM_CANCEL))
+            return;
+    }
 
-    *pByte = buffer.data[buffer.read];
+    // Cancel has not been acknowledged => Software reset (clock setting is lost)
+    VS1053_vWriteRegister(SCI_MODE, mode | SM_RESET);
+    // Chip runs from XTALI again => SCI only accepts slow SPI clock (CLKI/4) until multiplier is set
+    spi_clock(HSPI, SPI_CLK_PREDIV, SPI_CLK_CNTDIV);
+    VS1053_vWriteRegister(SCI_CLOCKF, 0xF800);
+    spi_clock(HSPI, 3, 2);
+    VS1053_vWriteRegister(SCI_MODE, mode);
+}
 
-    buffer.read++;
-    if (buffer.read >= BUFFER_SIZE)
-        buffer.read = 0;
+uint32 ICACHE_FLASH_ATTR VS1053_u32WriteRingBuffer(const uint8 *data, uint32 length)
+{
+    uint32 write = buffer.write;
+    uint32 free = BUFFER_SIZE - (write - buffer.read);
+    uint32 offset = write & BUFFER_MASK;
+    uint32 first;
+
+    // Only write as much as fits into buffer
+    if (length > free)
+        length = free;
+    // Copy data in (at most) two blocks: up to the end of the buffer and from its start
+    first = BUFFER_SIZE - offset;
+    if (first > length)
+        first = length;
+    os_memcpy(&buffer.data[offset], data, first);
+    os_memcpy(&buffer.data[0], data + first, length - first);
+    // Publish new data to consumer
+    BUFFER_BARRIER();
+    buffer.write = write + length;
+    if (VS1053_u16GetUsedBufferSize() > VS1053_stStatistics.peak_used)
+        VS1053_stStatistics.peak_used = VS1053_u16GetUsedBufferSize();
+    // Feeder might be idle because buffer was empty
+    if (VS1053_u16GetUsedBufferSize() >= 32)
+        VS1053_vKickFeeder();
+    return length;
+}
 
-    return BUFFER_SUCCESS;
+uint32 ICACHE_FLASH_ATTR VS1053_u32TruncateRingBuffer(uint32 length)
+{
+    uint32 used = buffer.write - buffer.read;
+
+    // Take back data that has not been sent yet. Feeder runs in task context as well, so it can't interfere here.
+    if (length > used)
+        length = used;
+    buffer.write -= length;
+    BUFFER_BARRIER();
+    return length;
 }
 
 uint8_t ICACHE_FLASH_ATTR VS1053_vFillRingBuffer(uint8 *data, uint32 length)
 {
-    uint8 temp;
-    for (uint32 i = 0; i < length; i++)
-    {
-        if (BufferIn(*(data + i)) == BUFFER_FAIL)
-        {
-            return BUFFER_FAIL;
-        }
-    }
+    // Either all or nothing is written to buffer
+    if (length > VS1053_u16GetFreeBufferSize())
+        return BUFFER_FAIL;
+    VS1053_u32WriteRingBuffer(data, length);
     return BUFFER_SUCCESS;
 }
 
-uint8 ICACHE_FLASH_ATTR VS1053_s16ReadRingBuffer(uint8 *data)
+uint32 ICACHE_FLASH_ATTR VS1053_u32PeekRingBuffer(uint8 **data)
 {
-    return BufferOut(data);
+    uint32 read = buffer.read;
+    uint32 used = buffer.write - read;
+    uint32 offset = read & BUFFER_MASK;
+
+    // Return pointer to oldest data
+    *data = &buffer.data[offset];
+    // Only the contiguous part up to the end of the buffer is returned
+    if (used > BUFFER_SIZE - offset)
+        used = BUFFER_SIZE - offset;
+    return used;
+}
+
+void ICACHE_FLASH_ATTR VS1053_vCommitRingBuffer(uint32 length)
+{
+    // Data has been consumed. Make space available to producer
+    BUFFER_BARRIER();
+    buffer.read += length;
 }
 
 uint16 ICACHE_FLASH_ATTR VS1053_u16GetFreeBufferSize(void)
 {
-    if (buffer.write == buffer.read)
-        return BUFFER_SIZE;
-    if (buffer.write < buffer.read)
-        return buffer.read - buffer.write;
-    if (buffer.write > buffer.read)
-        return (BUFFER_SIZE - buffer.write) + buffer.read;
-    return 0;
+    return BUFFER_SIZE - (buffer.write - buffer.read);
 }
 
 uint16 ICACHE_FLASH_ATTR VS1053_u16GetUsedBufferSize(void)
 {
-    return (BUFFER_SIZE - VS1053_u16GetFreeBufferSize());
+    return buffer.write - buffer.read;
 }
 
 void ICACHE_FLASH_ATTR VS1053_vPoll(void)
 {
     static uint8 data[32];
-    static uint8 data_pending = 0;
-    uint8 temp;
+    uint8 *ptr;
+    uint32 length;
 
     // Check if enough data is available in buffer
-    if (VS1053_u16GetUsedBufferSize() >= 32)
+    if (VS1053_u16GetUsedBufferSize() < 32)
+        return;
+    // Get data without removing it from buffer
+    length = VS1053_u32PeekRingBuffer(&ptr);
+    // Data is always consumed in 32 byte blocks so this only happens if the buffer size is changed
+    if (length < 32)
     {
-        // Enough data available
-        if (!data_pending)
-        {
-            // There is no data pending
-            // Read 32 Byte from ringbuffer
-            for (uint32 i = 0; i < 32; i++)
-                VS1053_s16ReadRingBuffer(&data[i]);
-        }
-        // Try to send data to VS1053 (function call will return zero in case VS1053 is not ready)
-        temp = VS1053_u32SendMusicData(data);
-        // Check if data has been send
-        if (temp == 0)
-        {
-            // Data was not send to VS1053. Try again next time.
-            data_pending = 1;
-        }
-        else
-        {
-            // Data has been send to VS1053
-            data_pending = 0;
-        }
+        // Block wraps around the end of the buffer => Copy into linear memory
+        os_memcpy(data, ptr, length);
+        os_memcpy(&data[length], &buffer.data[0], 32 - length);
+        ptr = data;
+    }
+    // Try to send data to VS1053 (function call will return zero in case VS1053 is not ready)
+    if (VS1053_u32SendMusicData(ptr) != 0)
+    {
+        // Data has been send to VS1053. Otherwise it stays in the buffer and we try again next time.
+        VS1053_vCommitRingBuffer(32);
     }
 }
 
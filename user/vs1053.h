@@ -34,13 +34,34 @@
  D8 (GPIO_15) => XCS		Chip select input (active low)
  */
 
+// Size of audio ring buffer in bytes (needs to be a power of two)
+#define VS1053_BUFFER_SIZE 16384
+
 void ICACHE_FLASH_ATTR VS1053_vInit(void);
 void ICACHE_FLASH_ATTR VS1053_vTest(void);
 uint32 ICACHE_FLASH_ATTR VS1053_u32SendMusicData(uint8 *data);
+void ICACHE_FLASH_ATTR VS1053_vFlushRingBuffer(void);
+void ICACHE_FLASH_ATTR VS1053_vCancelPlayback(void);
+uint32 ICACHE_FLASH_ATTR VS1053_u32WriteRingBuffer(const uint8 *data, uint32 length);
+uint32 ICACHE_FLASH_ATTR VS1053_u32TruncateRingBuffer(uint32 length);
 uint8_t ICACHE_FLASH_ATTR VS1053_vFillRingBuffer(uint8 *data, uint32 length);
-uint8 ICACHE_FLASH_ATTR VS1053_s16ReadRingBuffer(uint8 *data);
+uint32 ICACHE_FLASH_ATTR VS1053_u32PeekRingBuffer(uint8 **data);
+void ICACHE_FLASH_ATTR VS1053_vCommitRingBuffer(uint32 length);
 uint16 ICACHE_FLASH_ATTR VS1053_u16GetFreeBufferSize(void);
+uint16 ICACHE_FLASH_ATTR VS1053_u16GetUsedBufferSize(void);
 void ICACHE_FLASH_ATTR VS1053_vPoll(void);
+void VS1053_vKickFeeder(void);
+void ICACHE_FLASH_ATTR VS1053_vEnableFeeder(bool enable);
+bool ICACHE_FLASH_ATTR VS1053_bIsFeederEnabled(void);
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetFeederLatency(void);
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetFeederMaxLatency(void);
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetFeederBursts(void);
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetFeederBurstTime(void);
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetFeederBusyTime(void);
+uint16 ICACHE_FLASH_ATTR VS1053_u16GetPeakBufferSize(void);
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetUnderruns(void);
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetSciReads(void);
+uint32 ICACHE_FLASH_ATTR VS1053_u32GetSciWrites(void);
 void ICACHE_FLASH_ATTR VS1053_vSetVolume(uint8 vol_left, uint8 vol_right);
 uint16 ICACHE_FLASH_ATTR VS1053_u16ReadDecodedTime(void);
 uint8 ICACHE_FLASH_ATTR VS1053_u8ReadChannelCount(void);